@@ -0,0 +1,108 @@
+// --------------------------
+//  File: FrameArena.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace mayak::core {
+    /// @brief Bump allocator: allocating is a pointer increment, freeing is Reset()
+    ///
+    /// Nothing gets freed one by one and no destructors run, so keep it to
+    /// trivially destructible stuff (or containers living in the arena themselves).
+    /// When a frame doesn't fit, it grabs another block, and Reset() merges
+    /// everything into one block big enough for that frame, so from then on
+    /// a frame of the same size doesn't touch the global heap at all.
+    class LinearArena {
+    public:
+        LinearArena() : LinearArena(64 * 1024) {}
+        explicit LinearArena(std::size_t initialSize);
+        ~LinearArena();
+
+        LinearArena(const LinearArena&) = delete;
+        LinearArena& operator=(const LinearArena&) = delete;
+
+        void* Allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t));
+
+        template <typename T>
+        T* AllocateArray(std::size_t count) {
+            return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        template <typename T, typename... Args>
+        T* New(Args&&... args) {
+            return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        /// @brief Forgets everything allocated, keeps (and merges) the memory
+        void Reset();
+
+        /// @brief Bytes handed out since the last Reset(), padding included
+        std::size_t Used() const { return used; }
+        std::size_t Capacity() const;
+
+        /// @brief Used() right before the last Reset(), i.e. what the last frame needed
+        std::size_t LastFrameUsed() const { return lastFrameUsed; }
+
+        /// @brief Most any frame ever needed
+        std::size_t HighWater() const { return highWater; }
+
+        /// @brief How many times it had to go to the global heap, stays flat in steady state
+        uint64_t BlockAllocations() const { return blockAllocations; }
+
+    private:
+        struct Block {
+            std::byte* data;
+            std::size_t size;
+        };
+
+        void AddBlock(std::size_t size);
+
+        std::vector<Block> blocks; // the last one is the one we bump in
+        std::size_t offset = 0;    // into the last block
+        std::size_t used = 0;
+        std::size_t lastFrameUsed = 0;
+        std::size_t highWater = 0;
+        uint64_t blockAllocations = 0;
+    };
+
+    /// @brief Lets std::pmr containers allocate from a LinearArena
+    /// @note deallocate() does nothing, memory comes back on the arena's Reset()
+    class ArenaResource : public std::pmr::memory_resource {
+    public:
+        explicit ArenaResource(LinearArena& arena) : arena(arena) {}
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            return arena.Allocate(bytes, alignment);
+        }
+        void do_deallocate(void*, std::size_t, std::size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+        LinearArena& arena;
+    };
+
+    /// @brief This frame's arena on the main thread, emptied when the next frame starts
+    ///
+    /// Double-buffered while a render thread is running, so what you put in it
+    /// stays valid through the next frame too. For data that goes into a
+    /// RenderPipeline packet use RenderPipeline::Arena(), that one lives exactly
+    /// as long as the packet does.
+    LinearArena& frame_arena();
+
+    /// @brief frame_arena() for std::pmr containers
+    std::pmr::memory_resource* frame_resource();
+
+    /// @brief Starts a new frame in the arena
+    /// @warning Is an internal method, the main loop calls it
+    void _begin_frame_arena();
+}
@@ -1,10 +1,50 @@
 #pragma once
 
+// glad has to come before GLFW, and whoever includes this may use GL next
+#include <glad/glad.h>
 #include <GLFW/glfw3.h>
-#include "utils/Logger.hpp"
+#include "utils/logger.hpp"
 
 namespace mayak::core {
-    bool initialized = false;
+    /// @brief Where headless windows get their GL context from
+    enum class HeadlessBackend {
+        Auto,   // Hidden if there's a display, otherwise EGL, otherwise OSMesa
+        Hidden, // invisible window on the normal platform, needs a display server
+        EGL,    // no display: EGL pbuffer / surfaceless, GPU or Mesa's software rasterizer
+        OSMesa  // no display, no GPU: Mesa's off-screen software rasterizer
+    };
+
+    struct InitOptions {
+        /// Windows are never shown and render into an FBO, read it back with Window::ReadPixels()
+        bool headless = false;
+        HeadlessBackend backend = HeadlessBackend::Auto;
+    };
+
+    extern bool initialized;
     bool init();
+    bool init(const InitOptions& options);
     void shutdown(int code);
-}
\ No newline at end of file
+
+    /// @brief True if init() was asked for headless mode
+    bool is_headless();
+
+    /// @brief The backend headless mode actually picked, Auto resolved
+    HeadlessBackend headless_backend();
+
+    /// @brief GLFW runs without any display server (EGL / OSMesa backends),
+    /// so glfwWaitEvents() can't sleep for us
+    bool is_displayless();
+
+    //  -------------------------------------
+    //  Internal methods (don't touch it pls 🙏)
+    //  -------------------------------------
+
+    /// @brief glfwDefaultWindowHints() plus ours (GL 3.3 core, headless, backend),
+    /// for code that had to change a hint for one special window
+    /// @warning Is an internal method
+    void _apply_window_hints();
+
+    /// @brief EGL didn't give us a context, every window from now on uses OSMesa
+    /// @warning Is an internal method, the shared context creation calls it
+    void _fall_back_to_osmesa();
+}
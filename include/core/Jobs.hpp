@@ -0,0 +1,132 @@
+// --------------------------
+//  File: Jobs.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mayak::core {
+    using JobFn = std::function<void()>;
+
+    namespace detail {
+        struct Job;
+
+        /// @brief Chase-Lev work-stealing deque, the owner pushes and pops at the
+        /// bottom, everyone else steals from the top
+        class WorkDeque {
+        public:
+            static constexpr int64_t CAPACITY = 4096;
+
+            /// @return False if it's full
+            bool Push(Job* job);
+            Job* Pop();
+            Job* Steal();
+
+        private:
+            alignas(64) std::atomic<int64_t> top{0};
+            alignas(64) std::atomic<int64_t> bottom{0};
+            std::unique_ptr<std::atomic<Job*>[]> buffer{new std::atomic<Job*>[CAPACITY]};
+        };
+    }
+
+    /// @brief Something Run() returned, to wait for or to depend on
+    class JobHandle {
+    public:
+        JobHandle() = default;
+
+        /// @brief The job ran (an empty handle counts as done)
+        bool Done() const;
+
+    private:
+        friend class JobSystem;
+        explicit JobHandle(std::shared_ptr<detail::Job> job) : job(std::move(job)) {}
+        std::shared_ptr<detail::Job> job;
+    };
+
+    struct JobSystemOptions {
+        /// -1 = one per hardware thread, minus the calling thread.
+        /// 0 is allowed too, then whoever waits runs everything
+        int workers = -1;
+        /// Pin worker i to core i, helps cache locality on big machines, hurts on busy ones
+        bool pinThreads = false;
+    };
+
+    /// @brief Work-stealing thread pool
+    ///
+    /// Every worker has its own deque, new jobs go to the bottom of the current
+    /// worker's deque (cache-hot, no contention) and idle workers steal the oldest
+    /// ones from the top of the others. Jobs coming from outside the pool go through
+    /// a shared queue. Waiting never just blocks, it runs other jobs meanwhile,
+    /// so fork/join from inside jobs can't deadlock the pool.
+    class JobSystem {
+    public:
+        explicit JobSystem(const JobSystemOptions& options = {});
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        /// @brief Schedules fn
+        JobHandle Run(JobFn fn);
+
+        /// @brief Schedules fn once every dependency is done
+        JobHandle Run(JobFn fn, std::initializer_list<JobHandle> dependencies);
+        JobHandle Run(JobFn fn, const std::vector<JobHandle>& dependencies);
+
+        /// @brief Waits for the job, running other jobs meanwhile
+        void Wait(const JobHandle& handle);
+        void Wait(const std::vector<JobHandle>& handles);
+
+        /// @brief Runs a and b in parallel and returns when both are done (fork/join)
+        void Invoke(const JobFn& a, const JobFn& b);
+
+        /// @brief Calls body(chunkBegin, chunkEnd) over [begin, end) in parallel
+        /// @param grain Smallest chunk worth a job of its own, 0 picks one
+        void ParallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                         const std::function<void(std::size_t, std::size_t)>& body);
+
+        /// @brief Worker threads, the calling thread helps out on top of that
+        unsigned WorkerCount() const { return static_cast<unsigned>(workers.size()); }
+
+        /// @brief Jobs taken from another worker's deque so far
+        uint64_t StealCount() const { return steals; }
+
+    private:
+        struct Worker {
+            detail::WorkDeque deque;
+            std::thread thread;
+        };
+
+        void Schedule(std::shared_ptr<detail::Job> job);
+        void Execute(detail::Job* job);
+        detail::Job* FindJob(int self);
+        void WorkerMain(int index);
+        void Split(std::size_t begin, std::size_t end, std::size_t grain,
+                   const std::function<void(std::size_t, std::size_t)>& body);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::mutex injectMutex;
+        std::deque<detail::Job*> injected;
+        std::atomic<int64_t> injectedCount{0}; // to peek without the lock
+        std::condition_variable wake;
+        std::atomic<int> sleeping{0};
+        std::atomic<int64_t> queued{0};
+        std::atomic<uint64_t> steals{0};
+        std::atomic<bool> stopping{false};
+    };
+
+    /// @brief The library-wide pool, made on first use with the default options
+    JobSystem& job_system();
+}
@@ -1,3 +1,68 @@
+// --------------------------
+//  File: Mainloop.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
 namespace mayak::core {
+    /// @brief Gets called once per frame, draw everything here
+    using FrameCallback = void(*)();
+
+    /// @brief Some work to run on the main thread
+    using Task = std::function<void()>;
+
+    /// @brief How eager the main loop is about drawing
+    enum class LoopMode {
+        OnDemand,   // sleep until something invalidates the frame (default)
+        Continuous  // draw every frame, for animations
+    };
+
+    /// @brief Runs until quit() is called
+    ///
+    /// Sleeps in glfwWaitEvents() while nothing happens, so an idle UI costs
+    /// nothing. A frame is drawn only after invalidate(), or always in Continuous mode.
     void mainloop();
+
+    /// @brief Makes mainloop() return after the current iteration. Thread-safe.
+    void quit();
+
+    /// @brief Sets what gets called to draw a frame
+    void set_frame_callback(FrameCallback callback);
+
+    /// @brief Switches between OnDemand and Continuous drawing
+    void set_loop_mode(LoopMode mode);
+    LoopMode loop_mode();
+
+    /// @brief Something changed, please draw a new frame. Thread-safe.
+    void invalidate();
+
+    /// @brief Runs task on the main thread before the next frame. Thread-safe,
+    /// wakes up the loop if it's sleeping.
+    void post_task(Task task);
+
+    /// @brief Calls task after the given delay, on the main thread
+    /// @param seconds Delay in seconds
+    /// @param task What to call. It should invalidate() itself if it changes something visible
+    /// @param repeat Call it again every `seconds` until cancelled, at least every 1 ms
+    /// @return Timer id for cancel_timer()
+    int add_timer(double seconds, Task task, bool repeat = false);
+
+    /// @brief Stops a timer, does nothing if it already fired.
+    /// Works from inside a timer callback too, even if that timer is due in the same batch
+    void cancel_timer(int id);
+
+    /// @brief How many frames were drawn so far
+    uint64_t frame_count();
+
+    //  -------------------------------------
+    //  Internal methods (don't touch it pls 🙏)
+    //  -------------------------------------
+
+    /// @brief Counts a frame as drawn, for code that runs frames without mainloop() (tests)
+    /// @warning Is an internal method, mainloop() counts its own frames
+    void _advance_frame_count();
 }
@@ -0,0 +1,100 @@
+// --------------------------
+//  File: Pacing.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct GLFWwindow;
+
+namespace mayak::core::pacing {
+    /// @brief What glfwSwapInterval() gets
+    enum class SwapMode {
+        Immediate,    // 0, no vsync, frame rate limited by targetFps only
+        VSync,        // 1, wait for vblank
+        AdaptiveVSync // -1 where the driver has *_swap_control_tear, tears instead of halving when late
+    };
+
+    struct PacingSettings {
+        SwapMode swapMode = SwapMode::VSync;
+
+        /// 0 means the monitor refresh rate
+        double targetFps = 0;
+
+        /// Drop to refresh / 2, / 3... when frames keep missing the budget, and climb back with headroom
+        bool adaptiveFps = false;
+
+        /// Sleep until just before the deadline, then poll input and render,
+        /// so the frame shows the freshest input without spinning a core
+        bool lateLatch = false;
+
+        /// How early before the deadline late-latch wakes up, on top of the expected frame cost
+        int64_t lateLatchMarginNs = 1'500'000;
+    };
+
+    /// @brief Where one frame's time went, all times in nanoseconds
+    struct FrameReport {
+        uint64_t frame = 0;
+        int64_t budgetNs = 0;
+        int64_t cpuNs = 0;
+        int64_t gpuNs = -1;  // -1 if the driver has no timer queries
+        int64_t sleptNs = 0; // time spent waiting for the late-latch / limiter
+        bool cpuOverBudget = false;
+        bool gpuOverBudget = false;
+    };
+
+    /// @brief Gets called for every frame that blew its budget
+    /// @note GPU times show up a few frames late, so is the callback
+    using BudgetCallback = void(*)(const FrameReport& report);
+
+    /// @brief Applies new settings, the swap interval too if a context is current
+    void set_pacing(const PacingSettings& settings);
+    const PacingSettings& pacing();
+
+    /// @brief The interval the settings ask for right now, for glfwSwapInterval()
+    int swap_interval();
+
+    /// @brief Calls glfwSwapInterval() on the current context with the current SwapMode
+    void apply_swap_interval();
+
+    void set_budget_callback(BudgetCallback callback);
+
+    /// @brief Frame rate the governor is aiming for right now
+    double current_target_fps();
+
+    /// @brief Last finished frames, newest last
+    /// @param out Where to copy them
+    /// @param max Size of out
+    /// @return How many got copied
+    std::size_t recent_reports(FrameReport* out, std::size_t max);
+
+    /// @brief How many frames blew their budget since start
+    uint64_t over_budget_count();
+
+    //  -------------------------------------
+    //  Internal methods (don't touch it pls 🙏)
+    //  -------------------------------------
+
+    /// @brief Sleeps according to the settings, then starts timing the frame
+    /// @warning Is an internal method, the main loop calls it
+    void _begin_frame();
+
+    /// @brief Deletes the GPU timer queries if they live in this context, before it gets destroyed
+    /// @warning Is an internal method, ~Window() calls it
+    void _forget_context(GLFWwindow* context);
+
+    /// @brief Ends the GPU timer query if it runs in the current context, which is about to stop being current
+    /// @warning Is an internal method, render_windows() calls it before switching windows
+    void _leaving_context();
+
+    /// @brief Time the main thread spent blocked in a swap, taken out of the frame's CPU time
+    /// @warning Is an internal method, render_windows() calls it
+    void _swap_blocked(int64_t ns);
+
+    /// @brief Stops timing the frame (after swap) and files the report
+    /// @warning Is an internal method, the main loop calls it
+    void _end_frame();
+}
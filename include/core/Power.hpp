@@ -0,0 +1,35 @@
+// --------------------------
+//  File: Power.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include <cstdint>
+
+namespace mayak::core::power {
+    struct PowerSettings {
+        /// Draw nothing at all while every window is minimized or zero-sized
+        bool pauseWhenHidden = true;
+
+        /// Cap the frame rate while no window has focus
+        bool throttleWhenUnfocused = true;
+        double unfocusedFps = 10;
+
+        /// After a pause the next frame is marked as fast-forwarded (see time::fast_forwarded()),
+        /// so animations jump ahead instead of simulating the whole gap
+        bool fastForwardOnResume = true;
+    };
+
+    void set_power_settings(const PowerSettings& settings);
+    const PowerSettings& power_settings();
+
+    /// @brief Nothing to draw: there are windows, but none of them is drawable
+    bool is_suspended();
+
+    /// @brief No window has focus and throttling is on
+    bool is_throttled();
+
+    /// @brief Shortest allowed time between two frames right now, 0 = no limit
+    int64_t min_frame_interval_ns();
+}
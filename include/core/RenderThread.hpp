@@ -0,0 +1,147 @@
+// --------------------------
+//  File: RenderThread.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include "core/FrameArena.hpp"
+#include "core/TripleBuffer.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace mayak::core {
+    /// @brief True while a render thread owns the window contexts,
+    /// the main loop doesn't render itself then
+    bool render_thread_active();
+
+    //  -------------------------------------
+    //  Internal methods (don't touch it pls 🙏)
+    //  -------------------------------------
+
+    /// @warning Is an internal method, RenderPipeline calls it
+    void _set_render_thread_active(bool active);
+
+    /// @brief Detaches all window contexts from the calling thread
+    /// @warning Is an internal method, RenderPipeline calls it
+    void _release_contexts();
+
+    /// @brief Draws every window, on the render thread
+    /// @warning Is an internal method, RenderPipeline calls it
+    void _render_frame();
+
+    /// @brief Splits a frame into two pipelined stages on two threads
+    ///
+    /// The main thread keeps doing events and layout and fills a Packet, a plain
+    /// immutable description of the frame. The render thread owns every GL context
+    /// and draws frame N from its packet while the main thread builds N + 1.
+    /// Packets go through a TripleBuffer, so nobody waits on a lock for them.
+    ///
+    /// Every packet slot has its own LinearArena, Arena(), which gets reset only
+    /// when the main thread takes the slot back, so packet data can point into
+    /// it without copying and without lifetime worries.
+    ///
+    /// Begin() waits until the render thread has picked up the last submitted
+    /// packet, so the main thread stays at most one frame ahead and
+    /// Continuous mode runs at the render thread's (vsync) pace instead of
+    /// building packets nobody draws.
+    ///
+    /// Windows' draw callbacks run on the render thread and read Current().
+    /// Create windows before Start() and destroy them after Stop().
+    template <typename Packet>
+    class RenderPipeline {
+    public:
+        RenderPipeline() = default;
+        ~RenderPipeline() { Stop(); }
+
+        RenderPipeline(const RenderPipeline&) = delete;
+        RenderPipeline& operator=(const RenderPipeline&) = delete;
+
+        /// @brief Hands the GL contexts over to a new render thread
+        void Start() {
+            if (running) return;
+            _release_contexts();
+            running = true;
+            _set_render_thread_active(true);
+            thread = std::thread([this] { Run(); });
+        }
+
+        /// @brief Stops the render thread after its current frame, contexts are free to use again
+        void Stop() {
+            if (!running) return;
+            {
+                std::lock_guard<std::mutex> lock(wakeMutex);
+                running = false;
+            }
+            wake.notify_one();
+            taken.notify_all();
+            thread.join();
+            _set_render_thread_active(false);
+        }
+
+        bool IsRunning() const { return running; }
+
+        /// @brief Main thread: the packet to fill for the next frame, its arena starts empty
+        Packet& Begin() {
+            {
+                // Back-pressure: the last packet may still be drawing, but it has to be taken
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                taken.wait(lock, [this] { return !running || !mailbox.HasFresh(); });
+            }
+            Slot& slot = mailbox.WriteBuffer();
+            slot.arena.Reset();
+            return slot.packet;
+        }
+
+        /// @brief Main thread: arena that lives exactly as long as the packet from Begin()
+        LinearArena& Arena() { return mailbox.WriteBuffer().arena; }
+
+        /// @brief Main thread: done filling, the render thread takes it from here
+        void Submit() {
+            mailbox.Publish();
+            {
+                // The mailbox doesn't need the lock, it only keeps the wakeup from getting lost
+                std::lock_guard<std::mutex> lock(wakeMutex);
+            }
+            wake.notify_one();
+        }
+
+        /// @brief Render thread: the packet being drawn right now
+        const Packet& Current() const { return mailbox.ReadBuffer().packet; }
+
+        /// @brief How many packets got drawn
+        uint64_t RenderedFrames() const { return rendered; }
+
+    private:
+        void Run() {
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(wakeMutex);
+                    wake.wait(lock, [this] { return !running || mailbox.HasFresh(); });
+                    if (!running) break;
+                    mailbox.Acquire();
+                }
+                taken.notify_one();
+                _render_frame();
+                ++rendered;
+            }
+            _release_contexts();
+        }
+
+        struct Slot {
+            Packet packet{};
+            LinearArena arena;
+        };
+
+        TripleBuffer<Slot> mailbox;
+        std::thread thread;
+        std::atomic<bool> running{false};
+        std::atomic<uint64_t> rendered{0};
+        std::mutex wakeMutex;
+        std::condition_variable wake;      // render thread: a packet is there
+        std::condition_variable taken;     // main thread: the render thread took the packet
+    };
+}
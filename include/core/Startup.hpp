@@ -0,0 +1,65 @@
+// --------------------------
+//  File: Startup.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include "core/Mainloop.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mayak::core::startup {
+    /// @brief One recorded startup phase
+    struct Phase {
+        const char* name = "";
+        int64_t startNs = 0; // since the library got loaded
+        int64_t durationNs = 0;
+    };
+
+    /// @brief Times a startup phase from construction to destruction
+    ///
+    /// `startup::Scope scope("glad");` at the top of a function is all it takes.
+    /// Does nothing once the first frame is out.
+    class Scope {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        int64_t start;
+    };
+
+    /// @brief Records a finished phase by hand
+    /// @param name Has to outlive the report, string literals are perfect
+    void record(const char* name, int64_t startNs, int64_t endNs);
+
+    /// @brief Runs task on the main thread once the first frame is on screen
+    ///
+    /// For everything the first frame doesn't need: shaders of hidden screens,
+    /// cache warming, etc. Deferred tasks run one per loop iteration, so input stays responsive.
+    /// If the first frame is already out, it's the same as post_task().
+    void defer(Task task);
+
+    /// @brief Prints the startup breakdown when the first frame is out (default on)
+    void set_report_enabled(bool enabled);
+
+    /// @brief Logs the phases recorded so far and the time to first frame
+    void report();
+
+    /// @brief Copies the recorded phases, oldest first
+    /// @return How many got copied
+    std::size_t phases(Phase* out, std::size_t max);
+
+    /// @brief Time from library load to the first presented frame, 0 if it didn't happen yet
+    int64_t time_to_first_frame_ns();
+
+    /// @brief Marks the first frame as presented and starts the deferred work
+    /// @warning Is an internal method, the main loop calls it
+    void _first_frame_presented();
+}
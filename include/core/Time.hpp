@@ -0,0 +1,130 @@
+// --------------------------
+//  File: Time.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace mayak::core::time {
+    /// @brief Monotonic time in nanoseconds, the one clock everything in MayakUI uses
+    int64_t now_ns();
+
+    /// @brief Nanoseconds -> seconds
+    constexpr double to_seconds(int64_t ns) { return ns * 1e-9; }
+
+    /// @brief Seconds -> nanoseconds
+    constexpr int64_t to_ns(double seconds) { return static_cast<int64_t>(seconds * 1e9); }
+
+    /// @brief Percentiles over the recent frame times, all in nanoseconds
+    struct FrameStats {
+        int64_t p50 = 0, p95 = 0, p99 = 0, max = 0;
+        int64_t average = 0;
+        std::size_t count = 0;
+    };
+
+    /// @brief Rolling window of the last HISTORY_SIZE frame times
+    class FrameHistory {
+    public:
+        static constexpr std::size_t HISTORY_SIZE = 240;
+
+        void Push(int64_t frameNs);
+        void Clear() { total = 0; }
+
+        std::size_t Count() const { return total < HISTORY_SIZE ? total : HISTORY_SIZE; }
+
+        /// @brief Sorts a copy of the window, so call it once in a while, not per widget
+        FrameStats Stats() const;
+
+    private:
+        std::array<int64_t, HISTORY_SIZE> samples{};
+        std::size_t total = 0;
+    };
+
+    /// @brief Measures the time between frames
+    class FrameClock {
+    public:
+        /// @brief What SmoothedDelta() says before there's a frame to go on, 60 Hz
+        static constexpr double NOMINAL_FRAME_SECONDS = 1.0 / 60.0;
+
+        /// @brief Marks the start of a new frame, call once per frame
+        void Tick() { Tick(now_ns()); }
+        void Tick(int64_t nowNs);
+
+        /// @brief Start time of the current frame
+        int64_t FrameStartNs() const { return frameStart; }
+
+        /// @brief Raw time since the previous frame
+        int64_t DeltaNs() const { return delta; }
+        double Delta() const { return to_seconds(delta); }
+
+        /// @brief Exponentially smoothed delta, good for animation speed
+        double SmoothedDelta() const { return smoothed; }
+
+        uint64_t FrameIndex() const { return frame; }
+
+        /// @brief The next Tick() comes after a pause (minimized window etc.)
+        ///
+        /// Its delta is still the real elapsed time, but it stays out of the
+        /// smoothed delta and the history, and FastForwarded() is true for that frame.
+        void MarkResumed() { resumed = true; }
+
+        /// @brief This frame follows a pause, jump animations to where they'd be
+        /// instead of stepping through the whole gap
+        bool FastForwarded() const { return fastForwarded; }
+
+        const FrameHistory& History() const { return history; }
+
+    private:
+        int64_t frameStart = 0;
+        int64_t delta = 0;
+        double smoothed = NOMINAL_FRAME_SECONDS; // until the first measured frame
+        uint64_t frame = 0;
+        bool resumed = false;
+        bool fastForwarded = false;
+        FrameHistory history;
+    };
+
+    /// @brief Fixed timestep accumulator for animations and simulations
+    ///
+    /// Feed it the frame delta, then run your update Advance() times with
+    /// Step() seconds each, and interpolate the rendering with Alpha().
+    class FixedStep {
+    public:
+        /// @param stepSeconds Length of one step, e.g. 1.0 / 120
+        /// @param maxSteps Most steps per frame, the rest is dropped so a long hitch can't snowball
+        explicit FixedStep(double stepSeconds = 1.0 / 120.0, int maxSteps = 8);
+
+        /// @brief Adds deltaSeconds to the accumulator
+        /// @return How many steps to run this frame
+        int Advance(double deltaSeconds);
+
+        /// @brief How far we are into the next step, 0..1
+        double Alpha() const { return accumulator / step; }
+
+        double Step() const { return step; }
+
+        /// @brief Forgets the leftover time
+        void Reset() { accumulator = 0; }
+
+    private:
+        double step;
+        int maxSteps;
+        double accumulator = 0;
+    };
+
+    /// @brief The clock the main loop ticks every frame
+    FrameClock& frame_clock();
+
+    /// @brief Raw delta of the current frame in seconds
+    double delta();
+
+    /// @brief Smoothed delta of the current frame in seconds
+    double smoothed_delta();
+
+    /// @brief The current frame follows a pause, see FrameClock::FastForwarded()
+    bool fast_forwarded();
+}
@@ -0,0 +1,55 @@
+// --------------------------
+//  File: TripleBuffer.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace mayak::core {
+    /// @brief Lock-free single producer / single consumer mailbox
+    ///
+    /// The producer always has a slot to write into and the consumer always has
+    /// the newest finished one, neither ever waits for the other. If the consumer
+    /// is slower, frames it didn't get to are simply overwritten (newest wins).
+    /// Slots are reused, so keep containers inside T and they stop allocating.
+    template <typename T>
+    class TripleBuffer {
+    public:
+        /// @brief Producer side: the slot to fill
+        T& WriteBuffer() { return slots[writeIndex]; }
+
+        /// @brief Producer side: hands the filled slot over, WriteBuffer() is another one after this
+        void Publish() {
+            uint8_t previous = middle.exchange(static_cast<uint8_t>(writeIndex | FRESH), std::memory_order_acq_rel);
+            writeIndex = previous & INDEX_MASK;
+        }
+
+        /// @brief Consumer side: grabs the newest published slot, if there is one
+        /// @return True if ReadBuffer() changed
+        bool Acquire() {
+            if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+            uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+            readIndex = previous & INDEX_MASK;
+            return true;
+        }
+
+        /// @brief Consumer side: true if Acquire() would get something new
+        bool HasFresh() const { return middle.load(std::memory_order_acquire) & FRESH; }
+
+        /// @brief Consumer side: the slot from the last successful Acquire()
+        const T& ReadBuffer() const { return slots[readIndex]; }
+
+    private:
+        static constexpr uint8_t INDEX_MASK = 0x3;
+        static constexpr uint8_t FRESH = 0x4;
+
+        std::array<T, 3> slots{};
+        uint8_t writeIndex = 0;  // only the producer touches it
+        uint8_t readIndex = 1;   // only the consumer touches it
+        std::atomic<uint8_t> middle{2};
+    };
+}
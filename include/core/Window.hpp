@@ -1,23 +1,167 @@
-#include "utils/Logger.hpp"
-#include <GLFW/glfw3.h>
+// --------------------------
+//  File: Window.hpp -> MayakUI
+//  Made with love by Maya4ok
+// --------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <map>
+#include <vector>
+
+#include "utils/vec2.hpp"
+
+// No GLFW include here on purpose, glad has to come before it wherever GL is used
+struct GLFWwindow;
 
-class Window;
+namespace mayak::gfx {
+    struct ClipRect;
+    class PartialRedraw;
+}
 
-namespace mayak::core{
-    std::map<int, Window*> windows;
+namespace mayak::core {
+    class Window;
+
+    /// @brief Draws one window, its GL context is current when this gets called
+    using DrawCallback = void(*)(Window& window);
+
+    /// @brief A native window with its own GL context
+    ///
+    /// Every context shares objects with one hidden root context, so textures,
+    /// buffers and shaders made in any window work in all of them and only get
+    /// uploaded once. VAOs and framebuffers are *not* shared by GL, those stay per window.
     class Window {
     private:
-        GLFWwindow* window;
+        GLFWwindow* window = nullptr;
         int width, height;
+        int framebufferWidth = 0, framebufferHeight = 0; // pixels, differs from width/height on HiDPI
+        float contentScaleX = 1, contentScaleY = 1;
+        int id;
+        bool minimized = false;
+        bool focused = true;
+        int swapInterval = -100; // what the context has now, -100 = never set
+        DrawCallback drawCallback = nullptr;
+
+        // Headless windows draw here instead of the (nonexistent) default framebuffer
+        unsigned int fbo = 0, colorBuffer = 0, depthBuffer = 0;
+        int fboWidth = 0, fboHeight = 0;
+        void UpdateOffscreenTarget();
+
+        // Set = partial redraw, the last frame stays in there and only damage gets drawn
+        std::unique_ptr<gfx::PartialRedraw> partialRedraw;
+        int redrawRegion[4] = {0, 0, -1, -1}; // x, y, width, height of the region being drawn
+        bool bufferAgeSupported = false;
+        void DrawPartial();
+
+        friend void render_windows();
+
     public:
         Window(int w, int h, const std::string& title);
         ~Window();
 
+        Window(const Window&) = delete;
+        Window& operator=(const Window&) = delete;
+
         int GetWidth() const { return width; }
         int GetHeight() const { return height; }
+        int GetFramebufferWidth() const { return framebufferWidth; }
+        int GetFramebufferHeight() const { return framebufferHeight; }
+
+        /// @brief What the OS asks UI to be scaled by, 2 on a typical "retina" display
+        /// @note Widgets work in logical units (GetWidth() / GetHeight()), GL in pixels,
+        /// convert between them with GetPixelRatio()
+        vec2 GetContentScale() const { return vec2(contentScaleX, contentScaleY); }
+
+        /// @brief Framebuffer pixels per window unit, what logical coordinates get multiplied by
+        /// @note Not the content scale: on macOS / Wayland the two match, but on Windows and X11
+        /// the window is already sized in pixels and this stays 1 whatever the content scale says
+        vec2 GetPixelRatio() const {
+            if (width <= 0 || height <= 0) return vec2(1, 1); // minimized, nothing gets drawn anyway
+            return vec2(float(framebufferWidth) / width, float(framebufferHeight) / height);
+        }
+
+        /// @brief Logical position / size -> framebuffer pixels
+        vec2 ToPixels(const vec2& logical) const { return logical * GetPixelRatio(); }
+        int GetId() const { return id; }
+        GLFWwindow* GetHandle() const { return window; }
+
+        /// @brief False if creating the native window failed
+        bool IsOpen() const { return window != nullptr; }
+
+        bool IsMinimized() const { return minimized; }
+        bool IsFocused() const { return focused; }
 
-        // add setters later
+        /// @brief Not minimized and the framebuffer isn't zero-sized, so drawing makes sense
+        bool IsDrawable() const { return window && !minimized && framebufferWidth > 0 && framebufferHeight > 0; }
+
+        /// @brief User clicked the close button (or someone called RequestClose())
+        bool ShouldClose() const;
+        void RequestClose();
+
+        void SetDrawCallback(DrawCallback callback) { drawCallback = callback; }
+
+        /// @brief Only redraw what changed, see Invalidate(position, size)
+        ///
+        /// The frame stays in an offscreen framebuffer. The draw callback runs once per
+        /// damaged region, with the scissor set to GetRedrawRegion(); pass that to
+        /// QuadBatch::Begin() too, the batch sets its own scissors and skips everything outside.
+        /// Frames without damage don't draw or swap at all. With *_EXT_buffer_age only
+        /// what the back buffer is missing gets copied over, otherwise the whole frame.
+        /// @note Not while the render thread is drawing
+        void SetPartialRedraw(bool enabled);
+        bool IsPartialRedraw() const { return partialRedraw != nullptr; }
+
+        /// @brief Marks a rectangle (logical units) as changed and asks for a frame. Thread-safe
+        void Invalidate(const vec2& position, const vec2& size);
+        /// @brief Marks the whole window as changed and asks for a frame. Thread-safe
+        void Invalidate();
+
+        /// @brief The part being drawn right now in framebuffer pixels, "no clip" if it's all of it
+        gfx::ClipRect GetRedrawRegion() const;
+
+        /// @brief nullptr without partial redraw
+        const gfx::PartialRedraw* GetPartialRedraw() const { return partialRedraw.get(); }
+
+        /// @brief Makes this window's context current, free if it already is
+        void MakeCurrent();
+
+        /// @brief The framebuffer to draw into, the offscreen FBO when headless, 0 otherwise
+        unsigned int GetFramebuffer() const { return fbo; }
+
+        /// @brief Reads the rendered frame back as RGBA8, top row first, in framebuffer pixels
+        ///
+        /// Headless windows keep the last frame in their FBO, so this works any time.
+        /// For visible windows call it from the draw callback, before the buffers get swapped.
+        /// @param out Gets resized to framebuffer width * height * 4
+        /// @return False if there's nothing to read
+        bool ReadPixels(std::vector<uint8_t>& out);
+
+        /// @internal Updates the cached state, GLFW callbacks call these
+        void _set_size(int w, int h) { width = w; height = h; }
+        void _set_framebuffer_size(int w, int h) { framebufferWidth = w; framebufferHeight = h; }
+        void _set_minimized(bool value) { minimized = value; }
+        void _set_focused(bool value) { focused = value; }
+        void _set_content_scale(float x, float y) { contentScaleX = x; contentScaleY = y; }
     };
-};
\ No newline at end of file
+
+    /// @brief All open windows, in creation order
+    const std::vector<Window*>& windows();
+
+    /// @brief Called when a window's content scale changes (moved to another monitor etc.)
+    using ContentScaleCallback = void(*)(Window& window, float oldScale, float newScale);
+    void set_content_scale_callback(ContentScaleCallback callback);
+
+    /// @brief The hidden context every window shares objects with
+    /// @return nullptr until the first window gets created
+    GLFWwindow* shared_context();
+
+    /// @brief Makes the shared context current, for uploading resources without a window
+    void make_shared_context_current();
+
+    /// @brief Draws and presents every window in one pass
+    ///
+    /// Walks the windows in order so there's one context switch per window at most,
+    /// and only the last one waits for vsync, so N windows don't take N vblanks.
+    void render_windows();
+}
@@ -1,3 +1,5 @@
+#pragma once
+
 namespace mayak {
     enum class EventType {
         None,
@@ -6,8 +6,21 @@
 #pragma once
 
 #include <unordered_set>
+#include <cstddef>
+#include <cstdint>
+
+#include "utils/vec2.hpp"
 
 namespace mayak::core::input {
+    /// @brief One raw pointer sample, exactly as the platform reported it
+    struct PointerSample {
+        float x = 0, y = 0;  // position in window pixels, sub-pixel precise
+        int64_t timeNs = 0;  // monotonic timestamp in nanoseconds
+    };
+
+    /// @brief How many samples the pointer ring keeps (older ones get overwritten)
+    constexpr std::size_t POINTER_HISTORY_SIZE = 128;
+
     /// @brief Tells if key's pressed
     /// @param key 
     /// @return True / False or Pressed / Not
@@ -35,6 +48,28 @@ namespace mayak::core::input {
     /// @brief Where's the mouse? – tells mouse Y position
     int mouse_y();
 
+    /// @brief How many pointer samples arrived during the current frame
+    /// @note Capped at POINTER_HISTORY_SIZE, if more came in the oldest are gone
+    std::size_t pointer_sample_count();
+
+    /// @brief Gives you one pointer sample of the current frame
+    /// @param index 0 is the oldest sample of the frame, pointer_sample_count() - 1 the newest
+    /// @return The sample, or a zeroed one if index is out of range
+    PointerSample pointer_sample(std::size_t index);
+
+    /// @brief Pointer velocity in pixels per second, fitted over the last few samples
+    /// @return (0, 0) if the pointer hasn't moved recently
+    vec2 pointer_velocity();
+
+    /// @brief Guesses where the pointer will be at presentTimeNs
+    ///
+    /// Fits a line through the recent samples and extrapolates it, so drawing can
+    /// follow the finger / mouse one frame ahead instead of lagging behind it.
+    /// The extrapolation is clamped to a short horizon, so it never flies off.
+    /// @param presentTimeNs Expected present time, same clock as PointerSample::timeNs
+    /// @return Predicted position, or the last known one if there's nothing to go on
+    vec2 predict_pointer(int64_t presentTimeNs);
+
     //  -------------------------------------
     //  Internal methods (don't touch it pls 🙏)
     //  -------------------------------------
@@ -64,4 +99,15 @@ namespace mayak::core::input {
     /// @param y  New mouse Y position
     /// @warning Is an internal method so don't touch it, i think
     void _set_mouse_pos(int x, int y);
+
+    /// @brief Records a raw pointer sample into the ring and updates mouse position
+    /// @param x Pointer X position, sub-pixel
+    /// @param y Pointer Y position, sub-pixel
+    /// @param timeNs When the sample happened, monotonic nanoseconds
+    /// @warning Is an internal method so don't touch it, i think
+    void _push_pointer_sample(float x, float y, int64_t timeNs);
+
+    /// @brief Starts a new frame, samples pushed after this belong to it
+    /// @warning Is an internal method so don't touch it, i think
+    void _begin_pointer_frame();
 }
\ No newline at end of file
@@ -0,0 +1,188 @@
+// Atlas.hpp
+
+// Icons, images and glyphs all want a texture, and a texture bind per item
+// splits every batch. This packs them into a few big pages instead, one
+// texture array for everything, so a whole UI draws from one texture.
+
+#pragma once
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mayak::gfx {
+
+    /// @brief Skyline bottom-left packer: fast, good enough for UI sized images
+    ///
+    /// Keeps the top edge of everything placed as a list of segments and puts each
+    /// new rect where its bottom ends up lowest. Can't free single rects, the atlas
+    /// handles that by repacking (TextureAtlas::Compact()).
+    class SkylinePacker {
+    public:
+        SkylinePacker(int width = 0, int height = 0) { Reset(width, height); }
+
+        void Reset(int width, int height);
+        void Reset() { Reset(width, height); }
+
+        /// @return False if it doesn't fit anywhere
+        bool Insert(int rectWidth, int rectHeight, int& x, int& y);
+
+        int Width() const { return width; }
+        int Height() const { return height; }
+
+        /// @brief Area of everything inserted since the last Reset()
+        uint64_t UsedArea() const { return usedArea; }
+
+        /// @brief UsedArea() / page area
+        float Occupancy() const;
+
+    private:
+        struct Segment {
+            int x, y, width; // y = where free space starts below this segment
+        };
+
+        /// @brief Where a rect starting at segment `index` would sit, -1 if it can't
+        int FitAt(std::size_t index, int rectWidth, int rectHeight) const;
+
+        int width = 0, height = 0;
+        std::vector<Segment> skyline;
+        uint64_t usedArea = 0;
+    };
+
+    /// @brief Where an image ended up: a layer of the texture array and the rect in it
+    struct AtlasRegion {
+        int page = -1;
+        int x = 0, y = 0, width = 0, height = 0; // pixels, without the padding
+        float u0 = 0, v0 = 0, u1 = 0, v1 = 0;
+    };
+
+    struct AtlasStats {
+        uint64_t inserts = 0;
+        uint64_t hits = 0;        // Find() that found something
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t compactions = 0;
+        uint64_t failures = 0;    // too big for a page, or full of images the frame uses
+        uint64_t bytesUploaded = 0;
+    };
+
+    struct AtlasOptions {
+        int pageSize = 1024;
+        int maxPages = 4;                  // all layers get allocated in Create()
+        GLenum internalFormat = GL_RGBA8;  // GL_R8 for coverage-only glyphs
+        int padding = 1;                   // empty pixels around every image, against filtering bleed
+        float compactThreshold = 0.3f;     // wasted / packed area of a page before it's worth repacking
+    };
+
+    /// @brief Texture array of skyline-packed pages with LRU eviction
+    ///
+    /// Images get uploaded one by one with glTexSubImage3D as they come in. When
+    /// all pages are full, the least recently used images get evicted and their
+    /// page repacked. Repacking copies the survivors on the GPU (GL 4.3), without
+    /// that it evicts the whole page and the images come back on their next miss.
+    ///
+    /// Quads already in the batch keep the UVs they were given, so Insert() never
+    /// evicts or moves anything on a page the current frame (core::frame_count())
+    /// has used. If that leaves no room, it returns nullptr and makes the room on
+    /// the first call of the next frame; ask again then.
+    ///
+    /// Without Create() it runs CPU-only: packing and bookkeeping, no uploads. Tests use that.
+    /// @warning Compact(), CompactFragmented(), Remove() and Clear() don't look at the
+    /// frame, call them between frames.
+    class TextureAtlas {
+    public:
+        explicit TextureAtlas(const AtlasOptions& options = AtlasOptions{});
+
+        TextureAtlas(const TextureAtlas&) = delete;
+        TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+        /// @brief Allocates the texture array, needs a GL context
+        bool Create();
+        /// @brief Frees the textures, the destructor doesn't (it may not have a context)
+        void Destroy();
+
+        /// @brief The image's region, and marks it as used. nullptr if it isn't in here
+        const AtlasRegion* Find(uint64_t key);
+
+        /// @brief Packs and uploads an image, replacing whatever `key` had before
+        /// @param pixels Tightly packed rows in the atlas format (RGBA8 or R8), may be null in CPU-only mode
+        /// @return nullptr if it's bigger than a page, or this frame's images leave no room
+        const AtlasRegion* Insert(uint64_t key, int width, int height, const void* pixels);
+
+        void Remove(uint64_t key);
+        void Clear();
+
+        /// @brief An image this big fits a page with its padding, Insert() refuses it otherwise
+        bool CanHold(int width, int height) const {
+            return width + 2 * options.padding <= options.pageSize && height + 2 * options.padding <= options.pageSize;
+        }
+
+        /// @brief Area lost to removed images on a page: 1 - live / packed
+        float Fragmentation(int page) const;
+
+        /// @brief Repacks a page, only the live images stay
+        void Compact(int page);
+
+        /// @brief Repacks pages past the threshold, call it between frames
+        /// @return How many pages got repacked
+        int CompactFragmented();
+
+        GLuint Texture() const { return texture; }
+        int PageSize() const { return options.pageSize; }
+        int PagesInUse() const;
+        std::size_t Count() const { return entries.size(); }
+
+        /// @brief Live image area / area of the pages in use
+        float Efficiency() const;
+
+        const AtlasStats& Stats() const { return stats; }
+
+        /// @brief Goes up whenever an image leaves or moves, copies of regions older than that may be wrong
+        uint64_t Generation() const { return generation; }
+
+    private:
+        static constexpr uint64_t NEVER = ~0ull;
+
+        struct Page {
+            SkylinePacker packer;
+            uint64_t liveArea = 0;          // padded, so it compares to packer.UsedArea()
+            bool inUse = false;
+            std::list<uint64_t> lru;        // keys on this page, least recently used first
+            uint64_t lastUsedFrame = NEVER; // the frame's quads may point in here, nothing on it moves
+        };
+        struct Entry {
+            AtlasRegion region;
+            std::list<uint64_t>::iterator lru; // in its page's list
+        };
+
+        bool Place(int page, int paddedWidth, int paddedHeight, AtlasRegion& region);
+        void SetRegion(AtlasRegion& region, int page, int x, int y, int width, int height) const;
+        void Upload(const AtlasRegion& region, const void* pixels);
+        /// @brief Moves the entry to the back of its page's LRU list, marks both used this frame
+        void Touch(Entry& entry);
+        /// @brief First call of a new frame: makes the room the last frame asked for
+        void BeginFrame();
+        /// @brief Evicts the page's oldest images and repacks it until a padded rect that big fits
+        bool MakeRoom(int page, int paddedWidth, int paddedHeight);
+        /// @brief Would Place() work, without placing anything
+        bool Fits(int page, int paddedWidth, int paddedHeight) const;
+        /// @brief Pages the current frame hasn't used, least recently used first
+        std::vector<int> PagesOldestFirst() const;
+        void Forget(std::unordered_map<uint64_t, Entry>::iterator it);
+
+        AtlasOptions options;
+        bool warnedFull = false;
+        GLuint texture = 0;
+        GLuint scratch = 0; // compaction target, made on first use
+        std::vector<Page> pages;
+        std::unordered_map<uint64_t, Entry> entries;
+        std::vector<uint8_t> staging; // padded pixels for Upload()
+        uint64_t frame = NEVER;       // core::frame_count() at the last call
+        std::vector<std::pair<int, int>> refused; // padded sizes refused this frame, the next makes room
+        uint64_t generation = 0;
+        AtlasStats stats;
+    };
+}
@@ -0,0 +1,239 @@
+// Batch.hpp
+
+// Widgets throw quads and rounded rects in here one by one, the batch turns them
+// into as few draw calls as it can. Everything of a flush goes into the stream
+// buffer at once, and a new draw call only starts when the texture, shader or
+// distance field style changes. Rectangular clips are tested in the shaders
+// against a per-flush table, so scroll views and nested panels don't split
+// anything; only custom shaders fall back to the scissor, and rounded or rotated
+// clips to the stencil buffer.
+
+#pragma once
+#include "gfx/Atlas.hpp"
+#include "gfx/Renderer.hpp"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace mayak::gfx {
+
+    /// @brief Scissor rectangle in framebuffer pixels, top-left origin like everything else here
+    struct ClipRect {
+        int x = 0, y = 0;
+        int width = -1, height = -1; // negative = no clipping
+
+        bool IsNone() const { return width < 0 || height < 0; }
+        bool operator==(const ClipRect& other) const {
+            if (IsNone() || other.IsNone()) return IsNone() == other.IsNone();
+            return x == other.x && y == other.y && width == other.width && height == other.height;
+        }
+        bool operator!=(const ClipRect& other) const { return !(*this == other); }
+    };
+
+    /// @brief Where both a and b are, "no clip" counts as everything. Disjoint = zero-sized, not none
+    inline ClipRect Intersect(const ClipRect& a, const ClipRect& b) {
+        if (a.IsNone()) return b;
+        if (b.IsNone()) return a;
+        int left = a.x > b.x ? a.x : b.x, top = a.y > b.y ? a.y : b.y;
+        int right = a.x + a.width < b.x + b.width ? a.x + a.width : b.x + b.width;
+        int bottom = a.y + a.height < b.y + b.height ? a.y + a.height : b.y + b.height;
+        return ClipRect{left, top, right > left ? right - left : 0, bottom > top ? bottom - top : 0};
+    }
+
+    /// @brief How distance field quads get shaded, widths in field units (0.5 = the field's whole spread)
+    struct DistanceFieldStyle {
+        float outlineWidth = 0;   // grows outwards from the edge, 0 = no outline
+        uint32_t outlineColor = 0;
+        float glowWidth = 0;      // soft falloff outside the outline, 0 = no glow
+        uint32_t glowColor = 0;
+        float weight = 0;         // > 0 bolder, < 0 thinner
+
+        bool operator==(const DistanceFieldStyle& other) const {
+            return outlineWidth == other.outlineWidth && outlineColor == other.outlineColor
+                && glowWidth == other.glowWidth && glowColor == other.glowColor && weight == other.weight;
+        }
+        bool operator!=(const DistanceFieldStyle& other) const { return !(*this == other); }
+    };
+
+    /// Why draw calls happened, watch the *Breaks to see what splits batches
+    struct BatchStats {
+        uint64_t quads = 0;
+        uint64_t roundedRects = 0;
+        uint64_t drawCalls = 0;
+        uint64_t flushes = 0;
+        uint64_t textureBreaks = 0;
+        uint64_t shaderBreaks = 0;
+        uint64_t clipBreaks = 0;      // scissor changed, only custom shaders clip that way
+        uint64_t styleBreaks = 0;     // distance field style changed, it's uniforms
+        uint64_t blendBreaks = 0;     // premultiplied and straight alpha programs took turns
+        uint64_t overflowFlushes = 0; // MAX_BATCH_QUADS or MAX_CLIP_RECTS reached mid-frame
+        uint64_t clipOverflows = 0;   // ... of those, MAX_CLIP_RECTS different clips in one flush
+        uint64_t stencilClips = 0;    // rounded / rotated clips pushed
+        uint64_t stencilBreaks = 0;   // flushes those cost, two per push and two per pop
+        uint64_t culled = 0;          // completely outside Begin()'s bounds, never left the CPU
+    };
+
+    /// @brief Collects quads and rounded rects on the CPU and draws them in runs of equal state
+    ///
+    /// Draw order is kept, a rounded rect drawn after a quad ends up on top of it.
+    /// Usage per frame: Begin(), any number of Draw*() / PushClip() / PopClip() /
+    /// SetShader(), End(). Call Flush() yourself before drawing something with raw GL in between.
+    /// Custom shaders need the same attributes (aPos, aUV, aColor) and uTransform as the default one.
+    /// Stencil clips need a stencil buffer in whatever is being drawn to.
+    class QuadBatch {
+    public:
+        explicit QuadBatch(RendererContext& ctx);
+
+        QuadBatch(const QuadBatch&) = delete;
+        QuadBatch& operator=(const QuadBatch&) = delete;
+
+        /// @brief Starts a frame, coordinates are framebuffer pixels of the given size
+        /// @param bounds Only this part gets drawn, e.g. a damaged region. Every clip gets
+        /// intersected with it and whatever lies completely outside is dropped right away
+        void Begin(int framebufferWidth, int framebufferHeight, const ClipRect& bounds = ClipRect{});
+
+        void DrawRect(float x, float y, float width, float height, uint32_t color);
+        void DrawTexturedRect(float x, float y, float width, float height, GLuint texture,
+                              float u0 = 0, float v0 = 0, float u1 = 1, float v1 = 1,
+                              uint32_t tint = PackColor(255, 255, 255));
+
+        /// @brief An image from a TextureAtlas, every image of the atlas batches together
+        void DrawAtlasRect(float x, float y, float width, float height, const TextureAtlas& atlas,
+                           const AtlasRegion& region, uint32_t tint = PackColor(255, 255, 255));
+
+        /// @brief A distance field image from an atlas, shaded with the current DistanceFieldStyle
+        void DrawDistanceFieldRect(float x, float y, float width, float height, const TextureAtlas& atlas,
+                                   const AtlasRegion& region, uint32_t color);
+
+        /// @brief Any 4 corners, in 0 1 2 3 winding (triangles 0 1 2 and 2 3 0)
+        /// @param texture 0 = plain color
+        void DrawQuad(const QuadVertex (&corners)[4], GLuint texture);
+
+        /// @brief Instanced SDF rounded rect, clipId gets overwritten with the current clip
+        void DrawRoundedRect(const RoundedRectInstance& rect);
+        void DrawRoundedRect(float x, float y, float width, float height, float radius, uint32_t fill,
+                             uint32_t border = 0, float borderWidth = 0);
+
+        /// @brief Shader for the quads after this, 0 = the default one (rounded rects have their own)
+        /// @param premultiplied It outputs premultiplied alpha, blended with ONE, ONE_MINUS_SRC_ALPHA.
+        /// FEATURE_PREMULTIPLIED variants of ctx's quad shaders are recognized without it
+        void SetShader(GLuint program, bool premultiplied = false);
+
+        /// @brief Replaces the innermost rectangular clip, the stack stays as it is
+        void SetClip(const ClipRect& clip);
+        void ClearClip() { SetClip(ClipRect{}); }
+        /// @brief The rectangular clip right now, without the bounds
+        const ClipRect& Clip() const { return clip; }
+        const ClipRect& Bounds() const { return bounds; }
+
+        /// @brief Clips what comes next to clip as well, until PopClip(). Free, tested in the shaders
+        void PushClip(const ClipRect& clip);
+        /// @brief Rounded corners go through the stencil buffer, radius 0 is a plain PushClip()
+        void PushRoundedClip(float x, float y, float width, float height, float radius);
+        /// @brief Any convex quad, e.g. a rotated panel, through the stencil buffer unless it's axis-aligned
+        void PushClip(const QuadVertex (&corners)[4]);
+        /// @brief Back to the clip before the last Push*Clip()
+        void PopClip();
+        /// @brief How many pushes are open
+        int ClipDepth() const { return int(clipStack.size()); }
+        /// @brief Nested stencil clips right now, 255 at most
+        int StencilDepth() const { return stencilDepth; }
+
+        /// @brief Style for the distance field quads after this, quads sharing one batch together
+        void SetDistanceFieldStyle(const DistanceFieldStyle& style);
+
+        /// @brief Uploads everything and draws it, one draw call per run
+        void Flush();
+
+        /// @brief Flushes and closes the frame's stats
+        void End();
+
+        /// @brief Throws away everything pending without drawing it, e.g. for a skipped frame
+        void Discard();
+
+        /// @brief Quads waiting for the next Flush()
+        int PendingQuads() const { return quadCount; }
+        int PendingRoundedRects() const { return int(instances.size()); }
+        /// @brief 4 per pending quad, as they'll be uploaded
+        const QuadVertex* PendingVertices() const { return vertices.data(); }
+
+        /// @brief Draw calls the next Flush() will make
+        int PendingRuns() const { return int(runs.size()); }
+
+        const BatchStats& Stats() const { return stats; }
+        const BatchStats& LastFrameStats() const { return lastFrame; }
+
+    private:
+        enum class RunKind { Quads, RoundedRects };
+
+        /// @brief What PopClip() goes back to, and the shape to take out of the stencil again
+        struct ClipLevel {
+            ClipRect saved;
+            bool stencil;
+            bool rounded;
+            RoundedRectInstance roundedShape;
+            QuadVertex quadShape[4];
+        };
+
+        struct Run {
+            RunKind kind;
+            GLenum textureTarget;
+            GLuint texture;
+            GLuint program;
+            ClipRect clip;
+            uint32_t style; // index into styles, 0 = default
+            bool premultiplied; // blend with ONE instead of SRC_ALPHA
+            int first;  // quad or instance index
+            int count;
+        };
+
+        /// @brief Room for one quad, opens a new run if the state differs from the last one
+        /// @param clipSlot Gets the uClipRects slot to put in the vertices
+        QuadVertex* Push(GLuint texture, GLenum target, uint16_t& clipSlot);
+        void AddToRun(RunKind kind, GLenum target, GLuint texture, GLuint program, const ClipRect& runClip, int first,
+                      uint32_t runStyle = 0, bool runPremultiplied = false);
+        void FlushIfFull();
+        /// @brief uClipRects slot of the current clip, may flush when they're all taken
+        uint32_t CurrentClipId();
+        GLint TransformLocation(GLuint program);
+        /// @brief Distance field uniforms, the program has to be in use
+        void ApplyStyle(const DistanceFieldStyle& style);
+        /// @brief Completely outside the bounds, counts it
+        bool Culled(float x, float y, float width, float height);
+        /// @brief program knows uClipRects, otherwise its runs get scissored
+        bool ClipsInShader(GLuint program) const;
+        GLint ClipRectsLocation(GLuint program);
+        /// @brief Adds (push) or removes (pop) the level's shape to the stencil, flushing before and after
+        void DrawStencilShape(const ClipLevel& level, bool push);
+        /// @brief Stencil test for the runs drawn now
+        void ApplyStencil();
+
+        RendererContext& ctx;
+        int framebufferWidth = 0, framebufferHeight = 0;
+        GLuint program = 0; // 0 = ctx.shaderProgram
+        ClipRect clip;
+        ClipRect bounds;
+        ClipRect drawClip; // clip within bounds, what actually gets drawn
+        bool programClipsInShader = true;
+        bool programPremultiplied = false;
+        std::vector<ClipLevel> clipStack;
+        int stencilDepth = 0;
+        bool stencilCleared = false; // this frame
+        bool writingStencil = false;
+
+        std::vector<QuadVertex> vertices; // fixed size, quadCount says how much is used
+        int quadCount = 0;
+        std::vector<RoundedRectInstance> instances;
+        std::vector<Run> runs;
+        std::vector<ClipRect> clipRects; // this flush's uClipRects, [0] is the "no clip" dummy
+        uint32_t clipId = 0;
+        bool clipIdValid = false;
+        std::vector<DistanceFieldStyle> styles;  // this flush's, [0] is the default
+        uint32_t styleIndex = 0;
+        std::vector<std::pair<GLuint, GLint>> transformLocations; // custom shaders
+        std::vector<std::pair<GLuint, GLint>> clipRectsLocations;
+
+        BatchStats stats, lastFrame;
+    };
+}
@@ -0,0 +1,184 @@
+// CommandList.hpp
+
+// Widgets record what they'd draw instead of drawing it: small commands in an
+// arena, each with a 64-bit sort key and the box it draws in. Sorting brings
+// commands with the same shader and texture together where they don't overlap,
+// so replaying them through the QuadBatch makes fewer, bigger runs. A list can also be kept and replayed as is, e.g. for a
+// subtree that didn't change. Something else than the batch can replay them
+// too through CommandTarget, the software renderer does.
+
+#pragma once
+#include "gfx/Batch.hpp"
+#include "gfx/GlyphCache.hpp"
+#include "gfx/SdfText.hpp"
+#include "core/FrameArena.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace mayak::gfx {
+
+    /// @brief What a command's sort key groups by, in the order they end up in within one depth
+    enum class SortPipeline : uint16_t {
+        Quads = 1,
+        Atlas,
+        DistanceField,
+        RoundedRects,
+        Custom = 0xFFF,
+    };
+
+    /// @brief layer:8 | depth:16 | pipeline:12 | texture:28, most significant first
+    ///
+    /// Layers go on top of each other (popups, tooltips), depth is painter's order
+    /// within a layer. Pipeline and texture only decide the order of commands at the
+    /// same layer and depth that don't overlap, that's where merging comes from.
+    constexpr uint64_t MakeSortKey(uint8_t layer, uint16_t depth, uint16_t pipeline, uint32_t texture) {
+        return (uint64_t(layer) << 56) | (uint64_t(depth) << 40) | (uint64_t(pipeline & 0xFFF) << 28)
+             | (texture & 0xFFFFFFFu);
+    }
+
+    enum class CommandType : uint8_t {
+        Rect,
+        Image,
+        AtlasImage,
+        RoundedRect,
+        Text,
+        DistanceFieldText,
+        Custom,
+    };
+
+    class CommandTarget;
+
+    /// @brief Recorded drawing, sorted and replayed into a QuadBatch
+    ///
+    /// Commands with the same layer and depth only get reordered among each other
+    /// where they don't overlap, so a background stays under the text on it. Text
+    /// counts with a generous box (it isn't laid out yet) and custom commands with
+    /// the whole screen. Depth still orders whole groups, the default is everything at 0, 0.
+    /// Clips are resolved while recording, each command remembers its own, so
+    /// sorting can't move a command out of its clip.
+    class CommandList {
+    public:
+        /// @brief Draws custom stuff in replay order. Flush the batch first if it uses raw GL
+        using CustomFn = void (*)(QuadBatch& batch, const void* data);
+
+        explicit CommandList(std::size_t arenaSize = 64 * 1024) : arena(arenaSize) {}
+
+        CommandList(const CommandList&) = delete;
+        CommandList& operator=(const CommandList&) = delete;
+
+        void SetLayer(uint8_t newLayer) { layer = newLayer; }
+        void SetDepth(uint16_t newDepth) { depth = newDepth; }
+        uint8_t Layer() const { return layer; }
+        uint16_t Depth() const { return depth; }
+
+        /// @brief Clips the commands after this to clip, intersected with the current one
+        void PushClip(const ClipRect& clip);
+        void PopClip();
+
+        void DrawRect(float x, float y, float width, float height, uint32_t color);
+        void DrawImage(float x, float y, float width, float height, GLuint texture,
+                       float u0 = 0, float v0 = 0, float u1 = 1, float v1 = 1,
+                       uint32_t tint = PackColor(255, 255, 255));
+        /// @brief The image under key, looked up at replay. Skipped if the atlas dropped it by then
+        void DrawAtlasImage(float x, float y, float width, float height, TextureAtlas& atlas,
+                            uint64_t key, uint32_t tint = PackColor(255, 255, 255));
+        void DrawRoundedRect(const RoundedRectInstance& rect);
+
+        /// @brief Text gets laid out at replay, the string is copied
+        void DrawText(GlyphCache& glyphs, FontId font, float size, float x, float baseline,
+                      std::string_view text, uint32_t color);
+        void DrawText(SdfGlyphCache& glyphs, FontId font, float size, float x, float baseline,
+                      std::string_view text, uint32_t color, const SdfTextStyle& style = SdfTextStyle{});
+
+        /// @brief fn gets a copy of data (size bytes, trivially copyable stuff only)
+        void DrawCustom(CustomFn fn, const void* data = nullptr, std::size_t size = 0);
+
+        /// @brief Puts another list's commands in this one, without copying them
+        /// @warning other has to stay alive and untouched until this one is cleared.
+        /// Its keys and clips come along as they are
+        void Append(const CommandList& other);
+
+        /// @brief Stable sort by key among commands that don't overlap, Replay() does it when it's needed
+        void Sort();
+
+        /// @brief Sorts if needed, then draws everything in order. The list stays, it can be replayed again
+        void Replay(QuadBatch& batch);
+        /// @brief Same order and clips, into something else
+        void Replay(CommandTarget& target);
+
+        /// @brief Forgets every command and resets the arena
+        void Clear();
+
+        std::size_t Size() const { return entries.size(); }
+        bool Empty() const { return entries.empty(); }
+        const core::LinearArena& Arena() const { return arena; }
+
+        /// @brief What every recorded command starts with, the payload follows
+        struct Command {
+            CommandType type;
+            const ClipRect* clip; // nullptr = none, lives in some list's arena
+        };
+
+        /// @brief Where a command may draw, clipped already
+        struct Bounds {
+            float left, top, right, bottom;
+        };
+
+    private:
+        struct Entry {
+            uint64_t key;
+            uint32_t sequence; // recording order, ties keep it
+            uint32_t slot;     // within its layer and depth, overlapping commands of another state get a later one
+            Bounds bounds;
+            const Command* command;
+        };
+
+        /// @brief Commands of one slot, a list through nextInSlot
+        struct Slot {
+            Bounds area; // all of them together
+            uint32_t first;
+        };
+
+        template <typename T>
+        T* Record(uint16_t pipeline, uint32_t texture, Bounds bounds);
+        /// @brief Slots for entries [begin, end), one layer and depth in recording order
+        void AssignSlots(std::size_t begin, std::size_t end);
+        /// @brief The replay loop, for the batch and for targets
+        template <typename Target>
+        void ReplayInto(Target& target, const ClipRect& outside);
+        std::string_view Copy(std::string_view text);
+
+        core::LinearArena arena;
+        std::vector<Entry> entries;
+        std::vector<Slot> slots;           // Sort()'s scratch, kept for the capacity
+        std::vector<uint32_t> nextInSlot;
+        std::vector<const ClipRect*> clips; // the stack, top applies
+        uint8_t layer = 0;
+        uint16_t depth = 0;
+        bool sorted = true;
+    };
+
+    /// @brief Whatever replays commands besides the QuadBatch
+    ///
+    /// SetClip() comes before the commands it applies to, "no clip" at the end.
+    class CommandTarget {
+    public:
+        virtual ~CommandTarget() = default;
+
+        virtual void SetClip(const ClipRect& clip) = 0;
+        virtual void DrawRect(float x, float y, float width, float height, uint32_t color) = 0;
+        virtual void DrawImage(float x, float y, float width, float height, GLuint texture,
+                               float u0, float v0, float u1, float v1, uint32_t tint) = 0;
+        virtual void DrawAtlasImage(float x, float y, float width, float height, const TextureAtlas& atlas,
+                                    const AtlasRegion& region, uint32_t tint) = 0;
+        virtual void DrawRoundedRect(const RoundedRectInstance& rect) = 0;
+        virtual void DrawText(GlyphCache& glyphs, FontId font, float size, float x, float baseline,
+                              std::string_view text, uint32_t color) = 0;
+        virtual void DrawText(SdfGlyphCache& glyphs, FontId font, float size, float x, float baseline,
+                              std::string_view text, uint32_t color, const SdfTextStyle& style) = 0;
+        /// @brief Custom commands draw into a QuadBatch, a target without one can only skip them
+        virtual void DrawCustom(CommandList::CustomFn, const void*) {}
+    };
+}
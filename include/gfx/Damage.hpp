@@ -0,0 +1,135 @@
+// Damage.hpp
+
+// Partial redraw. Widgets say which rectangles changed, the tracker merges them
+// into a few non-overlapping regions, and only those get drawn again, scissored,
+// into a framebuffer that still holds the rest of the last frame. Then the
+// changed parts get copied to the window. A blinking caret redraws a few hundred
+// pixels instead of the whole window.
+
+#pragma once
+#include "gfx/Batch.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace mayak::gfx {
+
+    /// @brief Changed rectangles of one frame, merged into at most MAX_REGIONS that don't overlap
+    ///
+    /// Everything is in framebuffer pixels with a top-left origin, like ClipRect.
+    /// Overlapping rects merge into their bounding box, so do rects whose bounding
+    /// box isn't bigger than the two of them (neighbours in a row). Past MAX_REGIONS
+    /// the pair that wastes the fewest pixels merges, past FULL_PERCENT of the
+    /// window it's just the whole window, a draw per region would cost more than it saves.
+    class DamageTracker {
+    public:
+        static constexpr int MAX_REGIONS = 8;
+        static constexpr int FULL_PERCENT = 70;
+        static constexpr int HISTORY = 4; // frames remembered for RegionsSince()
+
+        /// @brief Another size damages everything, the old pixels don't fit anymore
+        void SetSize(int width, int height);
+        int Width() const { return width; }
+        int Height() const { return height; }
+
+        /// @brief Marks rect as changed, clamped to the window
+        void Add(const ClipRect& rect);
+        /// @brief Marks the whole window as changed
+        void AddAll();
+
+        bool Empty() const { return regions.empty(); }
+        bool IsFull() const { return full; }
+        const std::vector<ClipRect>& Regions() const { return regions; }
+        /// @brief Pixels in Regions()
+        int64_t Area() const;
+
+        /// @brief Drops this frame's damage without remembering it
+        void Clear();
+
+        /// @brief Closes the frame: its damage goes into the history, the tracker starts empty
+        void Commit();
+
+        /// @brief What a buffer that's age frames old is missing: this frame's damage plus the last age - 1 frames'
+        /// @param age 1 = last frame's contents, 0 = unknown. Unknown or older than HISTORY = the whole window
+        void RegionsSince(int age, std::vector<ClipRect>& out) const;
+
+    private:
+        void Insert(ClipRect rect);
+
+        int width = 0, height = 0;
+        std::vector<ClipRect> regions;
+        bool full = false;
+
+        struct Frame {
+            std::vector<ClipRect> regions;
+            bool full = true;
+        };
+        Frame history[HISTORY]; // ring, newest at (committed - 1) % HISTORY
+        uint64_t committed = 0;
+    };
+
+    /// What partial redraw saved, per PartialRedraw
+    struct RedrawStats {
+        uint64_t frames = 0;          // frames that drew something
+        uint64_t fullFrames = 0;      // ... of those, the whole window
+        uint64_t redrawnPixels = 0;
+        uint64_t presentedPixels = 0; // copied to the window, more than redrawn when the buffer age is old
+        int lastRegions = 0;
+        int64_t lastRedrawnPixels = 0;
+    };
+
+    /// @brief A window's retained frame and damage, redraws only what changed
+    ///
+    /// Per frame: Begin(), bind Framebuffer(), draw each of Regions() with a scissor
+    /// (and QuadBatch::Begin() bounds) set to it, Present(), End().
+    /// The framebuffer is a GL object of the context that was current in Begin(),
+    /// Destroy() has to run with that context current.
+    class PartialRedraw {
+    public:
+        PartialRedraw() = default;
+        PartialRedraw(const PartialRedraw&) = delete;
+        PartialRedraw& operator=(const PartialRedraw&) = delete;
+
+        /// @brief Marks rect (pixels) as changed for the next frame. Thread-safe
+        void Invalidate(const ClipRect& rect);
+        /// @brief Everything, e.g. when the window got exposed. Thread-safe
+        void InvalidateAll();
+        /// @brief Whether the next Begin() has anything to draw. Thread-safe
+        bool HasDamage();
+
+        /// @brief Takes the damage so far and sizes the framebuffer, a new framebuffer damages everything
+        /// @return False if nothing changed, skip the frame (the window still shows the right thing)
+        bool Begin(int width, int height);
+
+        /// @brief Where to draw, valid after Begin()
+        GLuint Framebuffer() const { return fbo; }
+
+        /// @brief What to draw this frame, valid between Begin() and End()
+        const std::vector<ClipRect>& Regions() const { return damage.Regions(); }
+        bool IsFull() const { return damage.IsFull(); }
+
+        /// @brief Copies what target is missing into it, the framebuffer's contents stay
+        /// @param target Framebuffer of the window, 0 for its back buffer
+        /// @param bufferAge How many frames old target's contents are, 0 = unknown (copies everything)
+        void Present(GLuint target, int bufferAge);
+
+        /// @brief Closes the frame, its damage goes into the history for later buffer ages
+        void End();
+
+        /// @brief Deletes the framebuffer, the next Begin() makes a new one
+        void Destroy();
+
+        const RedrawStats& Stats() const { return stats; }
+
+    private:
+        std::mutex mutex;        // guards pending, Invalidate() can come from any thread
+        DamageTracker pending;   // filling up for the next frame
+        DamageTracker damage;    // the frame being drawn, render thread only
+        std::vector<ClipRect> presentRegions;
+
+        GLuint fbo = 0, colorBuffer = 0, depthBuffer = 0;
+        int fboWidth = 0, fboHeight = 0;
+        RedrawStats stats;
+    };
+}
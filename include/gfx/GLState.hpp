@@ -0,0 +1,151 @@
+// GLState.hpp
+
+// Shadow copy of the GL state, so we only call the driver when something
+// actually changes. UI rendering sets the same program / texture / blend
+// state over and over, and every one of those calls costs CPU in the driver.
+
+#pragma once
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct GLFWwindow;
+
+namespace mayak::gfx {
+
+    /// Calls that went to the driver vs. ones the shadow swallowed
+    struct GLStateStats {
+        uint64_t issued = 0;
+        uint64_t skipped = 0;
+    };
+
+    /// @brief Shadowed GL state of one context
+    ///
+    /// Everything starts out "unknown", so the first call of each kind always
+    /// goes through. If some code calls GL directly behind its back, call Invalidate().
+    /// When deleting objects, tell it with the Forget*() methods, GL reuses names.
+    /// Programs, buffers and textures are shared between contexts, those go
+    /// through ForgetShared*() so every context's shadow drops them.
+    class GLState {
+    public:
+        static constexpr int TEXTURE_UNITS = 16;
+
+        GLState() { Invalidate(); }
+
+        void UseProgram(GLuint program);
+        void BindVertexArray(GLuint vao);
+
+        /// @brief GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_UNIFORM_BUFFER or
+        /// GL_PIXEL_UNPACK_BUFFER are shadowed, other targets are passed through
+        void BindBuffer(GLenum target, GLuint buffer);
+
+        /// @brief Binds to a texture unit, GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY are shadowed
+        void BindTexture(int unit, GLenum target, GLuint texture);
+
+        void BindFramebuffer(GLenum target, GLuint framebuffer);
+
+        void SetBlend(bool enabled);
+        void SetBlendFunc(GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha, GLenum dstAlpha);
+        void SetBlendEquation(GLenum mode);
+
+        void SetScissorTest(bool enabled);
+        void SetScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+        void SetViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+        void SetDepthTest(bool enabled);
+        void SetDepthMask(bool enabled);
+        void SetDepthFunc(GLenum func);
+
+        void SetStencilTest(bool enabled);
+        void SetStencilFunc(GLenum func, GLint ref, GLuint mask);
+        void SetStencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass);
+        void SetStencilMask(GLuint mask);
+
+        /// @brief All four channels at once, off = only depth / stencil get written
+        void SetColorMask(bool enabled);
+
+        /// @brief Forget everything, next calls all go to the driver
+        void Invalidate();
+
+        // Deleted objects: drop them from the shadow, a new object may get the same name.
+        // GL only unbinds them in the context that deleted them (current), elsewhere they're "unknown"
+        void ForgetProgram(GLuint program);
+        void ForgetVertexArray(GLuint vao);
+        void ForgetBuffer(GLuint buffer, bool current = true);
+        void ForgetTexture(GLuint texture, bool current = true);
+        void ForgetFramebuffer(GLuint framebuffer, bool current = true);
+
+        GLuint CurrentProgram() const { return program; }
+        GLuint CurrentVertexArray() const { return vertexArray; }
+
+        /// @brief Counters of the frame that's being drawn right now
+        const GLStateStats& Stats() const { return stats; }
+
+        /// @brief Counters of the last finished frame
+        const GLStateStats& LastFrameStats() const { return lastFrame; }
+
+        /// @brief Closes the frame's counters, render_windows() calls it after every swap
+        void EndFrame();
+
+        /// @brief Slot for an object GL doesn't share between contexts (VAOs, FBOs)
+        ///
+        /// Lives as long as this context's shadow, so a destroyed window takes its
+        /// objects with it and a new window never sees stale names. 0 = not made yet.
+        /// @param key Unique per owner, e.g. RendererContext::id
+        GLuint& ContextObject(uint64_t key);
+
+        /// @brief Drops the slot, call it after deleting the object
+        void ForgetContextObject(uint64_t key);
+
+    private:
+        static constexpr GLuint UNKNOWN = ~0u;
+        static constexpr int8_t UNKNOWN_FLAG = -1;
+
+        enum BufferSlot { ARRAY, ELEMENT, UNIFORM, PIXEL_UNPACK, BUFFER_SLOTS };
+        enum TextureSlot { TEX_2D, TEX_2D_ARRAY, TEXTURE_SLOTS };
+
+        bool SetFlag(int8_t& shadow, bool enabled, GLenum capability);
+        bool Changed(bool changed) {
+            ++(changed ? stats.issued : stats.skipped);
+            return changed;
+        }
+
+        GLuint program, vertexArray, drawFramebuffer, readFramebuffer;
+        std::array<GLuint, BUFFER_SLOTS> buffers;
+        std::array<std::array<GLuint, TEXTURE_SLOTS>, TEXTURE_UNITS> textures;
+        GLuint activeUnit;
+
+        int8_t blend, scissorTest, depthTest, depthMask, stencilTest, colorMask;
+        std::array<GLenum, 4> blendFunc;
+        GLenum blendEquation;
+        std::array<GLint, 4> scissor, viewport;
+        GLenum depthFunc;
+        GLenum stencilFunc;
+        GLint stencilRef;
+        GLuint stencilFuncMask, stencilWriteMask;
+        std::array<GLenum, 3> stencilOp;
+
+        GLStateStats stats, lastFrame;
+
+        // A handful of owners at most, a vector beats a map here
+        std::vector<std::pair<uint64_t, GLuint>> contextObjects;
+    };
+
+    /// @brief Shadow of the context that's current on this thread
+    /// @note Lookup is a thread-local pointer compare, cheap enough per call
+    GLState& State();
+
+    /// @brief Shadow of the given context, made on first use
+    GLState& State(GLFWwindow* context);
+
+    // Deleted a shared object in the current context: drops it from the shadows of all contexts, any of them may have it bound
+    void ForgetSharedProgram(GLuint program);
+    void ForgetSharedBuffer(GLuint buffer);
+    void ForgetSharedTexture(GLuint texture);
+
+    /// @brief Drops the shadow of a destroyed context
+    void ForgetContext(GLFWwindow* context);
+}
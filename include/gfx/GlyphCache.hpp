@@ -0,0 +1,155 @@
+// GlyphCache.hpp
+
+// Text = lots of tiny textured quads. Every glyph gets rasterized once per
+// (font, size, subpixel offset) into a coverage atlas, after that drawing it
+// is one hash probe and four vertices.
+
+#pragma once
+#include "gfx/Atlas.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace mayak::gfx {
+    class QuadBatch;
+
+    using FontId = uint16_t;
+
+    /// Horizontal subpixel positions a glyph gets rasterized at (0, 1/4, 2/4, 3/4 px)
+    constexpr int GLYPH_SUBPIXEL_STEPS = 4;
+
+    struct FontMetrics {
+        float ascent = 0;  // baseline to the top, positive
+        float descent = 0; // baseline to the bottom, positive
+        float lineGap = 0;
+
+        float LineHeight() const { return ascent + descent + lineGap; }
+    };
+
+    /// @brief One rasterized glyph, coverage only
+    struct GlyphBitmap {
+        int width = 0, height = 0;    // 0 for whitespace
+        int bearingX = 0;             // pen position -> left edge
+        int bearingY = 0;             // baseline -> top edge, positive = up
+        float advance = 0;            // where the pen goes next
+        std::vector<uint8_t> pixels;  // width * height, top row first
+    };
+
+    /// @brief Turns fonts into bitmaps, plug FreeType / stb_truetype / whatever in here
+    ///
+    /// MayakUI doesn't ship a font library, the app brings one and picks the FontIds.
+    class GlyphRasterizer {
+    public:
+        virtual ~GlyphRasterizer() = default;
+
+        virtual FontMetrics Metrics(FontId font, float size) = 0;
+
+        /// @param size Pixels per em
+        /// @param subpixelOffset 0..1, shift the outline right by this much before rasterizing
+        /// @return False if the font doesn't have it, the cache remembers that too
+        virtual bool Rasterize(FontId font, float size, uint32_t codepoint, float subpixelOffset, GlyphBitmap& out) = 0;
+    };
+
+    /// @brief What the cache knows about one glyph
+    struct CachedGlyph {
+        AtlasRegion region;
+        int16_t bearingX = 0, bearingY = 0;
+        float advance = 0;
+        bool drawable = false;        // whitespace and missing glyphs only advance
+        bool waitingForRoom = false;  // the atlas was full of this frame's glyphs, tried again next frame
+        uint64_t atlasGeneration = 0; // region is right as long as the atlas didn't move anything
+        uint64_t lastUsedFrame = ~0ull;
+    };
+
+    /// @brief Where the layout put a glyph's pen, for drawing it with something else than the batch
+    struct PlacedGlyph {
+        uint32_t codepoint;
+        uint32_t sizeQuarters; // the size to rasterize it at, in quarter pixels
+        uint32_t subpixel;     // step, 0 .. GLYPH_SUBPIXEL_STEPS - 1
+        float penX, baseline;  // whole framebuffer pixels, the bitmap's bearings go on top
+    };
+
+    struct GlyphCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;     // had to rasterize
+        uint64_t refreshes = 0;  // the atlas moved it, looked it up again
+    };
+
+    /// @brief Glyph cache on top of a coverage (R8) TextureAtlas
+    ///
+    /// Lookups go through an open-addressing table (linear probing, load <= 1/2),
+    /// so a hit is a multiply, a probe or two and no pointer chasing.
+    class GlyphCache {
+    public:
+        explicit GlyphCache(GlyphRasterizer& rasterizer, AtlasOptions atlasOptions = AtlasOptions{});
+
+        GlyphCache(const GlyphCache&) = delete;
+        GlyphCache& operator=(const GlyphCache&) = delete;
+
+        /// @brief Creates the atlas texture, needs a GL context
+        bool Create() { return atlas.Create(); }
+        void Destroy() { atlas.Destroy(); }
+
+        /// @brief The glyph at a size and subpixel offset, rasterized now if it's new
+        /// @param subpixel 0..1, snapped to GLYPH_SUBPIXEL_STEPS
+        /// @note The reference is good until the next Get(). A glyph that didn't fit the
+        /// atlas this frame isn't drawable, it gets another try in the next frame
+        const CachedGlyph& Get(FontId font, float size, uint32_t codepoint, float subpixel = 0);
+
+        FontMetrics Metrics(FontId font, float size) { return rasterizer.Metrics(font, size); }
+
+        /// @brief Draws UTF-8 text, '\n' starts a new line
+        /// @param baseline Where the first line's baseline goes, framebuffer pixels
+        /// @return Width of the widest line
+        float DrawText(QuadBatch& batch, FontId font, float size, float x, float baseline,
+                       std::string_view text, uint32_t color);
+
+        /// @brief Width of the widest line, same layout as DrawText()
+        float MeasureText(FontId font, float size, std::string_view text);
+
+        /// @brief Same layout as DrawText(), but the atlas stays out of it: visit gets every glyph,
+        /// whitespace too, rasterizes it however it likes and returns its GlyphBitmap::advance
+        float LayoutText(FontId font, float size, float x, float baseline, std::string_view text,
+                         const std::function<float(const PlacedGlyph&)>& visit);
+
+        void Clear();
+
+        TextureAtlas& Atlas() { return atlas; }
+        GlyphRasterizer& Rasterizer() { return rasterizer; }
+        std::size_t Count() const { return glyphs.size(); }
+        const GlyphCacheStats& Stats() const { return stats; }
+
+    private:
+        struct Slot {
+            uint64_t key = 0; // 0 = empty
+            uint32_t index = 0;
+        };
+
+        static uint64_t MakeKey(FontId font, uint32_t sizeQuarters, uint32_t codepoint, uint32_t subpixel);
+        /// @brief Get() with size in quarter pixels and the subpixel step already picked
+        const CachedGlyph& Lookup(FontId font, uint32_t sizeQuarters, uint32_t codepoint, uint32_t subpixel,
+                                  uint64_t frame);
+        const CachedGlyph& Rasterize(CachedGlyph& glyph, uint64_t key, FontId font, uint32_t sizeQuarters,
+                                     uint32_t codepoint, uint32_t subpixel, uint64_t frame);
+        void Grow();
+
+        /// @brief Walks the pen through the text, advance(penX, lineY, codepoint, subpixel) for every
+        /// glyph says how far it moves. penX is a whole pixel, lineY the rounded baseline
+        template <typename Advance>
+        float Walk(FontId font, float size, float x, float baseline, std::string_view text, Advance&& advance);
+        /// @brief Lays the text out from the atlas, calls place(glyph, x, y) for everything drawable
+        template <typename Place>
+        float Layout(FontId font, float size, float x, float baseline, std::string_view text, Place&& place);
+
+        GlyphRasterizer& rasterizer;
+        TextureAtlas atlas;
+        std::vector<Slot> table; // power of two
+        std::vector<CachedGlyph> glyphs;
+        GlyphCacheStats stats;
+    };
+
+    /// @brief Next code point of a UTF-8 string, advances `offset`. Broken bytes come out as U+FFFD
+    uint32_t DecodeUtf8(std::string_view text, std::size_t& offset);
+}
@@ -0,0 +1,79 @@
+// ProgramCache.hpp
+
+// Compiling and linking GLSL is the slowest part of startup, and it's the same
+// work every launch. The driver can hand out the linked program as a blob, so
+// the first launch keeps those on disk and the next ones just load them.
+
+#pragma once
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mayak::gfx {
+
+    /// @brief A linked program as the driver gave it out
+    struct ProgramBinary {
+        GLenum format = 0;
+        std::vector<uint8_t> data;
+        int64_t compileNs = 0; // how long compiling it from source took, for the "saved" numbers
+    };
+
+    struct ProgramCacheStats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t rejected = 0;  // a file was there but broken, or the driver didn't take it
+        int64_t loadNs = 0;     // spent loading binaries
+        int64_t compileNs = 0;  // spent compiling from source
+        int64_t savedNs = 0;    // compile time the hits would have cost, minus loading them
+    };
+
+    /// @brief Program binaries in a directory, one file per key
+    ///
+    /// Files carry a checksum and their key, anything that doesn't match
+    /// is treated as missing and gets deleted. Writes go through a temporary
+    /// file and a rename, a crash mid-write doesn't leave half a binary around.
+    class ProgramBinaryCache {
+    public:
+        explicit ProgramBinaryCache(std::string directory) : directory(std::move(directory)) {}
+
+        /// @brief Hashes everything that makes a binary valid: the sources as
+        /// compiled (defines included) and the driver that compiled them
+        static uint64_t Key(std::string_view vertexSource, std::string_view fragmentSource,
+                            std::string_view defines, std::string_view driver);
+
+        /// @return False if there's nothing usable for key
+        bool Load(uint64_t key, ProgramBinary& out);
+        bool Store(uint64_t key, const ProgramBinary& binary);
+        void Remove(uint64_t key);
+
+        std::string Path(uint64_t key) const;
+        const std::string& Directory() const { return directory; }
+
+    private:
+        std::string directory;
+    };
+
+    /// @brief Where BuildProgram() keeps binaries, "" turns the cache off
+    ///
+    /// Defaults to mayakui/shaders in the user's cache directory
+    /// ($XDG_CACHE_HOME, ~/.cache, ~/Library/Caches or %LOCALAPPDATA%).
+    void SetProgramCacheDirectory(const std::string& directory);
+    std::string ProgramCacheDirectory();
+
+    /// @brief Compiles and links a program, or loads it from the binary cache
+    ///
+    /// Needs GL 4.1 for binaries, below that it always compiles. A binary the
+    /// driver refuses (driver update, another GPU) gets compiled from source instead
+    /// and replaced.
+    /// @param name For the logs
+    /// @param defines Goes in right after the #version line of both shaders
+    /// @return 0 if it didn't compile or link
+    GLuint BuildProgram(const char* vertexSource, const char* fragmentSource, const std::string& name,
+                        const std::string& defines = "");
+
+    /// @brief Everything BuildProgram() did so far, any thread
+    ProgramCacheStats ProgramCacheStatistics();
+}
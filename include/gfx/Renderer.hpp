@@ -5,15 +5,86 @@
 
 #pragma once
 #include <glad/glad.h>
+#include "gfx/ShaderVariants.hpp"
+#include "gfx/StreamBuffer.hpp"
+
+#include <cstdint>
+#include <memory>
 
 namespace mayak::gfx {
 
+    /// @brief One corner of a quad, what the batch streams to the GPU (24 bytes)
+    struct QuadVertex {
+        float x, y;     // framebuffer pixels, top-left origin
+        float u, v;
+        uint32_t color; // RGBA8, see PackColor()
+        uint16_t layer; // atlas page, plain 2D textures ignore it
+        uint16_t clip;  // uClipRects slot, the batch fills it in from its clip, 0 = none
+    };
+    static_assert(sizeof(QuadVertex) == 24, "four of these per quad, streamed every frame");
+
+    /// @brief 0-255 channels -> QuadVertex::color, bytes in R, G, B, A order in memory
+    constexpr uint32_t PackColor(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255) {
+        return uint32_t(r) | (uint32_t(g) << 8) | (uint32_t(b) << 16) | (uint32_t(a) << 24);
+    }
+
+    /// @brief One rounded rect with a border, drawn instanced, 48 bytes
+    ///
+    /// No tessellation and no MSAA: the fragment shader evaluates a signed distance
+    /// to the rounded box and anti-aliases the edge analytically.
+    struct RoundedRectInstance {
+        float x, y, width, height;  // framebuffer pixels, top-left origin
+        float radii[4];             // top-left, top-right, bottom-right, bottom-left
+        uint32_t fill;              // PackColor()
+        uint32_t border;
+        float borderWidth;          // 0 = no border, grows inwards
+        uint32_t clipId;            // the batch fills it in from its clip, 0 = no clip
+    };
+    static_assert(sizeof(RoundedRectInstance) == 48, "keep instances compact, they're streamed every frame");
+
     struct RendererContext {
+        std::unique_ptr<ShaderVariants> quadShaders; // every quad program, the ones below included
         GLuint shaderProgram = 0;
-        // someday I'll add VAO, VBO, textures, etc.
+        GLuint roundedRectProgram = 0;
+        GLuint atlasProgram = 0; // quads sampling a texture array (TextureAtlas pages)
+        GLuint distanceFieldProgram = 0; // atlas quads holding distance fields (SdfGlyphCache), see LoadDistanceFieldProgram()
+        StreamBuffer vertexStream; // every flush writes its quads in here
+        GLuint indexBuffer = 0;  // static, 0 1 2 2 3 0 for every quad
+        GLuint whiteTexture = 0; // 1x1, plain colored quads sample this
+        GLint transformLocation = -1;
+        GLint roundedRectTransformLocation = -1;
+        GLint atlasTransformLocation = -1;
+        GLint clipRectsLocation = -1;
+        GLint roundedRectMinCoverageLocation = -1;
+        GLint distanceFieldTransformLocation = -1;
+        GLint distanceFieldParamsLocation = -1;
+        GLint distanceFieldOutlineLocation = -1;
+        GLint distanceFieldGlowLocation = -1;
+
+        // VAOs aren't shared between contexts, each context gets its own through
+        // GLState::ContextObject(id), so this needs to be unique
+        uint64_t id = 0;
     };
 
+    /// How many quads fit in one flush, 4 vertices each still fit 16-bit indices
+    constexpr int MAX_BATCH_QUADS = 16384;
+
+    /// Different clip rects one flush can hand to the shaders (uClipRects), id 0 = none
+    constexpr int MAX_CLIP_RECTS = 64;
+
     bool LoadShaders(RendererContext& ctx);
     void Use(const RendererContext& ctx);
     void Destroy(RendererContext& ctx);
-}
\ No newline at end of file
+
+    /// @brief Fills in the distance field program and its uniforms, LoadShaders() leaves them for later
+    /// @return False if it doesn't compile
+    /// @warning Needs ctx loaded and a GL context current
+    bool LoadDistanceFieldProgram(RendererContext& ctx);
+
+    /// @brief This context's VAO for ctx, made on first use in every context
+    /// @warning Needs ctx loaded and a GL context current
+    GLuint VertexArray(const RendererContext& ctx);
+
+    /// @brief Same for rounded rects, bound and pointed at instances starting at instanceOffset
+    GLuint RoundedRectVertexArray(const RendererContext& ctx, GLintptr instanceOffset);
+}
@@ -0,0 +1,96 @@
+// ScaleCache.hpp
+
+// Keeps rasterized stuff (icons, glyph pages, ...) per content scale,
+// so a 2x window never has to upscale 1x bitmaps.
+
+#pragma once
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace mayak::gfx {
+
+    /// Content scale rounded to quarter steps: 1.0 -> 4, 1.25 -> 5, 2.0 -> 8.
+    /// Scales that round the same share rasterizations.
+    using ScaleBucket = uint16_t;
+
+    ScaleBucket ScaleToBucket(float scale);
+    float BucketToScale(ScaleBucket bucket);
+
+    /// One rasterization of one resource at one scale
+    struct ScaledResource {
+        GLuint texture = 0;
+        int width = 0, height = 0; // pixels
+        std::size_t bytes = 0;     // what it costs, for the accounting
+    };
+
+    /// @brief Cache of resources rasterized per scale bucket, with memory accounting
+    ///
+    /// Resources get rasterized lazily on Get(), so when a window moves to a
+    /// monitor with another scale only what it actually draws gets redone.
+    /// Buckets no window uses anymore get released by SyncWithWindows(),
+    /// so a mixed-DPI setup doesn't keep both sets around forever.
+    class ScaleCache {
+    public:
+        using RasterizeFn = std::function<ScaledResource(uint64_t key, float scale)>;
+        using ReleaseFn = std::function<void(ScaledResource& resource)>;
+
+        /// @param rasterize Makes the resource `key` at `scale`, fill in bytes!
+        /// @param release Frees a resource, e.g. glDeleteTextures
+        ScaleCache(RasterizeFn rasterize, ReleaseFn release);
+        ~ScaleCache();
+
+        ScaleCache(const ScaleCache&) = delete;
+        ScaleCache& operator=(const ScaleCache&) = delete;
+
+        /// @brief The resource at the given scale, rasterized now if it isn't cached
+        const ScaledResource& Get(uint64_t key, float scale);
+
+        /// @brief Releases everything that isn't in one of the given buckets
+        void RetainScales(const std::vector<ScaleBucket>& active);
+
+        /// @brief RetainScales() with the pixel ratios (Window::GetPixelRatio()) of all open windows
+        void SyncWithWindows();
+
+        /// @brief Evicts least recently used entries until BytesUsed() <= budget
+        /// @note Never evicts what was used in the current frame
+        void Trim(std::size_t budgetBytes);
+
+        void Clear();
+
+        std::size_t BytesUsed() const { return bytesUsed; }
+        std::size_t BytesAt(ScaleBucket bucket) const;
+        std::size_t Count() const { return entries.size(); }
+        uint64_t Hits() const { return hits; }
+        uint64_t Misses() const { return misses; }
+
+    private:
+        struct Key {
+            uint64_t key;
+            ScaleBucket bucket;
+            bool operator==(const Key& other) const { return key == other.key && bucket == other.bucket; }
+        };
+        struct KeyHash {
+            std::size_t operator()(const Key& k) const {
+                return std::hash<uint64_t>()(k.key * 0x9E3779B97F4A7C15ull ^ k.bucket);
+            }
+        };
+        struct Entry {
+            ScaledResource resource;
+            uint64_t lastUsedFrame = 0;
+        };
+
+        void Release(Entry& entry, ScaleBucket bucket);
+
+        RasterizeFn rasterize;
+        ReleaseFn release;
+        std::unordered_map<Key, Entry, KeyHash> entries;
+        std::unordered_map<ScaleBucket, std::size_t> bucketBytes;
+        std::size_t bytesUsed = 0;
+        uint64_t hits = 0, misses = 0;
+    };
+}
@@ -0,0 +1,161 @@
+// SdfText.hpp
+
+// Bitmap glyphs are made for one size, zoom or animate the size and every frame
+// rasterizes a new set. Distance fields don't care: each glyph is made once at a
+// reference size and one shader draws it sharp at any scale, outline and glow included.
+// Making them is slow-ish, so it happens on the job system and never inside a frame.
+
+#pragma once
+#include "gfx/GlyphCache.hpp"
+#include "gfx/Renderer.hpp"
+#include "core/Jobs.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mayak::gfx {
+    class QuadBatch;
+
+    struct SdfOptions {
+        float referenceSize = 48;   // pixels per em the fields get made at
+        int spread = 6;             // reference pixels the field reaches past the edge, caps outline + glow
+        int oversample = 2;         // rasterize this much bigger and average down, smoother edges
+        AtlasOptions atlas;         // the format is always R8
+    };
+
+    /// @brief Outline and glow of distance field text, pixels at the size it's drawn
+    struct SdfTextStyle {
+        float outline = 0;
+        uint32_t outlineColor = PackColor(0, 0, 0);
+        float glow = 0;
+        uint32_t glowColor = PackColor(0, 0, 0, 160);
+        float weight = 0;           // > 0 bolder, < 0 thinner
+    };
+
+    /// @brief One glyph's field, sizes in reference pixels
+    struct SdfGlyph {
+        AtlasRegion region;
+        float bearingX = 0, bearingY = 0; // pen -> left edge, baseline -> top edge (up = positive), spread included
+        float width = 0, height = 0;
+        float advance = 0;
+        bool ready = false;               // false = a worker is still on it, or it waits for atlas room
+        bool drawable = false;            // whitespace and missing glyphs only advance
+        uint64_t atlasGeneration = 0;
+        uint64_t lastUsedFrame = ~0ull;
+    };
+
+    struct SdfCacheStats {
+        uint64_t hits = 0;
+        uint64_t queued = 0;         // handed to a worker
+        uint64_t uploaded = 0;
+        uint64_t regenerated = 0;    // evicted from the atlas and made again
+        uint64_t skippedDraws = 0;   // glyphs the layout left out because they weren't ready
+        uint64_t generateNs = 0;     // worker time spent rasterizing and transforming
+    };
+
+    /// @brief Signed distance field of a coverage bitmap
+    ///
+    /// Coverage >= 50% is inside. Distances get measured on the oversampled bitmap
+    /// (exact Euclidean, two passes of the Felzenszwalb-Huttenlocher transform),
+    /// averaged down by `oversample` and stored as 0.5 + distance / (2 * spread),
+    /// so 128 is the edge and anything past `spread` clamps.
+    /// @param out Gets width, height and pixels, with `spread` pixels of margin on every side
+    void BuildDistanceField(const GlyphBitmap& coverage, int oversample, int spread, GlyphBitmap& out);
+
+    /// @brief Distance field glyphs in an R8 TextureAtlas, generated on worker threads
+    ///
+    /// A glyph nobody asked for before gets queued on the job system and DrawText()
+    /// leaves it out until it's there, usually the next frame. Prefetch() the text
+    /// of a loading screen if popping in isn't OK.
+    /// @warning The rasterizer gets called from worker threads, one call at a time
+    class SdfGlyphCache {
+    public:
+        /// @param jobs nullptr = core::job_system()
+        explicit SdfGlyphCache(GlyphRasterizer& rasterizer, const SdfOptions& options = SdfOptions{},
+                               core::JobSystem* jobs = nullptr);
+        /// @brief Waits for the jobs still working for it
+        ~SdfGlyphCache();
+
+        SdfGlyphCache(const SdfGlyphCache&) = delete;
+        SdfGlyphCache& operator=(const SdfGlyphCache&) = delete;
+
+        /// @brief Creates the atlas texture, needs a GL context
+        bool Create() { return atlas.Create(); }
+        void Destroy() { atlas.Destroy(); }
+
+        /// @brief The glyph, queued for generation if it's new
+        /// @return nullptr while it's being generated
+        const SdfGlyph* Get(FontId font, uint32_t codepoint);
+
+        /// @brief Queues every glyph of the text, doesn't wait
+        void Prefetch(FontId font, std::string_view text);
+
+        /// @brief Uploads whatever the workers finished, DrawText() calls it too. GL thread only
+        ///
+        /// Fields the atlas can't take without moving this frame's glyphs wait
+        /// for the next frame's first Update(), they still count as Pending().
+        /// @return How many glyphs got ready
+        int Update();
+
+        /// @brief Waits for every queued glyph and uploads them
+        void WaitIdle();
+
+        /// @brief Draws UTF-8 text at any size, '\n' starts a new line
+        /// @return Width of the widest line, not counting glyphs that aren't ready yet
+        float DrawText(QuadBatch& batch, FontId font, float size, float x, float baseline,
+                       std::string_view text, uint32_t color, const SdfTextStyle& style = SdfTextStyle{});
+
+        float MeasureText(FontId font, float size, std::string_view text);
+
+        /// @brief Scaled from the reference size, asks the rasterizer once per font
+        FontMetrics Metrics(FontId font, float size);
+
+        void Clear();
+
+        int Pending() const { return pending; }
+        float ReferenceSize() const { return options.referenceSize; }
+        TextureAtlas& Atlas() { return atlas; }
+        std::size_t Count() const { return glyphs.size(); }
+        const SdfCacheStats& Stats() const { return stats; }
+
+    private:
+        struct Finished {
+            uint64_t key;
+            GlyphBitmap field; // empty = nothing to draw
+            float bearingX, bearingY, advance;
+            uint64_t ns;
+        };
+
+        static uint64_t MakeKey(FontId font, uint32_t codepoint) {
+            return (uint64_t(font) << 21) | (codepoint & 0x1FFFFF);
+        }
+        void Queue(SdfGlyph& glyph, uint64_t key);
+        /// @brief Runs on a worker
+        Finished Generate(uint64_t key) const;
+
+        template <typename Place>
+        float Layout(FontId font, float size, float x, float baseline, std::string_view text, Place&& place);
+
+        GlyphRasterizer& rasterizer;
+        SdfOptions options;
+        core::JobSystem& jobs;
+        TextureAtlas atlas;
+        std::unordered_map<uint64_t, SdfGlyph> glyphs;
+        std::unordered_map<FontId, FontMetrics> metrics; // at the reference size
+
+        mutable std::mutex rasterizerMutex;
+        std::mutex finishedMutex;
+        std::vector<Finished> finished;
+        std::atomic<bool> anyFinished{false};
+        std::vector<core::JobHandle> inFlight;
+        std::vector<Finished> waitingForRoom; // the atlas was full of this frame's glyphs
+        uint64_t refusedFrame = 0;
+        int pending = 0;
+
+        SdfCacheStats stats;
+    };
+}
@@ -0,0 +1,100 @@
+// ShaderVariants.hpp
+
+// One source with #ifdef feature switches instead of one uber-shader that branches
+// on uniforms (slow) or a file per combination (unmaintainable). Every combination
+// that gets asked for is compiled once, goes through the program binary cache,
+// and can be compiled ahead of time on a background context.
+
+#pragma once
+#include <glad/glad.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct GLFWwindow;
+
+namespace mayak::gfx {
+
+    /// @brief Feature switches of the quad shader, OR them together. Each one is a #define in the source
+    enum ShaderFeature : uint32_t {
+        FEATURE_TEXTURED       = 1u << 0, // TEXTURED: multiplies by uTexture (sampler2D)
+        FEATURE_TEXTURE_ARRAY  = 1u << 1, // TEXTURE_ARRAY: uTexture is a sampler2DArray, the vertex layer picks the page
+        FEATURE_DISTANCE_FIELD = 1u << 2, // DISTANCE_FIELD: the texture holds distances, uParams / uOutlineColor / uGlowColor
+        FEATURE_GRADIENT       = 1u << 3, // GRADIENT: linear, uGradientLine (from.xy, to.xy) uGradientStart uGradientEnd
+        FEATURE_CLIP_MASK      = 1u << 4, // CLIP_MASK: alpha *= uClipMask.r (texture unit 1) over uClipMaskRect
+        FEATURE_PREMULTIPLIED  = 1u << 5, // PREMULTIPLIED: outputs premultiplied alpha, blend with ONE, ONE_MINUS_SRC_ALPHA
+    };
+
+    constexpr int SHADER_FEATURE_COUNT = 6;
+    constexpr uint32_t SHADER_VARIANT_COUNT = 1u << SHADER_FEATURE_COUNT;
+
+    /// @brief Every feature combination of one vertex/fragment pair, compiled on first use
+    ///
+    /// Lookups are an array index, no locks, so asking every frame is fine.
+    /// Programs live in the shared GL context group, so they work in every window.
+    class ShaderVariants {
+    public:
+        ShaderVariants(const char* vertexSource, const char* fragmentSource, std::string name);
+        /// @brief Waits for a warm-up in progress. Doesn't delete programs, Destroy() does
+        ~ShaderVariants();
+
+        ShaderVariants(const ShaderVariants&) = delete;
+        ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+        /// @brief The program for these features, compiled right now if nobody did yet
+        /// @return 0 if it doesn't compile
+        GLuint Get(uint32_t features);
+
+        /// @brief Compiled (or warmed) already, Get() won't stall
+        bool Ready(uint32_t features) const;
+
+        /// @brief Compiles the variants on a background thread with its own shared context
+        ///
+        /// Call it from the main thread, GLFW only makes contexts there. Get() never
+        /// waits for it: a variant that isn't warm yet just gets compiled on the spot.
+        /// @return False if there's no shared context to share with or one is running already
+        bool Warm(const std::vector<uint32_t>& variants);
+
+        /// @brief Waits for Warm() to finish and destroys its context if the main loop didn't yet.
+        /// Main thread only
+        void WaitWarm();
+        bool Warming() const { return warming; }
+
+        /// @brief Deletes every program, needs a context of the share group current
+        void Destroy();
+
+        /// @brief How many variants are compiled
+        int Count() const;
+
+        /// @brief program is one of these variants
+        bool Contains(GLuint program) const;
+
+        /// @brief program is one of the FEATURE_PREMULTIPLIED variants
+        bool Premultiplied(GLuint program) const;
+
+        /// @brief Same feature set, minus the combinations that mean the same thing
+        /// (a texture array is already textured, distance fields always come from an atlas)
+        static uint32_t Normalize(uint32_t features);
+
+        /// @brief The #define block for a feature set
+        static std::string Defines(uint32_t features);
+
+    private:
+        /// @brief Compiles and publishes one variant, keeps whoever got there first
+        GLuint Compile(uint32_t features, bool onMainContext);
+
+        const char* vertexSource;
+        const char* fragmentSource;
+        std::string name;
+        std::array<std::atomic<GLuint>, SHADER_VARIANT_COUNT> programs;
+
+        std::thread warmThread;
+        std::atomic<bool> warming{false};
+        std::shared_ptr<std::atomic<GLFWwindow*>> warmContext; // the last warm-up's, until someone destroys it
+    };
+}
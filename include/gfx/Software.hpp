@@ -0,0 +1,136 @@
+// Software.hpp
+
+// The same drawing without a GPU. A CommandList replays into SoftwareRenderer,
+// which bins everything into tiles and fills the tiles in parallel on the job
+// system. Solid spans are blended 4 (SSE2) or 8 (AVX2) pixels at a time, the
+// pixels come out the way the GL renderer blends them. For headless runs,
+// screenshots in tests, and machines where GL isn't there.
+
+#pragma once
+#include "gfx/CommandList.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mayak::core {
+    class JobSystem;
+}
+
+namespace mayak::gfx {
+
+    /// @brief CPU pixels of a texture for DrawImage(), PackColor() order, top row first
+    struct SoftwareImage {
+        int width = 0, height = 0;
+        const uint32_t* pixels = nullptr; // not copied, keep it alive while it's registered
+    };
+
+    /// @brief RGBA8 pixels in PackColor() byte order, top row first
+    class SoftwareFramebuffer {
+    public:
+        /// @brief New size, the contents are gone (transparent black)
+        void Resize(int width, int height);
+        void Clear(uint32_t color);
+
+        int Width() const { return width; }
+        int Height() const { return height; }
+        uint32_t* Pixels() { return pixels.data(); }
+        const uint32_t* Pixels() const { return pixels.data(); }
+        uint32_t Pixel(int x, int y) const { return pixels[std::size_t(y) * width + x]; }
+
+        /// @brief Into the top-left of a GL_RGBA8 texture at least this big, needs a GL context
+        /// @note The rows go in top first, sample it with v flipped or draw it with a top-left origin
+        void Upload(GLuint texture) const;
+
+        /// @brief Binary PPM (P6), alpha dropped. No PNG, that would need a deflate in here
+        bool WritePPM(const std::string& path) const;
+
+    private:
+        int width = 0, height = 0;
+        std::vector<uint32_t> pixels;
+    };
+
+    /// What the last Render() did
+    struct SoftwareStats {
+        uint64_t primitives = 0;       // rects, images, rounded rects and glyphs after clipping
+        uint64_t tiles = 0;            // tiles that had anything in them
+        uint64_t skipped = 0;          // commands it can't draw: atlas images, distance field text, custom, unknown textures
+        uint64_t glyphsRasterized = 0; // new CPU glyph bitmaps
+    };
+
+    /// @brief Draws command lists into a SoftwareFramebuffer
+    ///
+    /// Rects, images, rounded rects, glyph text and clips come out like on the GPU:
+    /// pixel centers decide coverage, rounded rects use the shader's distance
+    /// function, blending is SRC_ALPHA / ONE_MINUS_SRC_ALPHA. Images are sampled
+    /// nearest. Atlas images and distance field text only live in GL textures,
+    /// those and custom commands get skipped (and counted).
+    class SoftwareRenderer : public CommandTarget {
+    public:
+        static constexpr int TILE_SIZE = 64;
+
+        /// @param jobs Where the tiles get filled, nullptr = core::job_system()
+        explicit SoftwareRenderer(core::JobSystem* jobs = nullptr);
+
+        /// @brief CPU pixels for images drawn with texture, replaces what was there
+        void SetTexture(GLuint texture, const SoftwareImage& image);
+        void RemoveTexture(GLuint texture);
+
+        /// @brief Draws the list on top of what's in target
+        void Render(CommandList& list, SoftwareFramebuffer& target);
+
+        /// @brief Drops the CPU glyph bitmaps, they pile up like the atlas does
+        void ClearGlyphs();
+
+        const SoftwareStats& Stats() const { return stats; }
+
+        /// @brief The span blend in use: "avx2", "sse2" or "scalar"
+        static const char* SpanBackend();
+
+        // CommandTarget, Render() gets these through CommandList::Replay()
+        void SetClip(const ClipRect& clip) override;
+        void DrawRect(float x, float y, float width, float height, uint32_t color) override;
+        void DrawImage(float x, float y, float width, float height, GLuint texture,
+                       float u0, float v0, float u1, float v1, uint32_t tint) override;
+        void DrawAtlasImage(float x, float y, float width, float height, const TextureAtlas& atlas,
+                            const AtlasRegion& region, uint32_t tint) override;
+        void DrawRoundedRect(const RoundedRectInstance& rect) override;
+        void DrawText(GlyphCache& glyphs, FontId font, float size, float x, float baseline,
+                      std::string_view text, uint32_t color) override;
+        void DrawText(SdfGlyphCache& glyphs, FontId font, float size, float x, float baseline,
+                      std::string_view text, uint32_t color, const SdfTextStyle& style) override;
+        void DrawCustom(CommandList::CustomFn fn, const void* data) override;
+
+    private:
+        enum class PrimitiveType : uint8_t { Fill, Image, RoundedRect, Glyph };
+
+        /// @brief Something to rasterize, already clipped
+        struct Primitive {
+            PrimitiveType type;
+            int left, top, right, bottom; // pixels it may touch, right / bottom exclusive
+            uint32_t color;               // fill, tint or text color
+            float x, y, width, height;    // Image: where the whole image goes
+            float u0, v0, u1, v1;
+            const SoftwareImage* image;
+            const GlyphBitmap* glyph;     // Glyph: its top-left is at x, y
+            RoundedRectInstance rounded;
+        };
+
+        /// @brief Clipped to the framebuffer and the current clip, false if nothing's left
+        bool Bounds(float x, float y, float width, float height, Primitive& primitive) const;
+        void RasterizeTile(int tile);
+
+        core::JobSystem& jobs;
+        std::unordered_map<GLuint, SoftwareImage> textures;
+        // Per rasterizer, then font / size / code point / subpixel step like the GlyphCache
+        std::unordered_map<GlyphRasterizer*, std::unordered_map<uint64_t, GlyphBitmap>> glyphBitmaps;
+
+        SoftwareFramebuffer* target = nullptr;
+        ClipRect clip;
+        std::vector<Primitive> primitives;
+        std::vector<std::vector<uint32_t>> bins; // primitive indices per tile, in drawing order
+        int tilesX = 0, tilesY = 0;
+        SoftwareStats stats;
+    };
+}
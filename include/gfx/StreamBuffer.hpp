@@ -0,0 +1,86 @@
+// StreamBuffer.hpp
+
+// Ring buffer for data that changes every frame (UI vertices mostly).
+// glBufferData every frame makes the driver reallocate and sometimes wait
+// for the GPU, this writes into memory the GPU isn't reading right now instead.
+
+#pragma once
+#include <glad/glad.h>
+
+#include <array>
+#include <cstdint>
+
+namespace mayak::gfx {
+
+    /// @brief Space handed out by StreamBuffer::Map()
+    struct StreamAllocation {
+        void* data = nullptr;  // write here, nullptr if the request didn't fit
+        GLintptr offset = 0;   // bytes into StreamBuffer::Buffer()
+        GLsizeiptr size = 0;
+
+        explicit operator bool() const { return data != nullptr; }
+    };
+
+    struct StreamBufferStats {
+        uint64_t bytesStreamed = 0;
+        uint64_t allocations = 0;
+        uint64_t waitStalls = 0;  // had to wait for the GPU to let go of a partition
+        int64_t waitNs = 0;       // ...and how long it took in total
+        uint64_t orphans = 0;     // fallback path gave the driver a fresh buffer instead of waiting
+    };
+
+    /// @brief Ring split into partitions, each guarded by a fence
+    ///
+    /// With GL 4.4 (buffer storage) the whole buffer is mapped once, persistent and
+    /// coherent, so Map() is just pointer math. Without it every Map() maps the range
+    /// unsynchronized + invalidated, and a partition the GPU still reads gets orphaned
+    /// instead of waited for.
+    ///
+    /// A fence goes in when the ring leaves a partition, so issue the draw calls
+    /// that read an allocation before you Map() the next one.
+    /// @note Like RendererContext, it's a plain handle, Create() and Destroy() need a GL context
+    class StreamBuffer {
+    public:
+        static constexpr int MAX_PARTITIONS = 4;
+
+        /// @param target GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, ...
+        /// @param partitionSize Biggest single allocation, roughly what one frame writes
+        /// @param partitions 3 = triple buffering, the GPU can be two partitions behind without a stall
+        bool Create(GLenum target, GLsizeiptr partitionSize, int partitions = 3);
+        void Destroy();
+
+        /// @brief Room for `bytes`, offset rounded up to a multiple of `alignment`
+        ///
+        /// The alignment doesn't have to be a power of two, use sizeof(Vertex)
+        /// to get offsets that work as a base vertex.
+        StreamAllocation Map(GLsizeiptr bytes, GLsizeiptr alignment = 16);
+
+        /// @brief Done writing the last allocation, a no-op when mapped persistently
+        void Unmap();
+
+        GLuint Buffer() const { return buffer; }
+        GLenum Target() const { return target; }
+        bool IsPersistent() const { return persistent; }
+        GLsizeiptr PartitionSize() const { return partitionSize; }
+
+        const StreamBufferStats& Stats() const { return stats; }
+
+    private:
+        /// @brief Fences the partition we're leaving and makes the next one writable
+        void NextPartition();
+
+        GLenum target = GL_ARRAY_BUFFER;
+        GLuint buffer = 0;
+        GLsizeiptr partitionSize = 0;
+        int partitionCount = 0;
+        bool persistent = false;
+        uint8_t* persistentData = nullptr;
+        bool mapped = false; // fallback path, between Map() and Unmap()
+
+        int partition = 0;
+        GLsizeiptr cursor = 0; // inside the current partition
+        std::array<GLsync, MAX_PARTITIONS> fences{};
+
+        StreamBufferStats stats;
+    };
+}
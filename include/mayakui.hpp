@@ -12,8 +12,18 @@ namespace mayak{}
 #include "core/Window.hpp"
 #include "core/Time.hpp"
 
+#include "gfx/Atlas.hpp"
+#include "gfx/Batch.hpp"
+#include "gfx/CommandList.hpp"
+#include "gfx/Damage.hpp"
 #include "gfx/GLState.hpp"
+#include "gfx/GlyphCache.hpp"
+#include "gfx/ProgramCache.hpp"
 #include "gfx/Renderer.hpp"
+#include "gfx/SdfText.hpp"
+#include "gfx/ShaderVariants.hpp"
+#include "gfx/Software.hpp"
+#include "gfx/StreamBuffer.hpp"
 
 #include "event/Event.hpp"
 #include "event/Input.hpp"
@@ -1,4 +1,9 @@
+#pragma once
+
 #include "ui/Widget.hpp"
+#include "gfx/GlyphCache.hpp"
+#include "gfx/SdfText.hpp"
+#include "gfx/Renderer.hpp"
 
 #include <string>
 
@@ -6,5 +11,27 @@ namespace mayak::ui {
     class Label : public Widget {
     public:
         Label(const std::string& text);
+
+        void setText(const std::string& newText) { text = newText; }
+        const std::string& getText() const { return text; }
+
+        /// @param fontSize Logical units, gets multiplied by DrawContext::scale when drawing
+        void setFont(gfx::FontId newFont, float fontSize) { font = newFont; this->fontSize = fontSize; }
+        void setColor(uint32_t newColor) { color = newColor; }
+        /// @brief Outline and glow, only distance field text has them
+        void setTextStyle(const gfx::SdfTextStyle& newStyle) { style = newStyle; }
+
+        /// @brief Size of the text in logical units, needs the glyph cache for the metrics
+        vec2 measure(gfx::GlyphCache& glyphs) const;
+        vec2 measure(gfx::SdfGlyphCache& glyphs) const;
+
+        void draw(DrawContext& ctx) override;
+
+    private:
+        std::string text;
+        gfx::FontId font = 0;
+        float fontSize = 16;
+        uint32_t color = gfx::PackColor(255, 255, 255);
+        gfx::SdfTextStyle style;
     };
-}
\ No newline at end of file
+}
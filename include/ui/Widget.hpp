@@ -1,14 +1,40 @@
 // this header is for the widget class which is the base class for all ui elements
 #pragma once
 
-#include "ui/Label.hpp"
-#include "ui/Button.hpp"
-#include "ui/Layout.hpp"
+#include "event/Event.hpp"
+#include "utils/vec2.hpp"
+
+namespace mayak::core {
+    class Window;
+}
+
+namespace mayak::gfx {
+    class QuadBatch;
+    class GlyphCache;
+    class SdfGlyphCache;
+}
 
 namespace mayak::ui {
+    /// @brief What a widget gets to draw itself with
+    struct DrawContext {
+        gfx::QuadBatch& batch;
+        gfx::GlyphCache* glyphs = nullptr; // nullptr = no text this frame
+        gfx::SdfGlyphCache* sdfGlyphs = nullptr; // set = text draws as distance fields, for zooming UIs
+        float scale = 1;                   // Window::GetPixelRatio(), widgets work in logical units
+    };
+
     class Widget {
     public:
-        virtual void onMouseEvent(const mayak::event::MouseEvent& event);
-        bool contains(const glm::vec2& position) const;
+        virtual ~Widget() = default;
+
+        virtual void onMouseEvent(const mayak::Event& event);
+        virtual void draw(DrawContext& ctx);
+        bool contains(const vec2& position) const;
+
+        /// @brief Something about this widget changed, redraws its rect in window (all of it without partial redraw)
+        void invalidate(core::Window& window) const;
+
+        vec2 position; // logical units, top-left
+        vec2 size;
     };
-}
\ No newline at end of file
+}
@@ -46,6 +46,8 @@ bool enableVirtualTerminal() {
 #include <ctime>
 #include <sstream>
 #include <iomanip>
+#include <future>
+#include <memory>
 
 namespace mayak::logger {
 
@@ -113,8 +115,8 @@ namespace mayak::logger {
     inline bool additionalInfo = false;
     inline LogLevel logLevel = LogLevel::INFO;
     inline std::mutex logMutex;
-    inline std::string logTimestamp = getTimestamp(TimeFormat::FileCompatible);
-    inline std::string logFilename = "mayak_log_" + logTimestamp + ".log";
+    // Empty until the first file write picks mayak_log_<timestamp>.log, so startup doesn't pay for it
+    inline std::string logFilename;
     inline bool fileLogging = true;
     inline bool consoleLogging = true;
     #ifdef _WIN32
@@ -138,7 +140,7 @@ namespace mayak::logger {
      * Messages below the selected level will be ignored.
      * @param level The new log level.
      */
-    void setLogLevel(const LogLevel& level) {
+    inline void setLogLevel(const LogLevel& level) {
         logLevel = level;
     }
 
@@ -148,7 +150,7 @@ namespace mayak::logger {
      * When set to true, the logger will output the message, followed by the file and line number.
      * @param value whether to include file and line information.
      */
-    void setAdditionalInfo(bool value) {
+    inline void setAdditionalInfo(bool value) {
         additionalInfo = value;
     }
 
@@ -156,7 +158,7 @@ namespace mayak::logger {
      * Sets whether the logger will log to a file.
      * @param value whether to log to a file.
      */
-    void setFileLogging(bool value) {
+    inline void setFileLogging(bool value) {
         fileLogging = value;
     }
 
@@ -164,7 +166,7 @@ namespace mayak::logger {
      * Sets whether the logger will log to the console.
      * @param value whether to log to the console.
      */
-    void setConsoleLogging(bool value) {
+    inline void setConsoleLogging(bool value) {
         consoleLogging = value;
     }
 
@@ -172,15 +174,62 @@ namespace mayak::logger {
      * Sets whether the logger will use colors.
      * @param value whether to use colors.
      */
-    void setColorLogging(bool value) {
+    inline void setColorLogging(bool value) {
         colorLogging = value;
     }
 
-    inline std::ofstream& getLogFile() {
-        static std::ofstream logFile(logFilename, std::ios_base::app);
-        if (!logFile.is_open()) {
-            throw std::runtime_error("Cannot open log file for writing");
+    /**
+     * @internal
+     * The log file, opened in the background on the first write.
+     * Lines written before it's open wait in a buffer and get flushed once it is,
+     * so nobody's startup blocks on the filesystem. Guarded by logMutex.
+     */
+    class LogFile {
+    public:
+        void write(const std::string& line) {
+            if (!started) start();
+            if (ready()) *file << line;
+            else pending += line;
         }
+
+        ~LogFile() {
+            if (!started || file) return;
+            // Still opening at exit, don't lose what's buffered
+            file = opening.get();
+            if (file->is_open()) *file << pending;
+        }
+
+    private:
+        void start() {
+            started = true;
+            if (logFilename.empty())
+                logFilename = "mayak_log_" + getTimestamp(TimeFormat::FileCompatible) + ".log";
+            opening = std::async(std::launch::async, [name = logFilename] {
+                return std::make_unique<std::ofstream>(name, std::ios_base::app);
+            });
+        }
+
+        bool ready() {
+            if (file) return true;
+            if (opening.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+            file = opening.get();
+            if (!file->is_open()) {
+                fileLogging = false;
+                throw std::runtime_error("Cannot open log file for writing");
+            }
+            *file << pending;
+            pending.clear();
+            return true;
+        }
+
+        bool started = false;
+        std::future<std::unique_ptr<std::ofstream>> opening;
+        std::unique_ptr<std::ofstream> file;
+        std::string pending;
+    };
+
+    inline LogFile& getLogFile() {
+        static LogFile logFile;
         return logFile;
     }
 
@@ -230,10 +279,10 @@ namespace mayak::logger {
      */
     inline void _logToFile(LogLevel level, std::string_view levelStr, std::string_view msg, const char* file, int line) {
         std::lock_guard<std::mutex> lock(logMutex);
-        getLogFile() << "[" << levelStr << "] " << msg;
+        std::string entry = "[" + std::string(levelStr) + "] " + std::string(msg);
         if (additionalInfo)
-            getLogFile() << " at " << file << ":" << line;
-        getLogFile() << "\n";
+            entry += " at " + std::string(file) + ":" + std::to_string(line);
+        getLogFile().write(entry + "\n");
     }
 };
 
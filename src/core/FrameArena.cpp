@@ -0,0 +1,83 @@
+#include "core/FrameArena.hpp"
+#include "core/RenderThread.hpp"
+
+#include <algorithm>
+
+namespace {
+    mayak::core::LinearArena arenas[2];
+    mayak::core::ArenaResource resources[2] = {
+        mayak::core::ArenaResource(arenas[0]),
+        mayak::core::ArenaResource(arenas[1])
+    };
+    int currentArena = 0;
+
+    std::size_t align_up(std::size_t value, std::size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+mayak::core::LinearArena::LinearArena(std::size_t initialSize) {
+    AddBlock(initialSize);
+}
+
+mayak::core::LinearArena::~LinearArena() {
+    for (auto& block : blocks) ::operator delete(block.data, std::align_val_t(alignof(std::max_align_t)));
+}
+
+void mayak::core::LinearArena::AddBlock(std::size_t size) {
+    auto* data = static_cast<std::byte*>(::operator new(size, std::align_val_t(alignof(std::max_align_t))));
+    blocks.push_back(Block{data, size});
+    offset = 0;
+    ++blockAllocations;
+}
+
+void* mayak::core::LinearArena::Allocate(std::size_t bytes, std::size_t alignment) {
+    Block& block = blocks.back();
+    // Align the address, not the offset, alignments above max_align_t work too
+    auto base = reinterpret_cast<std::uintptr_t>(block.data);
+    std::size_t start = align_up(base + offset, alignment) - base;
+
+    if (start + bytes > block.size) {
+        // Doesn't fit, grow geometrically so a big frame doesn't take a hundred blocks
+        AddBlock(std::max(block.size * 2, bytes + alignment));
+        return Allocate(bytes, alignment);
+    }
+    used += start + bytes - offset;
+    offset = start + bytes;
+    return blocks.back().data + start;
+}
+
+void mayak::core::LinearArena::Reset() {
+    lastFrameUsed = used;
+    highWater = std::max(highWater, used);
+
+    if (blocks.size() > 1) {
+        // This frame needed several blocks, next time one big enough is waiting
+        std::size_t total = Capacity();
+        for (auto& block : blocks) ::operator delete(block.data, std::align_val_t(alignof(std::max_align_t)));
+        blocks.clear();
+        AddBlock(total);
+    }
+    offset = 0;
+    used = 0;
+}
+
+std::size_t mayak::core::LinearArena::Capacity() const {
+    std::size_t total = 0;
+    for (const auto& block : blocks) total += block.size;
+    return total;
+}
+
+mayak::core::LinearArena& mayak::core::frame_arena() {
+    return arenas[currentArena];
+}
+
+std::pmr::memory_resource* mayak::core::frame_resource() {
+    return &resources[currentArena];
+}
+
+void mayak::core::_begin_frame_arena() {
+    // The render thread may still look at last frame's data, leave that buffer alone
+    if (render_thread_active()) currentArena ^= 1;
+    arenas[currentArena].Reset();
+}
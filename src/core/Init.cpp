@@ -1,25 +1,53 @@
 #include "core/Init.hpp"
-#include "utils/Logger.hpp"
+#include "core/Startup.hpp"
+#include "utils/logger.hpp"
 #include <cstdlib>
 #include <string>
 
+namespace {
+    mayak::core::InitOptions options;
+    mayak::core::HeadlessBackend resolvedBackend = mayak::core::HeadlessBackend::Auto;
+    bool displayless = false;
+
+    bool has_display() {
+        #if defined(_WIN32) || defined(__APPLE__)
+        return true;
+        #else
+        return std::getenv("DISPLAY") || std::getenv("WAYLAND_DISPLAY");
+        #endif
+    }
+}
+
 namespace mayak::core {
     bool initialized = false;
 
-    bool init(){
+    bool init() {
+        return init(InitOptions{});
+    }
+
+    bool init(const InitOptions& newOptions){
         if (initialized) {
             MAYAK_LOG_DEBUG("Already initialized GLFW");
             return true;
         } else {
+            startup::Scope phase("glfwInit");
+            options = newOptions;
+            HeadlessBackend backend = options.backend;
+            if (options.headless && backend == HeadlessBackend::Auto)
+                backend = has_display() ? HeadlessBackend::Hidden : HeadlessBackend::EGL;
+            resolvedBackend = backend;
+
+            // No display server: GLFW's null platform, the context comes from EGL or OSMesa
+            displayless = options.headless && backend != HeadlessBackend::Hidden;
+            if (displayless) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+
             initialized = glfwInit();
             if (!initialized) {
                 MAYAK_LOG_ERROR("Failed to initialize GLFW");
                 return false;
             }
-            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-            glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-            MAYAK_LOG_DEBUG("Initialized GLFW");
+            _apply_window_hints();
+            MAYAK_LOG_DEBUG(options.headless ? "Initialized GLFW (headless)" : "Initialized GLFW");
             return true;
         }
     }
@@ -29,4 +57,31 @@ namespace mayak::core {
         if (initialized) glfwTerminate();
         std::exit(code);
     }
-}
\ No newline at end of file
+
+    bool is_headless() {
+        return options.headless;
+    }
+
+    HeadlessBackend headless_backend() {
+        return resolvedBackend;
+    }
+
+    bool is_displayless() {
+        return displayless;
+    }
+
+    void _apply_window_hints() {
+        glfwDefaultWindowHints();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        if (options.headless) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        if (resolvedBackend == HeadlessBackend::EGL) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+        if (resolvedBackend == HeadlessBackend::OSMesa) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
+
+    void _fall_back_to_osmesa() {
+        resolvedBackend = HeadlessBackend::OSMesa;
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
+}
@@ -0,0 +1,286 @@
+#include "core/Jobs.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace mayak::core::detail {
+    struct Job {
+        JobFn fn;
+        std::atomic<int> pendingDeps{1}; // the 1 is Run() itself, until the dependencies are wired up
+        std::atomic<bool> done{false};
+        std::mutex mutex;                // guards continuations and done -> true
+        std::vector<std::shared_ptr<Job>> continuations;
+        std::shared_ptr<Job> self;       // keeps it alive while it sits in a queue
+    };
+}
+
+namespace {
+    using mayak::core::detail::Job;
+
+    // Idle workers spin this many times before they go to sleep
+    constexpr int IDLE_SPINS = 64;
+
+    struct WorkerIdentity {
+        const mayak::core::JobSystem* system = nullptr;
+        int index = -1;
+    };
+    thread_local WorkerIdentity current;
+
+    void pin_thread(std::thread& thread, unsigned core) {
+        #if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core % CPU_SETSIZE, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+        #elif defined(_WIN32)
+        SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << (core % (sizeof(DWORD_PTR) * 8)));
+        #else
+        (void)thread;
+        (void)core;
+        #endif
+    }
+}
+
+bool mayak::core::detail::WorkDeque::Push(Job* job) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= CAPACITY) return false;
+    buffer[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+mayak::core::detail::Job* mayak::core::detail::WorkDeque::Pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        // Empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job* job = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+        // Last one, a thief may be going for it too
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+mayak::core::detail::Job* mayak::core::detail::WorkDeque::Steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b) return nullptr;
+
+    Job* job = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr; // lost the race, the caller just tries elsewhere
+    return job;
+}
+
+bool mayak::core::JobHandle::Done() const {
+    return !job || job->done.load(std::memory_order_acquire);
+}
+
+mayak::core::JobSystem::JobSystem(const JobSystemOptions& options) {
+    int count = options.workers;
+    if (count < 0) count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+
+    for (int i = 0; i < count; ++i) workers.push_back(std::make_unique<Worker>());
+    // Start them only once the vector is complete, they steal from each other
+    for (int i = 0; i < count; ++i) {
+        workers[i]->thread = std::thread([this, i] { WorkerMain(i); });
+        if (options.pinThreads) pin_thread(workers[i]->thread, static_cast<unsigned>(i + 1));
+    }
+    MAYAK_LOG_DEBUG("Job system started with " + std::to_string(count) + " workers");
+}
+
+mayak::core::JobSystem::~JobSystem() {
+    // Finish what's queued, jobs hold references to themselves until they ran
+    while (queued.load() > 0) {
+        if (Job* job = FindJob(-1)) Execute(job);
+        else std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) worker->thread.join();
+}
+
+mayak::core::JobHandle mayak::core::JobSystem::Run(JobFn fn) {
+    auto job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+    job->pendingDeps = 0;
+    Schedule(job);
+    return JobHandle(job);
+}
+
+mayak::core::JobHandle mayak::core::JobSystem::Run(JobFn fn, std::initializer_list<JobHandle> dependencies) {
+    return Run(std::move(fn), std::vector<JobHandle>(dependencies));
+}
+
+mayak::core::JobHandle mayak::core::JobSystem::Run(JobFn fn, const std::vector<JobHandle>& dependencies) {
+    auto job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+
+    for (const JobHandle& dependency : dependencies) {
+        if (!dependency.job) continue;
+        std::lock_guard<std::mutex> lock(dependency.job->mutex);
+        if (dependency.job->done) continue;
+        dependency.job->continuations.push_back(job);
+        job->pendingDeps.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Drop Run()'s own count, if every dependency already finished it goes right away
+    if (job->pendingDeps.fetch_sub(1, std::memory_order_acq_rel) == 1) Schedule(job);
+    return JobHandle(job);
+}
+
+void mayak::core::JobSystem::Schedule(std::shared_ptr<Job> job) {
+    Job* raw = job.get();
+    raw->self = std::move(job);
+    queued.fetch_add(1);
+
+    bool pushed = current.system == this && workers[current.index]->deque.Push(raw);
+    if (!pushed) {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        injected.push_back(raw);
+        injectedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (sleeping.load() > 0) {
+        // Taking the lock makes sure a worker that's about to sleep sees the job
+        { std::lock_guard<std::mutex> lock(injectMutex); }
+        wake.notify_one();
+    }
+}
+
+void mayak::core::JobSystem::Execute(Job* job) {
+    std::shared_ptr<Job> keepAlive = std::move(job->self);
+    job->fn();
+    job->fn = nullptr;
+
+    std::vector<std::shared_ptr<Job>> continuations;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done.store(true, std::memory_order_release);
+        continuations.swap(job->continuations);
+    }
+    for (auto& next : continuations)
+        if (next->pendingDeps.fetch_sub(1, std::memory_order_acq_rel) == 1) Schedule(std::move(next));
+}
+
+mayak::core::detail::Job* mayak::core::JobSystem::FindJob(int self) {
+    Job* job = nullptr;
+    if (self >= 0) job = workers[self]->deque.Pop();
+
+    if (!job && injectedCount.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        if (!injected.empty()) {
+            job = injected.front();
+            injected.pop_front();
+            injectedCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!job && !workers.empty()) {
+        // Start somewhere different every time so thieves don't all pile on worker 0
+        std::size_t count = workers.size();
+        std::size_t start = static_cast<std::size_t>(self + 1 + steals.load(std::memory_order_relaxed)) % count;
+        for (std::size_t i = 0; i < count && !job; ++i) {
+            std::size_t victim = (start + i) % count;
+            if (static_cast<int>(victim) == self) continue;
+            job = workers[victim]->deque.Steal();
+            if (job) steals.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (job) queued.fetch_sub(1);
+    return job;
+}
+
+void mayak::core::JobSystem::WorkerMain(int index) {
+    current = WorkerIdentity{this, index};
+    int idle = 0;
+    while (true) {
+        if (Job* job = FindJob(index)) {
+            Execute(job);
+            idle = 0;
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        sleeping.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(injectMutex);
+            wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+        }
+        sleeping.fetch_sub(1);
+        idle = 0;
+        if (stopping) break;
+    }
+}
+
+void mayak::core::JobSystem::Wait(const JobHandle& handle) {
+    int self = current.system == this ? current.index : -1;
+    while (!handle.Done()) {
+        if (Job* job = FindJob(self)) Execute(job);
+        else std::this_thread::yield();
+    }
+}
+
+void mayak::core::JobSystem::Wait(const std::vector<JobHandle>& handles) {
+    for (const JobHandle& handle : handles) Wait(handle);
+}
+
+void mayak::core::JobSystem::Invoke(const JobFn& a, const JobFn& b) {
+    JobHandle other = Run(b);
+    a();
+    Wait(other);
+}
+
+void mayak::core::JobSystem::Split(std::size_t begin, std::size_t end, std::size_t grain,
+                                   const std::function<void(std::size_t, std::size_t)>& body) {
+    // Keep halving, hand the right halves out and do the last left piece ourselves.
+    // Thieves take the oldest (biggest) halves, so work spreads in log(n) steals
+    std::vector<JobHandle> forks;
+    while (end - begin > grain) {
+        std::size_t mid = begin + (end - begin) / 2;
+        forks.push_back(Run([this, mid, end, grain, &body] { Split(mid, end, grain, body); }));
+        end = mid;
+    }
+    body(begin, end);
+    Wait(forks);
+}
+
+void mayak::core::JobSystem::ParallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                                         const std::function<void(std::size_t, std::size_t)>& body) {
+    if (begin >= end) return;
+    if (grain == 0) {
+        // A few chunks per thread, so a slow chunk doesn't leave everyone else idle
+        std::size_t chunks = (workers.size() + 1) * 4;
+        grain = std::max<std::size_t>(1, (end - begin) / chunks);
+    }
+    Split(begin, end, grain, body);
+}
+
+mayak::core::JobSystem& mayak::core::job_system() {
+    static JobSystem system;
+    return system;
+}
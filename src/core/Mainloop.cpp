@@ -1,4 +1,254 @@
 #include "core/Mainloop.hpp"
-// nah i'll do it later
+#include "core/FrameArena.hpp"
+#include "core/Init.hpp"
+#include "core/Pacing.hpp"
+#include "core/Power.hpp"
+#include "core/RenderThread.hpp"
+#include "core/Startup.hpp"
+#include "core/Time.hpp"
+#include "core/Window.hpp"
+#include "event/Input.hpp"
+#include "utils/logger.hpp"
 
-void mayak::core::mainloop() {}
\ No newline at end of file
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace {
+    struct Timer {
+        int id;
+        int64_t deadline; // time::now_ns()
+        int64_t interval;
+        bool repeat;
+        mayak::core::Task task;
+    };
+
+    mayak::core::FrameCallback frameCallback = nullptr;
+    mayak::core::LoopMode mode = mayak::core::LoopMode::OnDemand;
+
+    std::atomic<bool> running{false};
+    std::atomic<bool> dirty{true}; // first frame always gets drawn
+    uint64_t frames = 0;
+    int64_t lastFrame = 0;
+    bool suspended = false;
+
+    std::mutex taskMutex;
+    std::vector<mayak::core::Task> tasks;
+    // GLFW's null platform can't sleep in glfwWaitEvents(), headless waits on this instead
+    std::condition_variable wakeup;
+
+    std::vector<Timer> timers;
+    int nextTimerId = 1;
+    // Cancelled while fire_timers() runs, their copies in the due batch get skipped
+    std::vector<int> cancelledWhileFiring;
+    bool firingTimers = false;
+
+    // Repeating timers below this would spin the loop without ever sleeping
+    constexpr int64_t MIN_REPEAT_INTERVAL_NS = 1'000'000;
+
+    bool has_tasks() {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        return !tasks.empty();
+    }
+
+    void run_tasks() {
+        std::vector<mayak::core::Task> pending;
+        {
+            std::lock_guard<std::mutex> lock(taskMutex);
+            pending.swap(tasks);
+        }
+        for (auto& task : pending) task();
+    }
+
+    void fire_timers() {
+        int64_t now = mayak::core::time::now_ns();
+        // Collect first, a timer callback may add or cancel timers
+        std::vector<Timer> due;
+        for (auto it = timers.begin(); it != timers.end();) {
+            if (it->deadline > now) { ++it; continue; }
+            due.push_back(*it);
+            if (it->repeat) {
+                it->deadline = now + it->interval;
+                ++it;
+            } else {
+                it = timers.erase(it);
+            }
+        }
+        firingTimers = true;
+        for (auto& timer : due) {
+            bool cancelled = std::find(cancelledWhileFiring.begin(), cancelledWhileFiring.end(), timer.id)
+                             != cancelledWhileFiring.end();
+            if (!cancelled) timer.task();
+        }
+        firingTimers = false;
+        cancelledWhileFiring.clear();
+    }
+
+    bool all_windows_closing() {
+        const auto& open = mayak::core::windows();
+        if (open.empty()) return false; // headless use, quit() ends the loop
+        for (auto* window : open)
+            if (!window->ShouldClose()) return false;
+        return true;
+    }
+
+    void wake_up() {
+        if (!mayak::core::initialized) return;
+        if (mayak::core::is_displayless()) {
+            std::lock_guard<std::mutex> lock(taskMutex);
+            wakeup.notify_one();
+        } else {
+            glfwPostEmptyEvent();
+        }
+    }
+
+    bool has_work() {
+        return mode == mayak::core::LoopMode::Continuous || dirty || !running || !tasks.empty();
+    }
+
+    void wait_displayless(int64_t timeoutNs) {
+        std::unique_lock<std::mutex> lock(taskMutex);
+        if (timeoutNs < 0) wakeup.wait(lock, has_work);
+        else wakeup.wait_for(lock, std::chrono::nanoseconds(timeoutNs), has_work);
+    }
+
+    // Earliest start of the next frame, 0 = whenever
+    int64_t frame_not_before() {
+        int64_t interval = mayak::core::power::min_frame_interval_ns();
+        return interval && lastFrame ? lastFrame + interval : 0;
+    }
+
+    void wait_for_work() {
+        using namespace mayak::core;
+        int64_t now = time::now_ns();
+        int64_t wakeAt = -1; // nothing scheduled, sleep until an event comes
+
+        // Suspended: even Continuous mode sleeps, only events and timers wake us
+        bool wantsFrame = !power::is_suspended() && (mode == LoopMode::Continuous || dirty);
+        if (has_tasks()) wakeAt = now;
+        else if (wantsFrame) wakeAt = std::max(now, frame_not_before());
+
+        if (!timers.empty()) {
+            int64_t next = std::min_element(timers.begin(), timers.end(),
+                [](const Timer& a, const Timer& b) { return a.deadline < b.deadline; })->deadline;
+            wakeAt = wakeAt < 0 ? next : std::min(wakeAt, next);
+        }
+        int64_t timeout = wakeAt < 0 ? -1 : std::max<int64_t>(wakeAt - now, 0);
+
+        if (mayak::core::is_displayless()) {
+            wait_displayless(timeout);
+            glfwPollEvents();
+        } else if (timeout < 0) {
+            glfwWaitEvents();
+        } else if (timeout > 0) {
+            glfwWaitEventsTimeout(mayak::core::time::to_seconds(timeout));
+        } else {
+            glfwPollEvents();
+        }
+    }
+}
+
+void mayak::core::mainloop() {
+    if (!initialized) {
+        MAYAK_LOG_WARN("First initialize GLFW!");
+        return;
+    }
+
+    running = true;
+    while (running) {
+        wait_for_work();
+        run_tasks();
+        fire_timers();
+
+        if (all_windows_closing()) {
+            running = false;
+            break;
+        }
+
+        if (power::is_suspended()) {
+            // Keep dirty as it is, the first frame after the pause needs it
+            suspended = true;
+            continue;
+        }
+        if (suspended) {
+            suspended = false;
+            dirty = true;
+            if (power::power_settings().fastForwardOnResume) time::frame_clock().MarkResumed();
+        }
+
+        if (!dirty && mode != LoopMode::Continuous) continue;
+        // Throttled, wait_for_work() wakes up right when it's time
+        if (time::now_ns() < frame_not_before()) continue;
+        dirty = false;
+
+        lastFrame = time::now_ns();
+        pacing::_begin_frame();
+        time::frame_clock().Tick();
+        _begin_frame_arena();
+        if (frameCallback) frameCallback();
+        // With a render thread the frame callback only submits a packet, drawing happens over there
+        if (!render_thread_active()) render_windows();
+        pacing::_end_frame();
+        if (frames++ == 0) startup::_first_frame_presented();
+        // Samples that come in from now on belong to the next frame
+        input::_begin_pointer_frame();
+    }
+}
+
+void mayak::core::quit() {
+    running = false;
+    wake_up();
+}
+
+void mayak::core::set_frame_callback(FrameCallback callback) {
+    frameCallback = callback;
+}
+
+void mayak::core::set_loop_mode(LoopMode newMode) {
+    mode = newMode;
+}
+
+mayak::core::LoopMode mayak::core::loop_mode() {
+    return mode;
+}
+
+void mayak::core::invalidate() {
+    // Only wake the loop on the clean -> dirty edge, one wakeup is enough
+    if (!dirty.exchange(true)) wake_up();
+}
+
+void mayak::core::post_task(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        tasks.push_back(std::move(task));
+    }
+    wake_up();
+}
+
+int mayak::core::add_timer(double seconds, Task task, bool repeat) {
+    int id = nextTimerId++;
+    int64_t interval = time::to_ns(seconds);
+    if (repeat && interval < MIN_REPEAT_INTERVAL_NS) {
+        MAYAK_LOG_WARN("Repeating timer interval too short, using 1 ms");
+        interval = MIN_REPEAT_INTERVAL_NS;
+    }
+    timers.push_back(Timer{id, time::now_ns() + interval, interval, repeat, std::move(task)});
+    return id;
+}
+
+void mayak::core::cancel_timer(int id) {
+    if (firingTimers) cancelledWhileFiring.push_back(id);
+    timers.erase(std::remove_if(timers.begin(), timers.end(),
+        [id](const Timer& t) { return t.id == id; }), timers.end());
+}
+
+uint64_t mayak::core::frame_count() {
+    return frames;
+}
+
+void mayak::core::_advance_frame_count() {
+    ++frames;
+}
@@ -0,0 +1,309 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "core/Pacing.hpp"
+#include "core/Time.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+    using namespace mayak::core;
+    using pacing::FrameReport;
+
+    // GPU results come back a few frames late, keep this many in flight
+    constexpr std::size_t QUERY_RING = 4;
+    constexpr std::size_t REPORT_HISTORY = 120;
+    // Sleep granularity is bad, the last bit of waiting is done with yield()
+    constexpr int64_t SPIN_NS = 500'000;
+    // Adaptive fps: how many of the last frames may miss before we step down
+    constexpr int MISSES_TO_DROP = 6;
+    constexpr int CALM_FRAMES_TO_RAISE = 180;
+    constexpr double CALM_FRACTION = 0.6;
+    // Late-latch's p95 sorts the whole history, refreshing it this often is plenty
+    constexpr uint64_t EXPECTED_REFRESH_FRAMES = 30;
+
+    struct PendingFrame {
+        uint64_t frame = 0;
+        int64_t budgetNs = 0;
+        int64_t cpuNs = 0;
+        int64_t sleptNs = 0;
+        GLuint query = 0;
+        bool inFlight = false;
+    };
+
+    pacing::PacingSettings settings;
+    pacing::BudgetCallback budgetCallback = nullptr;
+
+    int tearSupport = -1;      // -1 = don't know yet
+    int divisor = 1;           // adaptive fps runs at base rate / divisor
+    int recentMisses = 0;
+    int calmFrames = 0;
+
+    int64_t frameBegin = 0;  // when the previous / current frame started working
+    int64_t lastPresent = 0;
+    int64_t sleptThisFrame = 0;
+    int64_t swapThisFrame = 0; // blocked in glfwSwapBuffers(), that's not CPU work
+    int64_t expectedCpuNs = 0; // cached p95 of cpuHistory
+    uint64_t frameNumber = 0;
+    uint64_t overBudget = 0;
+
+    time::FrameHistory cpuHistory;
+
+    std::array<PendingFrame, QUERY_RING> pending;
+    std::size_t pendingHead = 0;
+    GLFWwindow* queryContext = nullptr; // query objects aren't shared, they live here
+    bool queryActive = false;
+    bool queryEnded = false; // this frame's query is done, _end_frame() files it
+
+    std::array<FrameReport, REPORT_HISTORY> reports;
+    std::size_t reportTotal = 0;
+
+    double base_fps() {
+        if (settings.targetFps > 0) return settings.targetFps;
+        GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+        const GLFWvidmode* mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+        return mode && mode->refreshRate > 0 ? mode->refreshRate : 60.0;
+    }
+
+    int64_t period_ns() {
+        return static_cast<int64_t>(1e9 / (base_fps() / divisor));
+    }
+
+    bool gpu_timing_available() {
+        // Timer queries are core since 3.3, glad leaves this at 0 if it didn't load
+        return GLAD_GL_VERSION_3_3 && glfwGetCurrentContext();
+    }
+
+    void sleep_until(int64_t deadline) {
+        int64_t remaining = deadline - time::now_ns();
+        if (remaining > SPIN_NS)
+            std::this_thread::sleep_for(std::chrono::nanoseconds(remaining - SPIN_NS));
+        while (time::now_ns() < deadline) std::this_thread::yield();
+    }
+
+    void adapt(const FrameReport& report) {
+        if (!settings.adaptiveFps) return;
+        bool missed = report.cpuOverBudget || report.gpuOverBudget;
+        int64_t busy = std::max(report.cpuNs, report.gpuNs);
+
+        recentMisses = missed ? recentMisses + 1 : std::max(recentMisses - 1, 0);
+        calmFrames = busy < report.budgetNs * CALM_FRACTION / 2 ? calmFrames + 1 : 0;
+
+        if (recentMisses >= MISSES_TO_DROP && divisor < 4) {
+            ++divisor;
+            recentMisses = 0;
+            MAYAK_LOG_DEBUG("Frame pacing: dropping to " + std::to_string(base_fps() / divisor) + " fps");
+            if (glfwGetCurrentContext()) pacing::apply_swap_interval();
+        } else if (calmFrames >= CALM_FRAMES_TO_RAISE && divisor > 1) {
+            // Calm means it would still fit with half the time, so going up one step is safe
+            --divisor;
+            calmFrames = 0;
+            MAYAK_LOG_DEBUG("Frame pacing: raising to " + std::to_string(base_fps() / divisor) + " fps");
+            if (glfwGetCurrentContext()) pacing::apply_swap_interval();
+        }
+    }
+
+    void file_report(const PendingFrame& frame, int64_t gpuNs) {
+        FrameReport report;
+        report.frame = frame.frame;
+        report.budgetNs = frame.budgetNs;
+        report.cpuNs = frame.cpuNs;
+        report.gpuNs = gpuNs;
+        report.sleptNs = frame.sleptNs;
+        report.cpuOverBudget = frame.cpuNs > frame.budgetNs;
+        report.gpuOverBudget = gpuNs > frame.budgetNs;
+
+        reports[reportTotal % REPORT_HISTORY] = report;
+        ++reportTotal;
+
+        if (report.cpuOverBudget || report.gpuOverBudget) {
+            ++overBudget;
+            MAYAK_LOG_TRACE("Frame " + std::to_string(report.frame) + " over budget: cpu "
+                + std::to_string(report.cpuNs / 1000) + " us, gpu "
+                + std::to_string(report.gpuNs / 1000) + " us, budget "
+                + std::to_string(report.budgetNs / 1000) + " us");
+            if (budgetCallback) budgetCallback(report);
+        }
+        adapt(report);
+    }
+
+    void collect_gpu_results(bool wait) {
+        for (auto& frame : pending) {
+            if (!frame.inFlight) continue;
+            GLint available = 0;
+            glGetQueryObjectiv(frame.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available && !wait) continue;
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &elapsed);
+            frame.inFlight = false;
+            file_report(frame, static_cast<int64_t>(elapsed));
+        }
+    }
+}
+
+void mayak::core::pacing::set_pacing(const PacingSettings& newSettings) {
+    settings = newSettings;
+    divisor = 1;
+    recentMisses = calmFrames = 0;
+    if (glfwGetCurrentContext()) apply_swap_interval();
+}
+
+const mayak::core::pacing::PacingSettings& mayak::core::pacing::pacing() {
+    return settings;
+}
+
+int mayak::core::pacing::swap_interval() {
+    int interval = 1;
+    switch (settings.swapMode) {
+        case SwapMode::Immediate:
+            interval = 0;
+            break;
+        case SwapMode::VSync:
+            interval = 1;
+            break;
+        case SwapMode::AdaptiveVSync:
+            // Asking every frame is a string search in the driver, once is enough
+            if (tearSupport < 0 && glfwGetCurrentContext())
+                tearSupport = glfwExtensionSupported("WGL_EXT_swap_control_tear")
+                           || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+            interval = tearSupport > 0 ? -1 : 1;
+            break;
+    }
+    // Adaptive fps with vsync on: swapping every n-th vblank keeps frames evenly spaced
+    if (interval != 0 && settings.adaptiveFps && settings.targetFps <= 0) interval *= divisor;
+    return interval;
+}
+
+void mayak::core::pacing::apply_swap_interval() {
+    glfwSwapInterval(swap_interval());
+}
+
+void mayak::core::pacing::set_budget_callback(BudgetCallback callback) {
+    budgetCallback = callback;
+}
+
+double mayak::core::pacing::current_target_fps() {
+    return base_fps() / divisor;
+}
+
+std::size_t mayak::core::pacing::recent_reports(FrameReport* out, std::size_t max) {
+    std::size_t count = std::min({reportTotal, REPORT_HISTORY, max});
+    for (std::size_t i = 0; i < count; ++i)
+        out[i] = reports[(reportTotal - count + i) % REPORT_HISTORY];
+    return count;
+}
+
+uint64_t mayak::core::pacing::over_budget_count() {
+    return overBudget;
+}
+
+void mayak::core::pacing::_begin_frame() {
+    int64_t period = period_ns();
+    int64_t start = time::now_ns();
+
+    if (lastPresent > 0) {
+        int64_t deadline = lastPresent + period;
+        int64_t wakeAt = 0;
+        if (settings.lateLatch) {
+            // p95 so one lucky frame doesn't make us oversleep the next one
+            wakeAt = deadline - expectedCpuNs - settings.lateLatchMarginNs;
+        } else if (settings.swapMode == SwapMode::Immediate || settings.targetFps > 0) {
+            // Plain limiter, vsync already paces us otherwise
+            wakeAt = frameBegin + period;
+        }
+        if (wakeAt > start) {
+            sleep_until(wakeAt);
+            // Late-latch: grab whatever input came in while we slept
+            if (settings.lateLatch) glfwPollEvents();
+        }
+    }
+
+    frameBegin = time::now_ns();
+    sleptThisFrame = frameBegin - start;
+    swapThisFrame = 0;
+
+    if (gpu_timing_available()) {
+        if (!queryContext) {
+            queryContext = glfwGetCurrentContext();
+            for (auto& frame : pending) glGenQueries(1, &frame.query);
+        }
+        // Some other window's context, skip measuring instead of switching twice
+        if (glfwGetCurrentContext() != queryContext) return;
+
+        PendingFrame& slot = pending[pendingHead];
+        // Ring wrapped around onto a query the GPU still hasn't finished, just wait for it.
+        // The last frames may have ended somewhere else, their results get picked up here
+        collect_gpu_results(slot.inFlight);
+        glBeginQuery(GL_TIME_ELAPSED, slot.query);
+        queryActive = true;
+    }
+}
+
+void mayak::core::pacing::_forget_context(GLFWwindow* context) {
+    if (!context || context != queryContext) return;
+    GLFWwindow* previous = glfwGetCurrentContext();
+    if (previous != context) glfwMakeContextCurrent(context);
+    if (queryActive) glEndQuery(GL_TIME_ELAPSED);
+    // Whatever is still in flight won't be read anymore, those frames go unreported
+    for (auto& frame : pending) {
+        glDeleteQueries(1, &frame.query);
+        frame = PendingFrame{};
+    }
+    if (previous != context) glfwMakeContextCurrent(previous);
+    // The next _begin_frame() creates new ones in whatever context is current then
+    queryContext = nullptr;
+    queryActive = false;
+    queryEnded = false;
+    pendingHead = 0;
+}
+
+void mayak::core::pacing::_leaving_context() {
+    if (!queryActive || glfwGetCurrentContext() != queryContext) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    queryActive = false;
+    queryEnded = true;
+}
+
+void mayak::core::pacing::_swap_blocked(int64_t ns) {
+    swapThisFrame += ns;
+}
+
+void mayak::core::pacing::_end_frame() {
+    int64_t end = time::now_ns();
+
+    PendingFrame frame;
+    frame.frame = frameNumber++;
+    frame.budgetNs = period_ns();
+    frame.cpuNs = end - frameBegin - swapThisFrame;
+    frame.sleptNs = sleptThisFrame;
+    cpuHistory.Push(frame.cpuNs);
+    if (settings.lateLatch && (frameNumber % EXPECTED_REFRESH_FRAMES == 1 || expectedCpuNs == 0))
+        expectedCpuNs = cpuHistory.Stats().p95;
+    lastPresent = end;
+
+    GLFWwindow* current = glfwGetCurrentContext();
+    if (queryActive) {
+        // render_windows() ends it before switching away, so this only switches if something
+        // else moved to another context with the query still running
+        if (current != queryContext) glfwMakeContextCurrent(queryContext);
+        _leaving_context();
+        if (current != queryContext) glfwMakeContextCurrent(current);
+    }
+
+    if (queryEnded) {
+        queryEnded = false;
+        frame.query = pending[pendingHead].query;
+        frame.inFlight = true;
+        pending[pendingHead] = frame;
+        pendingHead = (pendingHead + 1) % QUERY_RING;
+        // Somewhere else, the next _begin_frame() in the query's context reads it
+        if (current == queryContext) collect_gpu_results(false);
+    } else {
+        file_report(frame, -1);
+    }
+}
@@ -0,0 +1,37 @@
+#include "core/Power.hpp"
+#include "core/Init.hpp"
+#include "core/Time.hpp"
+#include "core/Window.hpp"
+
+namespace {
+    mayak::core::power::PowerSettings settings;
+}
+
+void mayak::core::power::set_power_settings(const PowerSettings& newSettings) {
+    settings = newSettings;
+}
+
+const mayak::core::power::PowerSettings& mayak::core::power::power_settings() {
+    return settings;
+}
+
+bool mayak::core::power::is_suspended() {
+    const auto& open = windows();
+    if (!settings.pauseWhenHidden || open.empty()) return false;
+    for (auto* window : open)
+        if (window->IsDrawable()) return false;
+    return true;
+}
+
+bool mayak::core::power::is_throttled() {
+    const auto& open = windows();
+    if (!settings.throttleWhenUnfocused || open.empty() || is_headless()) return false;
+    for (auto* window : open)
+        if (window->IsFocused()) return false;
+    return true;
+}
+
+int64_t mayak::core::power::min_frame_interval_ns() {
+    if (!is_throttled() || settings.unfocusedFps <= 0) return 0;
+    return time::to_ns(1.0 / settings.unfocusedFps);
+}
@@ -0,0 +1,25 @@
+#include <GLFW/glfw3.h>
+
+#include "core/RenderThread.hpp"
+#include "core/Window.hpp"
+
+namespace {
+    std::atomic<bool> active{false};
+}
+
+bool mayak::core::render_thread_active() {
+    return active;
+}
+
+void mayak::core::_set_render_thread_active(bool value) {
+    active = value;
+}
+
+void mayak::core::_release_contexts() {
+    // A context can only be current on one thread at a time
+    glfwMakeContextCurrent(nullptr);
+}
+
+void mayak::core::_render_frame() {
+    render_windows();
+}
@@ -0,0 +1,96 @@
+#include "core/Startup.hpp"
+#include "core/Time.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <deque>
+#include <string>
+
+namespace {
+    using mayak::core::startup::Phase;
+
+    constexpr std::size_t MAX_PHASES = 64;
+
+    // As close to process start as we can get without platform calls
+    const int64_t loadTime = mayak::core::time::now_ns();
+
+    std::array<Phase, MAX_PHASES> recorded;
+    std::size_t phaseCount = 0;
+    int64_t firstFrame = 0;
+    bool reportEnabled = true;
+
+    std::deque<mayak::core::Task> deferred;
+
+    std::string to_ms(int64_t ns) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%8.2f ms", ns * 1e-6);
+        return buffer;
+    }
+
+    // Runs one deferred task, then queues itself for the next iteration
+    void run_next_deferred() {
+        if (deferred.empty()) return;
+        mayak::core::Task task = std::move(deferred.front());
+        deferred.pop_front();
+        task();
+        if (!deferred.empty()) mayak::core::post_task(run_next_deferred);
+    }
+}
+
+mayak::core::startup::Scope::Scope(const char* name) : name(name), start(time::now_ns()) {}
+
+mayak::core::startup::Scope::~Scope() {
+    record(name, start, time::now_ns());
+}
+
+void mayak::core::startup::record(const char* name, int64_t startNs, int64_t endNs) {
+    if (firstFrame || phaseCount == MAX_PHASES) return;
+    recorded[phaseCount++] = Phase{name, startNs - loadTime, endNs - startNs};
+}
+
+void mayak::core::startup::defer(Task task) {
+    if (firstFrame) {
+        post_task(std::move(task));
+        return;
+    }
+    deferred.push_back(std::move(task));
+}
+
+void mayak::core::startup::set_report_enabled(bool enabled) {
+    reportEnabled = enabled;
+}
+
+void mayak::core::startup::report() {
+    int64_t accounted = 0;
+    for (std::size_t i = 0; i < phaseCount; ++i) {
+        const Phase& phase = recorded[i];
+        accounted += phase.durationNs;
+        MAYAK_LOG_INFO("Startup: " + to_ms(phase.durationNs) + "  " + phase.name
+            + " (at " + to_ms(phase.startNs) + ")");
+    }
+    if (firstFrame) {
+        int64_t total = firstFrame - loadTime;
+        MAYAK_LOG_INFO("Startup: " + to_ms(total - accounted) + "  everything else");
+        MAYAK_LOG_INFO("Startup: " + to_ms(total) + "  to first frame, "
+            + std::to_string(deferred.size()) + " tasks deferred");
+    }
+}
+
+std::size_t mayak::core::startup::phases(Phase* out, std::size_t max) {
+    std::size_t count = std::min(phaseCount, max);
+    std::copy_n(recorded.begin(), count, out);
+    return count;
+}
+
+int64_t mayak::core::startup::time_to_first_frame_ns() {
+    return firstFrame ? firstFrame - loadTime : 0;
+}
+
+void mayak::core::startup::_first_frame_presented() {
+    if (firstFrame) return;
+    firstFrame = time::now_ns();
+    if (reportEnabled) report();
+    if (!deferred.empty()) post_task(run_next_deferred);
+}
@@ -0,0 +1,94 @@
+#include "core/Time.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    // Weight of the newest frame in the smoothed delta
+    constexpr double SMOOTHING = 0.1;
+
+    mayak::core::time::FrameClock mainClock;
+}
+
+int64_t mayak::core::time::now_ns() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void mayak::core::time::FrameHistory::Push(int64_t frameNs) {
+    samples[total % HISTORY_SIZE] = frameNs;
+    ++total;
+}
+
+mayak::core::time::FrameStats mayak::core::time::FrameHistory::Stats() const {
+    FrameStats stats;
+    stats.count = Count();
+    if (stats.count == 0) return stats;
+
+    std::array<int64_t, HISTORY_SIZE> sorted;
+    std::copy_n(samples.begin(), stats.count, sorted.begin());
+    std::sort(sorted.begin(), sorted.begin() + stats.count);
+
+    // Nearest rank percentile
+    auto rank = [&](double p) {
+        std::size_t index = static_cast<std::size_t>(p * (stats.count - 1) + 0.5);
+        return sorted[index];
+    };
+    stats.p50 = rank(0.50);
+    stats.p95 = rank(0.95);
+    stats.p99 = rank(0.99);
+    stats.max = sorted[stats.count - 1];
+
+    int64_t sum = 0;
+    for (std::size_t i = 0; i < stats.count; ++i) sum += sorted[i];
+    stats.average = sum / static_cast<int64_t>(stats.count);
+    return stats;
+}
+
+void mayak::core::time::FrameClock::Tick(int64_t nowNs) {
+    // The very first frame has nothing to measure against
+    delta = frame == 0 ? 0 : nowNs - frameStart;
+    frameStart = nowNs;
+    fastForwarded = resumed;
+    resumed = false;
+
+    // A paused gap says nothing about how fast frames are, keep it out of the stats
+    if (frame > 0 && !fastForwarded) {
+        double seconds = to_seconds(delta);
+        // The first measured frame starts it, the one after a fast-forwarded start too
+        smoothed = history.Count() == 0 ? seconds : smoothed + (seconds - smoothed) * SMOOTHING;
+        history.Push(delta);
+    }
+    ++frame;
+}
+
+mayak::core::time::FixedStep::FixedStep(double stepSeconds, int maxSteps)
+    : step(stepSeconds > 0 ? stepSeconds : 1.0 / 120.0), maxSteps(maxSteps) {}
+
+int mayak::core::time::FixedStep::Advance(double deltaSeconds) {
+    accumulator += std::max(deltaSeconds, 0.0);
+    int steps = static_cast<int>(accumulator / step);
+    if (steps > maxSteps) {
+        steps = maxSteps;
+        accumulator = 0; // drop the backlog instead of spiraling
+        return steps;
+    }
+    accumulator -= steps * step;
+    return steps;
+}
+
+mayak::core::time::FrameClock& mayak::core::time::frame_clock() {
+    return mainClock;
+}
+
+double mayak::core::time::delta() {
+    return mainClock.Delta();
+}
+
+double mayak::core::time::smoothed_delta() {
+    return mainClock.SmoothedDelta();
+}
+
+bool mayak::core::time::fast_forwarded() {
+    return mainClock.FastForwarded();
+}
@@ -1,32 +1,409 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
 #include "core/Window.hpp"
 #include "core/Init.hpp"
+#include "core/Mainloop.hpp"
+#include "core/Pacing.hpp"
+#include "core/RenderThread.hpp"
+#include "core/Startup.hpp"
+#include "core/Time.hpp"
+#include "event/Event.hpp"
+#include "event/Input.hpp"
+#include "gfx/Damage.hpp"
+#include "gfx/GLState.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    std::vector<mayak::core::Window*> registry;
+    GLFWwindow* sharedRoot = nullptr;
+    int nextId = 1;
+    mayak::core::ContentScaleCallback contentScaleCallback = nullptr;
+
+    bool create_shared_root() {
+        mayak::core::startup::Scope phase("shared GL context + glad");
+        // 1x1 and invisible, it only exists to own the shared objects
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        sharedRoot = glfwCreateWindow(1, 1, "mayak shared context", nullptr, nullptr);
+        if (!sharedRoot && mayak::core::is_displayless()
+                && mayak::core::headless_backend() == mayak::core::HeadlessBackend::EGL) {
+            // No usable EGL (no GPU, no surfaceless Mesa), software rendering it is
+            MAYAK_LOG_WARN("EGL context failed, falling back to OSMesa");
+            mayak::core::_fall_back_to_osmesa();
+            sharedRoot = glfwCreateWindow(1, 1, "mayak shared context", nullptr, nullptr);
+        }
+        mayak::core::_apply_window_hints();
+        if (!sharedRoot) {
+            MAYAK_LOG_ERROR("Failed to create the shared GL context.");
+            return false;
+        }
+
+        glfwMakeContextCurrent(sharedRoot);
+        if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress))) {
+            MAYAK_LOG_ERROR("Failed to load OpenGL functions.");
+            glfwDestroyWindow(sharedRoot);
+            sharedRoot = nullptr;
+            return false;
+        }
+        MAYAK_LOG_DEBUG(std::string("Shared GL context created: ") + reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+        return true;
+    }
+
+    void swap_buffers(GLFWwindow* window) {
+        int64_t start = mayak::core::time::now_ns();
+        glfwSwapBuffers(window);
+        // Waiting for vblank isn't CPU cost. The render thread's swaps aren't the main thread's either
+        if (!mayak::core::render_thread_active())
+            mayak::core::pacing::_swap_blocked(mayak::core::time::now_ns() - start);
+    }
+
+    mayak::core::Window* from_handle(GLFWwindow* handle) {
+        return static_cast<mayak::core::Window*>(glfwGetWindowUserPointer(handle));
+    }
+
+    // The platform's own functions, through glfwGetProcAddress(), glfw3native.h would
+    // drag X11 and EGL headers (and their macros) in for just these
+    constexpr int EGL_DRAW_SURFACE = 0x3059;
+    constexpr int EGL_BUFFER_AGE = 0x313D;
+    constexpr int GLX_BACK_BUFFER_AGE = 0x20F4;
+    using CurrentFn = void* (*)();
+    using EglCurrentSurfaceFn = void* (*)(int readDraw);
+    using EglQuerySurfaceFn = unsigned (*)(void* display, void* surface, int attribute, int* value);
+    using GlxCurrentDrawableFn = unsigned long (*)();
+    using GlxQueryDrawableFn = void (*)(void* display, unsigned long drawable, int attribute, unsigned* value);
+
+    bool uses_egl(GLFWwindow* handle) {
+        return glfwGetWindowAttrib(handle, GLFW_CONTEXT_CREATION_API) == GLFW_EGL_CONTEXT_API
+            || glfwGetPlatform() == GLFW_PLATFORM_WAYLAND;
+    }
+
+    bool buffer_age_supported(GLFWwindow* handle) {
+        if (uses_egl(handle)) return glfwExtensionSupported("EGL_EXT_buffer_age");
+        return glfwGetPlatform() == GLFW_PLATFORM_X11 && glfwExtensionSupported("GLX_EXT_buffer_age");
+    }
+
+    /// How many frames old the back buffer of the current context is, 0 = unknown / garbage
+    int query_buffer_age(GLFWwindow* handle) {
+        if (uses_egl(handle)) {
+            static auto display = reinterpret_cast<CurrentFn>(glfwGetProcAddress("eglGetCurrentDisplay"));
+            static auto surface = reinterpret_cast<EglCurrentSurfaceFn>(glfwGetProcAddress("eglGetCurrentSurface"));
+            static auto query = reinterpret_cast<EglQuerySurfaceFn>(glfwGetProcAddress("eglQuerySurface"));
+            int age = 0;
+            if (display && surface && query && !query(display(), surface(EGL_DRAW_SURFACE), EGL_BUFFER_AGE, &age))
+                return 0;
+            return age;
+        }
+        static auto display = reinterpret_cast<CurrentFn>(glfwGetProcAddress("glXGetCurrentDisplay"));
+        static auto drawable = reinterpret_cast<GlxCurrentDrawableFn>(glfwGetProcAddress("glXGetCurrentDrawable"));
+        static auto query = reinterpret_cast<GlxQueryDrawableFn>(glfwGetProcAddress("glXQueryDrawable"));
+        unsigned age = 0;
+        if (display && drawable && query) query(display(), drawable(), GLX_BACK_BUFFER_AGE, &age);
+        return int(age);
+    }
+
+    /// The back buffer may be gone (exposed, restored), partial redraw has to start over
+    void damage_all(mayak::core::Window* window) {
+        if (window && window->IsPartialRedraw()) window->Invalidate();
+    }
+
+    void on_size(GLFWwindow* handle, int w, int h) {
+        if (auto* window = from_handle(handle)) window->_set_size(w, h);
+        mayak::core::invalidate();
+    }
+
+    void on_framebuffer_size(GLFWwindow* handle, int w, int h) {
+        if (auto* window = from_handle(handle)) window->_set_framebuffer_size(w, h);
+        mayak::core::invalidate();
+    }
+
+    void on_content_scale(GLFWwindow* handle, float x, float y) {
+        auto* window = from_handle(handle);
+        if (!window) return;
+        float old = window->GetContentScale().x;
+        window->_set_content_scale(x, y);
+        damage_all(window);
+        if (contentScaleCallback && old != x) contentScaleCallback(*window, old, x);
+        mayak::core::invalidate();
+    }
+
+    void on_iconify(GLFWwindow* handle, int iconified) {
+        auto* window = from_handle(handle);
+        if (window) window->_set_minimized(iconified == GLFW_TRUE);
+        if (!iconified) damage_all(window);
+        if (iconified) {
+            mayak::Event e;
+            e.type = mayak::EventType::WindowMinimalize;
+            mayak::emit_event(e);
+        }
+        // Restored windows need a fresh frame, minimized ones let the loop fall asleep
+        mayak::core::invalidate();
+    }
+
+    void on_focus(GLFWwindow* handle, int focused) {
+        if (auto* window = from_handle(handle)) window->_set_focused(focused == GLFW_TRUE);
+        mayak::core::invalidate();
+    }
+
+    void on_refresh(GLFWwindow* handle) {
+        damage_all(from_handle(handle));
+        mayak::core::invalidate();
+    }
+
+    void on_cursor_pos(GLFWwindow*, double x, double y) {
+        // Doubles from GLFW, sub-pixel motion is what the prediction fits its velocity on
+        mayak::core::input::_push_pointer_sample(float(x), float(y), mayak::core::time::now_ns());
+    }
+
+    void on_close(GLFWwindow*) {
+        // Wake the loop so it notices
+        mayak::core::invalidate();
+    }
+}
+
+mayak::core::Window::Window(int w, int h, const std::string& title) : width(w), height(h), id(nextId++) {
+    if (!initialized) {
+        MAYAK_LOG_WARN("First initialize GLFW!");
+        return;
+    }
+    if (!sharedRoot && !create_shared_root()) return;
+    startup::Scope phase("window");
+
+    window = glfwCreateWindow(width, height, title.c_str(), nullptr, sharedRoot);
+    if (!window) {
+        MAYAK_LOG_ERROR("Failed to create GLFW window.");
+        return;
+    }
+
+    glfwSetWindowUserPointer(window, this);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    glfwGetWindowContentScale(window, &contentScaleX, &contentScaleY);
+    // Invisible windows never get focus, that's no reason to treat them as in the background
+    focused = is_headless() || glfwGetWindowAttrib(window, GLFW_FOCUSED);
+
+    glfwSetWindowSizeCallback(window, on_size);
+    glfwSetFramebufferSizeCallback(window, on_framebuffer_size);
+    glfwSetWindowContentScaleCallback(window, on_content_scale);
+    glfwSetWindowIconifyCallback(window, on_iconify);
+    glfwSetWindowFocusCallback(window, on_focus);
+    glfwSetWindowRefreshCallback(window, on_refresh);
+    glfwSetWindowCloseCallback(window, on_close);
+    glfwSetCursorPosCallback(window, on_cursor_pos);
+
+    registry.push_back(this);
+    MakeCurrent();
+    if (is_headless()) UpdateOffscreenTarget();
 
-namespace mayak::core::window{
-    class Window {
-    private:
-        GLFWwindow* window;
-        int width, height;
-    public:
-        Window(int w, int h, const std::string& title) : width(w), height(h) {
-            if (!mayak::core::initialized) {
-                MAYAK_LOG_WARN("First initialize GLFW!");
-                return;
-            }
-            window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
-            if (!window) {
-                MAYAK_LOG_ERROR("Failed to create GLFW window.");
-                return;
-            }
-
-            glfwMakeContextCurrent(window);
-
-            MAYAK_LOG_DEBUG("Window created successfully!");
-        }
-
-        ~Window(){
-            if(window) {
-                glfwDestroyWindow(window);
-            }
+    MAYAK_LOG_DEBUG("Window created successfully!");
+}
+
+mayak::core::Window::~Window() {
+    registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+    if (window) {
+        if (partialRedraw) {
+            MakeCurrent();
+            partialRedraw->Destroy();
+        }
+        if (fbo) {
+            // FBOs belong to this context, the renderbuffers are shared but nobody else uses them
+            MakeCurrent();
+            gfx::State().ForgetFramebuffer(fbo);
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteRenderbuffers(1, &colorBuffer);
+            glDeleteRenderbuffers(1, &depthBuffer);
         }
+        // Query objects aren't shared, they'd leak with the context and pacing would keep using it
+        pacing::_forget_context(window);
+        // Don't leave a dangling current context behind
+        if (glfwGetCurrentContext() == window) glfwMakeContextCurrent(sharedRoot);
+        gfx::ForgetContext(window);
+        glfwDestroyWindow(window);
+    }
+}
+
+bool mayak::core::Window::ShouldClose() const {
+    return !window || glfwWindowShouldClose(window);
+}
+
+void mayak::core::Window::RequestClose() {
+    if (window) glfwSetWindowShouldClose(window, GLFW_TRUE);
+    invalidate();
+}
+
+void mayak::core::Window::MakeCurrent() {
+    if (window && glfwGetCurrentContext() != window) glfwMakeContextCurrent(window);
+}
+
+void mayak::core::Window::SetPartialRedraw(bool enabled) {
+    if (enabled == IsPartialRedraw() || !window) return;
+    MakeCurrent();
+    if (!enabled) {
+        partialRedraw->Destroy();
+        partialRedraw.reset();
+        invalidate();
+        return;
+    }
+    partialRedraw = std::make_unique<gfx::PartialRedraw>();
+    bufferAgeSupported = !is_headless() && buffer_age_supported(window);
+    MAYAK_LOG_DEBUG(std::string("Partial redraw on, buffer age ") + (bufferAgeSupported ? "supported" : "unknown"));
+    invalidate();
+}
+
+void mayak::core::Window::Invalidate(const vec2& position, const vec2& size) {
+    if (partialRedraw) {
+        // Whole pixels that cover it, a fraction left out would leave a stale sliver behind
+        vec2 topLeft = ToPixels(position), bottomRight = ToPixels(position + size);
+        int left = int(std::floor(topLeft.x)), top = int(std::floor(topLeft.y));
+        partialRedraw->Invalidate(gfx::ClipRect{left, top, int(std::ceil(bottomRight.x)) - left,
+                                                int(std::ceil(bottomRight.y)) - top});
+    }
+    invalidate();
+}
+
+void mayak::core::Window::Invalidate() {
+    if (partialRedraw) partialRedraw->InvalidateAll();
+    invalidate();
+}
+
+mayak::gfx::ClipRect mayak::core::Window::GetRedrawRegion() const {
+    return gfx::ClipRect{redrawRegion[0], redrawRegion[1], redrawRegion[2], redrawRegion[3]};
+}
+
+void mayak::core::Window::DrawPartial() {
+    gfx::PartialRedraw& redraw = *partialRedraw;
+    if (!redraw.Begin(framebufferWidth, framebufferHeight)) return;
+    // Before anything touches the back buffer. Headless draws into its own FBO, that one's always last frame's
+    int age = fbo ? 1 : bufferAgeSupported ? query_buffer_age(window) : 0;
+
+    gfx::GLState& gl = gfx::State();
+    gl.BindFramebuffer(GL_FRAMEBUFFER, redraw.Framebuffer());
+    gl.SetViewport(0, 0, framebufferWidth, framebufferHeight);
+    for (const gfx::ClipRect& region : redraw.Regions()) {
+        bool full = redraw.IsFull();
+        gfx::ClipRect current = full ? gfx::ClipRect{} : region;
+        redrawRegion[0] = current.x;
+        redrawRegion[1] = current.y;
+        redrawRegion[2] = current.width;
+        redrawRegion[3] = current.height;
+        // Catches glClear() and raw GL, the batch scissors by itself from its bounds
+        gl.SetScissorTest(!full);
+        if (!full) gl.SetScissor(region.x, framebufferHeight - region.y - region.height, region.width, region.height);
+        drawCallback(*this);
+    }
+    redrawRegion[2] = redrawRegion[3] = -1;
+    gl.SetScissorTest(false);
+
+    redraw.Present(fbo, age);
+    if (!fbo) swap_buffers(window);
+    redraw.End();
+}
+
+void mayak::core::Window::UpdateOffscreenTarget() {
+    if (fbo && fboWidth == framebufferWidth && fboHeight == framebufferHeight) return;
+    if (!fbo) {
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &colorBuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+    }
+    fboWidth = framebufferWidth;
+    fboHeight = framebufferHeight;
+
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, fboWidth, fboHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, fboWidth, fboHeight);
+
+    gfx::State().BindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        MAYAK_LOG_ERROR("Offscreen framebuffer is incomplete.");
+}
+
+bool mayak::core::Window::ReadPixels(std::vector<uint8_t>& out) {
+    int width = framebufferWidth, height = framebufferHeight;
+    if (!window || width <= 0 || height <= 0) return false;
+    MakeCurrent();
+
+    gfx::State().BindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glReadBuffer(fbo ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    std::size_t stride = static_cast<std::size_t>(width) * 4;
+    out.resize(stride * height);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, out.data());
+
+    // GL's rows go bottom up, images go top down
+    std::vector<uint8_t> row(stride);
+    for (int y = 0; y < height / 2; ++y) {
+        uint8_t* top = out.data() + y * stride;
+        uint8_t* bottom = out.data() + (height - 1 - y) * stride;
+        std::copy(top, top + stride, row.begin());
+        std::copy(bottom, bottom + stride, top);
+        std::copy(row.begin(), row.end(), bottom);
+    }
+    return true;
+}
+
+const std::vector<mayak::core::Window*>& mayak::core::windows() {
+    return registry;
+}
+
+void mayak::core::set_content_scale_callback(ContentScaleCallback callback) {
+    contentScaleCallback = callback;
+}
+
+GLFWwindow* mayak::core::shared_context() {
+    return sharedRoot;
+}
+
+void mayak::core::make_shared_context_current() {
+    if (sharedRoot && glfwGetCurrentContext() != sharedRoot) glfwMakeContextCurrent(sharedRoot);
+}
+
+void mayak::core::render_windows() {
+    // Find the last window we'll present, it's the only one that syncs to vblank
+    Window* last = nullptr;
+    // Partial redraw without damage doesn't present anything either
+    auto presents = [](Window* window) {
+        return window->drawCallback && !window->ShouldClose() && window->IsDrawable()
+            && (!window->partialRedraw || window->partialRedraw->HasDamage());
     };
-};
\ No newline at end of file
+    for (Window* window : registry)
+        if (presents(window)) last = window;
+    if (!last) return;
+
+    for (Window* window : registry) {
+        // Minimized / zero-sized: presenting it would be pure waste
+        if (!presents(window)) continue;
+
+        // Swap interval is per context, only touch it when it actually changes
+        int wanted = window == last ? pacing::swap_interval() : 0;
+        // The frame's timer query can only end in its own context
+        if (glfwGetCurrentContext() != window->window) pacing::_leaving_context();
+        window->MakeCurrent();
+        if (wanted != window->swapInterval) {
+            glfwSwapInterval(wanted);
+            window->swapInterval = wanted;
+        }
+
+        if (window->fbo || is_headless()) {
+            window->UpdateOffscreenTarget();
+            gfx::State().BindFramebuffer(GL_FRAMEBUFFER, window->fbo);
+        }
+        if (window->partialRedraw) {
+            window->DrawPartial();
+            gfx::State().EndFrame();
+            continue;
+        }
+        // Pixels, not logical units, or HiDPI windows end up rendered blurry into a corner
+        gfx::State().SetViewport(0, 0, window->framebufferWidth, window->framebufferHeight);
+        window->drawCallback(*window);
+        // Nothing to present when headless, the frame stays in the FBO for ReadPixels()
+        if (!window->fbo) swap_buffers(window->window);
+        gfx::State().EndFrame();
+    }
+    // Stay on the last context, next frame starts there if there's just one window
+}
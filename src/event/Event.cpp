@@ -1,5 +1,4 @@
 #include "core/Init.hpp"
-#include "utils/Logger.hpp"
 #include "event/Event.hpp"
 #include <GLFW/glfw3.h>
 
@@ -11,7 +10,7 @@ namespace mayak {
     }
 
     void emit_event(const Event& e) {
+        // Nobody listening is normal (tests, headless), and this runs per mouse move
         if (current_callback) current_callback(e);
-        else logger::warn("No event callback set");
     }
 }
\ No newline at end of file
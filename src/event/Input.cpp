@@ -1,8 +1,30 @@
 #include "core/Init.hpp"
+#include "core/Time.hpp"
 #include "event/Input.hpp"
 
+#include <array>
+#include <algorithm>
+
 namespace {
-    
+    using mayak::core::input::PointerSample;
+    using mayak::core::input::POINTER_HISTORY_SIZE;
+
+    // Velocity is fitted over samples this close to the newest one
+    constexpr int64_t VELOCITY_WINDOW_NS = 50'000'000;
+    constexpr std::size_t VELOCITY_MAX_SAMPLES = 8;
+    // Never extrapolate further than this, overshoot looks worse than lag
+    constexpr int64_t MAX_PREDICTION_NS = 50'000'000;
+    // If the pointer was quiet this long it's standing still, don't predict
+    constexpr int64_t STALE_SAMPLE_NS = 100'000'000;
+
+    std::array<PointerSample, POINTER_HISTORY_SIZE> pointerRing{};
+    uint64_t pointerTotal = 0;      // samples ever pushed
+    uint64_t pointerFrameStart = 0; // pointerTotal when the frame began
+    float mouseX = 0, mouseY = 0;
+
+    const PointerSample& ring_at(uint64_t sequence) {
+        return pointerRing[sequence % POINTER_HISTORY_SIZE];
+    }
 }
 
 namespace mayak::core::input {
@@ -57,6 +79,82 @@ namespace mayak::core::input {
         RIGHT_TRIGGER = GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER
     };
 
+    int mouse_x() { return static_cast<int>(mouseX); }
+
+    int mouse_y() { return static_cast<int>(mouseY); }
+
+    std::size_t pointer_sample_count() {
+        uint64_t inFrame = pointerTotal - pointerFrameStart;
+        return static_cast<std::size_t>(std::min<uint64_t>(inFrame, POINTER_HISTORY_SIZE));
+    }
+
+    PointerSample pointer_sample(std::size_t index) {
+        std::size_t count = pointer_sample_count();
+        if (index >= count) return {};
+        return ring_at(pointerTotal - count + index);
+    }
+
+    vec2 pointer_velocity() {
+        // Looks past the frame boundary on purpose: one sample per frame is
+        // still enough for a velocity if the previous frame had one too
+        uint64_t available = std::min<uint64_t>(pointerTotal, POINTER_HISTORY_SIZE);
+        if (available < 2) return {};
+
+        const PointerSample& newest = ring_at(pointerTotal - 1);
+        std::size_t n = 0;
+        double sumT = 0, sumX = 0, sumY = 0;
+        for (; n < available && n < VELOCITY_MAX_SAMPLES; ++n) {
+            const PointerSample& s = ring_at(pointerTotal - 1 - n);
+            if (newest.timeNs - s.timeNs > VELOCITY_WINDOW_NS) break;
+            sumT += (s.timeNs - newest.timeNs) * 1e-9;
+            sumX += s.x;
+            sumY += s.y;
+        }
+        if (n < 2) return {};
+
+        // Least squares slope of position over time, way less jittery than
+        // just taking the last two samples
+        double meanT = sumT / n, meanX = sumX / n, meanY = sumY / n;
+        double varT = 0, covX = 0, covY = 0;
+        for (std::size_t i = 0; i < n; ++i) {
+            const PointerSample& s = ring_at(pointerTotal - 1 - i);
+            double dt = (s.timeNs - newest.timeNs) * 1e-9 - meanT;
+            varT += dt * dt;
+            covX += dt * (s.x - meanX);
+            covY += dt * (s.y - meanY);
+        }
+        if (varT <= 0) return {};
+        return vec2(static_cast<float>(covX / varT), static_cast<float>(covY / varT));
+    }
+
+    vec2 predict_pointer(int64_t presentTimeNs) {
+        if (pointerTotal == 0) return vec2(mouseX, mouseY);
+
+        const PointerSample& newest = ring_at(pointerTotal - 1);
+        int64_t ahead = presentTimeNs - newest.timeNs;
+        if (ahead <= 0 || ahead > STALE_SAMPLE_NS) return vec2(newest.x, newest.y);
+
+        ahead = std::min(ahead, MAX_PREDICTION_NS);
+        vec2 velocity = pointer_velocity();
+        float seconds = static_cast<float>(ahead * 1e-9);
+        return vec2(newest.x + velocity.x * seconds, newest.y + velocity.y * seconds);
+    }
+
+    void _set_mouse_pos(int x, int y) {
+        _push_pointer_sample(static_cast<float>(x), static_cast<float>(y), time::now_ns());
+    }
+
+    void _push_pointer_sample(float x, float y, int64_t timeNs) {
+        pointerRing[pointerTotal % POINTER_HISTORY_SIZE] = PointerSample{x, y, timeNs};
+        ++pointerTotal;
+        mouseX = x;
+        mouseY = y;
+    }
+
+    void _begin_pointer_frame() {
+        pointerFrameStart = pointerTotal;
+    }
+
 //     bool is_key_pressed(Window* window, mayak::core::input::keyboard_key key) {
 //         return glfwGetKey(window, key) == GLFW_PRESS;
 //     }
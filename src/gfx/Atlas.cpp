@@ -0,0 +1,445 @@
+#include <glad/glad.h>
+
+#include "gfx/Atlas.hpp"
+#include "gfx/GLState.hpp"
+#include "core/Mainloop.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace {
+    GLenum upload_format(GLenum internalFormat) {
+        return internalFormat == GL_R8 ? GL_RED : GL_RGBA;
+    }
+
+    int bytes_per_pixel(GLenum internalFormat) {
+        return internalFormat == GL_R8 ? 1 : 4;
+    }
+}
+
+// ---- SkylinePacker ----
+
+void mayak::gfx::SkylinePacker::Reset(int newWidth, int newHeight) {
+    width = newWidth;
+    height = newHeight;
+    usedArea = 0;
+    skyline.clear();
+    if (width > 0) skyline.push_back(Segment{0, 0, width});
+}
+
+float mayak::gfx::SkylinePacker::Occupancy() const {
+    if (width <= 0 || height <= 0) return 0;
+    return float(double(usedArea) / (double(width) * height));
+}
+
+int mayak::gfx::SkylinePacker::FitAt(std::size_t index, int rectWidth, int rectHeight) const {
+    int x = skyline[index].x;
+    if (x + rectWidth > width) return -1;
+
+    // The rect rests on the highest segment it spans
+    int y = 0;
+    int remaining = rectWidth;
+    for (std::size_t i = index; remaining > 0; ++i) {
+        y = std::max(y, skyline[i].y);
+        if (y + rectHeight > height) return -1;
+        remaining -= skyline[i].width;
+    }
+    return y;
+}
+
+bool mayak::gfx::SkylinePacker::Insert(int rectWidth, int rectHeight, int& x, int& y) {
+    if (rectWidth <= 0 || rectHeight <= 0) return false;
+
+    std::size_t best = skyline.size();
+    int bestBottom = height + 1, bestWidth = width + 1;
+    for (std::size_t i = 0; i < skyline.size(); ++i) {
+        int top = FitAt(i, rectWidth, rectHeight);
+        if (top < 0) continue;
+        // Lowest bottom edge wins, the narrower segment breaks ties (less wasted space beside it)
+        int bottom = top + rectHeight;
+        if (bottom < bestBottom || (bottom == bestBottom && skyline[i].width < bestWidth)) {
+            best = i;
+            bestBottom = bottom;
+            bestWidth = skyline[i].width;
+        }
+    }
+    if (best == skyline.size()) return false;
+
+    x = skyline[best].x;
+    y = bestBottom - rectHeight;
+    skyline.insert(skyline.begin() + best, Segment{x, bestBottom, rectWidth});
+
+    // Cut away what the new segment covers
+    for (std::size_t i = best + 1; i < skyline.size();) {
+        const Segment& previous = skyline[i - 1];
+        Segment& current = skyline[i];
+        int overlap = previous.x + previous.width - current.x;
+        if (overlap <= 0) break;
+        current.x += overlap;
+        current.width -= overlap;
+        if (current.width > 0) break;
+        skyline.erase(skyline.begin() + i);
+    }
+
+    // Neighbours at the same height are one segment
+    for (std::size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+
+    usedArea += uint64_t(rectWidth) * rectHeight;
+    return true;
+}
+
+// ---- TextureAtlas ----
+
+mayak::gfx::TextureAtlas::TextureAtlas(const AtlasOptions& options) : options(options) {
+    pages.resize(std::max(options.maxPages, 1));
+    for (auto& page : pages) page.packer.Reset(options.pageSize, options.pageSize);
+}
+
+bool mayak::gfx::TextureAtlas::Create() {
+    if (texture) return true;
+    int size = options.pageSize;
+    GLint maxSize = 0, maxLayers = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if (size > maxSize || int(pages.size()) > maxLayers) {
+        MAYAK_LOG_ERROR("Atlas: " + std::to_string(pages.size()) + " pages of " + std::to_string(size)
+                        + "px don't fit the GPU's limits");
+        return false;
+    }
+
+    glGenTextures(1, &texture);
+    State().BindTexture(0, GL_TEXTURE_2D_ARRAY, texture);
+    if (GLAD_GL_VERSION_4_2) {
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, options.internalFormat, size, size, GLsizei(pages.size()));
+    } else {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, options.internalFormat, size, size, GLsizei(pages.size()), 0,
+                     upload_format(options.internalFormat), GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (options.internalFormat == GL_R8) {
+        // Coverage only: sample as white with coverage in alpha, so the usual color * texture just works
+        const GLint swizzle[] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+        glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    return true;
+}
+
+void mayak::gfx::TextureAtlas::Destroy() {
+    for (GLuint* name : { &texture, &scratch }) {
+        if (!*name) continue;
+        ForgetSharedTexture(*name);
+        glDeleteTextures(1, name);
+        *name = 0;
+    }
+}
+
+const mayak::gfx::AtlasRegion* mayak::gfx::TextureAtlas::Find(uint64_t key) {
+    BeginFrame();
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        ++stats.misses;
+        return nullptr;
+    }
+    ++stats.hits;
+    Touch(it->second);
+    return &it->second.region;
+}
+
+void mayak::gfx::TextureAtlas::Touch(Entry& entry) {
+    Page& page = pages[entry.region.page];
+    page.lru.splice(page.lru.end(), page.lru, entry.lru);
+    page.lastUsedFrame = frame;
+}
+
+void mayak::gfx::TextureAtlas::BeginFrame() {
+    uint64_t now = core::frame_count();
+    if (now == frame) return;
+    frame = now;
+
+    // Nothing of this frame is drawn yet, so any page may be repacked now
+    std::vector<std::pair<int, int>> wanted;
+    wanted.swap(refused);
+    for (auto [width, height] : wanted) {
+        bool fits = false;
+        for (int page = 0; page < int(pages.size()) && !fits; ++page) fits = Fits(page, width, height);
+        for (int page : PagesOldestFirst()) {
+            if (fits) break;
+            fits = MakeRoom(page, width, height);
+        }
+    }
+}
+
+std::vector<int> mayak::gfx::TextureAtlas::PagesOldestFirst() const {
+    std::vector<int> order;
+    for (int page = 0; page < int(pages.size()); ++page)
+        if (pages[page].lastUsedFrame != frame || pages[page].lru.empty()) order.push_back(page);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        // NEVER is the biggest number but the oldest use
+        return pages[a].lastUsedFrame + 1 < pages[b].lastUsedFrame + 1;
+    });
+    return order;
+}
+
+bool mayak::gfx::TextureAtlas::Fits(int page, int paddedWidth, int paddedHeight) const {
+    SkylinePacker probe = pages[page].packer;
+    int x, y;
+    return probe.Insert(paddedWidth, paddedHeight, x, y);
+}
+
+bool mayak::gfx::TextureAtlas::MakeRoom(int page, int paddedWidth, int paddedHeight) {
+    Page& victim = pages[page];
+    uint64_t capacity = uint64_t(options.pageSize) * options.pageSize;
+    // Twice the area to begin with, skyline packing never gets all of it back
+    uint64_t wanted = std::min(uint64_t(paddedWidth) * paddedHeight * 2, capacity);
+    while (!Fits(page, paddedWidth, paddedHeight)) {
+        if (victim.liveArea == 0) return false;
+        while (victim.liveArea != 0 && capacity - victim.liveArea < wanted) {
+            Forget(entries.find(victim.lru.front()));
+            ++stats.evictions;
+        }
+        if (victim.liveArea != 0) Compact(page);
+        wanted = std::min(wanted * 2, capacity);
+    }
+    return true;
+}
+
+void mayak::gfx::TextureAtlas::SetRegion(AtlasRegion& region, int page, int x, int y, int width, int height) const {
+    float size = float(options.pageSize);
+    region.page = page;
+    region.x = x;
+    region.y = y;
+    region.width = width;
+    region.height = height;
+    region.u0 = x / size;
+    region.v0 = y / size;
+    region.u1 = (x + width) / size;
+    region.v1 = (y + height) / size;
+}
+
+bool mayak::gfx::TextureAtlas::Place(int page, int paddedWidth, int paddedHeight, AtlasRegion& region) {
+    int x, y;
+    if (!pages[page].packer.Insert(paddedWidth, paddedHeight, x, y)) return false;
+    pages[page].inUse = true;
+    pages[page].liveArea += uint64_t(paddedWidth) * paddedHeight;
+    int padding = options.padding;
+    SetRegion(region, page, x + padding, y + padding, paddedWidth - 2 * padding, paddedHeight - 2 * padding);
+    return true;
+}
+
+void mayak::gfx::TextureAtlas::Upload(const AtlasRegion& region, const void* pixels) {
+    if (!texture || !pixels) return;
+    int padding = options.padding, bpp = bytes_per_pixel(options.internalFormat);
+    int width = region.width + 2 * padding, height = region.height + 2 * padding;
+    const void* data = pixels;
+    if (padding > 0) {
+        // The padding may still hold whatever was here before, it goes up as zeros or that bleeds in
+        staging.assign(std::size_t(width) * height * bpp, 0);
+        std::size_t rowBytes = std::size_t(region.width) * bpp;
+        for (int row = 0; row < region.height; ++row)
+            std::memcpy(&staging[(std::size_t(row + padding) * width + padding) * bpp],
+                        static_cast<const uint8_t*>(pixels) + row * rowBytes, rowBytes);
+        data = staging.data();
+    }
+    State().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    State().BindTexture(0, GL_TEXTURE_2D_ARRAY, texture);
+    // Rows are tightly packed, R8 rows aren't 4-byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, region.x - padding, region.y - padding, region.page, width, height, 1,
+                    upload_format(options.internalFormat), GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    stats.bytesUploaded += uint64_t(width) * height * bpp;
+}
+
+void mayak::gfx::TextureAtlas::Forget(std::unordered_map<uint64_t, Entry>::iterator it) {
+    const AtlasRegion& region = it->second.region;
+    Page& page = pages[region.page];
+    uint64_t padded = uint64_t(region.width + 2 * options.padding) * (region.height + 2 * options.padding);
+    page.liveArea -= std::min(page.liveArea, padded);
+    page.lru.erase(it->second.lru);
+    entries.erase(it);
+    ++generation;
+    // An empty page is as good as new, no need to wait for a compaction
+    if (page.liveArea == 0) {
+        page.packer.Reset();
+        page.inUse = false;
+    }
+}
+
+const mayak::gfx::AtlasRegion* mayak::gfx::TextureAtlas::Insert(uint64_t key, int width, int height, const void* pixels) {
+    if (width <= 0 || height <= 0) return nullptr;
+    BeginFrame();
+    auto existing = entries.find(key);
+    if (existing != entries.end()) Forget(existing);
+
+    int paddedWidth = width + 2 * options.padding;
+    int paddedHeight = height + 2 * options.padding;
+    if (!CanHold(width, height)) {
+        ++stats.failures;
+        MAYAK_LOG_WARN("Atlas: " + std::to_string(width) + "x" + std::to_string(height)
+                       + " is too big for " + std::to_string(options.pageSize) + "px pages");
+        return nullptr;
+    }
+    uint64_t need = uint64_t(paddedWidth) * paddedHeight;
+    uint64_t capacity = uint64_t(options.pageSize) * options.pageSize;
+
+    // Pages that have stuff first, a fresh page only when those are full
+    AtlasRegion region;
+    bool placed = false;
+    for (int pass = 0; pass < 2 && !placed; ++pass)
+        for (int page = 0; page < int(pages.size()) && !placed; ++page)
+            if (pages[page].inUse == (pass == 0)) placed = Place(page, paddedWidth, paddedHeight, region);
+
+    // Full: only pages this frame hasn't drawn from may move. Repacking first, it costs no images
+    if (!placed) {
+        std::vector<int> order = PagesOldestFirst();
+        for (int page : order) {
+            if (Fragmentation(page) < options.compactThreshold || capacity - pages[page].liveArea < need) continue;
+            Compact(page);
+            if ((placed = Place(page, paddedWidth, paddedHeight, region))) break;
+        }
+        for (std::size_t i = 0; i < order.size() && !placed; ++i)
+            if (MakeRoom(order[i], paddedWidth, paddedHeight)) placed = Place(order[i], paddedWidth, paddedHeight, region);
+    }
+
+    if (!placed) {
+        // Everything left is on screen, moving it would break quads already batched
+        ++stats.failures;
+        refused.emplace_back(paddedWidth, paddedHeight);
+        if (!warnedFull) {
+            MAYAK_LOG_WARN("Atlas: one frame needs more than the whole atlas, the rest waits for the next frame");
+            warnedFull = true;
+        }
+        return nullptr;
+    }
+
+    Page& page = pages[region.page];
+    Entry& entry = entries[key];
+    entry.region = region;
+    entry.lru = page.lru.insert(page.lru.end(), key);
+    page.lastUsedFrame = frame;
+    Upload(region, pixels);
+    ++stats.inserts;
+    return &entry.region;
+}
+
+void mayak::gfx::TextureAtlas::Remove(uint64_t key) {
+    auto it = entries.find(key);
+    if (it != entries.end()) Forget(it);
+}
+
+void mayak::gfx::TextureAtlas::Clear() {
+    entries.clear();
+    refused.clear();
+    ++generation;
+    for (auto& page : pages) {
+        page.packer.Reset();
+        page.liveArea = 0;
+        page.inUse = false;
+        page.lru.clear();
+        page.lastUsedFrame = NEVER;
+    }
+}
+
+float mayak::gfx::TextureAtlas::Fragmentation(int page) const {
+    uint64_t packed = pages[page].packer.UsedArea();
+    if (!packed) return 0;
+    return 1.0f - float(double(pages[page].liveArea) / double(packed));
+}
+
+void mayak::gfx::TextureAtlas::Compact(int page) {
+    using Iterator = std::unordered_map<uint64_t, Entry>::iterator;
+    Page& target = pages[page];
+    std::vector<Iterator> live;
+    for (uint64_t key : target.lru) live.push_back(entries.find(key));
+
+    ++stats.compactions;
+    ++generation;
+    bool gpuCopy = texture && GLAD_GL_VERSION_4_3;
+    if (texture && !gpuCopy) {
+        // No way to move pixels around, so the images leave and come back on their next miss
+        for (auto it : live) entries.erase(it);
+        stats.evictions += live.size();
+        target.packer.Reset();
+        target.liveArea = 0;
+        target.inUse = false;
+        target.lru.clear();
+        return;
+    }
+
+    // Tallest first packs a skyline much tighter than arrival order
+    std::sort(live.begin(), live.end(), [](const Iterator& a, const Iterator& b) {
+        const AtlasRegion& ra = a->second.region;
+        const AtlasRegion& rb = b->second.region;
+        return ra.height != rb.height ? ra.height > rb.height : ra.width > rb.width;
+    });
+
+    if (gpuCopy && !scratch) {
+        glGenTextures(1, &scratch);
+        State().BindTexture(0, GL_TEXTURE_2D, scratch);
+        glTexImage2D(GL_TEXTURE_2D, 0, options.internalFormat, options.pageSize, options.pageSize, 0,
+                     upload_format(options.internalFormat), GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    }
+
+    target.packer.Reset();
+    target.liveArea = 0;
+    int padding = options.padding;
+    for (auto it : live) {
+        AtlasRegion old = it->second.region;
+        if (!Place(page, old.width + 2 * padding, old.height + 2 * padding, it->second.region)) {
+            // Repacking in another order can lose a few, rare and they just come back later
+            target.lru.erase(it->second.lru);
+            entries.erase(it);
+            ++stats.evictions;
+            continue;
+        }
+        const AtlasRegion& moved = it->second.region;
+        if (gpuCopy) {
+            glCopyImageSubData(texture, GL_TEXTURE_2D_ARRAY, 0, old.x - padding, old.y - padding, page,
+                               scratch, GL_TEXTURE_2D, 0, moved.x - padding, moved.y - padding, 0,
+                               old.width + 2 * padding, old.height + 2 * padding, 1);
+        }
+    }
+    if (gpuCopy) {
+        glCopyImageSubData(scratch, GL_TEXTURE_2D, 0, 0, 0, 0, texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, page,
+                           options.pageSize, options.pageSize, 1);
+    }
+    if (target.liveArea == 0) target.inUse = false;
+}
+
+int mayak::gfx::TextureAtlas::CompactFragmented() {
+    int compacted = 0;
+    for (int page = 0; page < int(pages.size()); ++page) {
+        if (!pages[page].inUse || Fragmentation(page) < options.compactThreshold) continue;
+        Compact(page);
+        ++compacted;
+    }
+    return compacted;
+}
+
+int mayak::gfx::TextureAtlas::PagesInUse() const {
+    int count = 0;
+    for (const auto& page : pages) count += page.inUse;
+    return count;
+}
+
+float mayak::gfx::TextureAtlas::Efficiency() const {
+    int inUse = PagesInUse();
+    if (!inUse) return 0;
+    uint64_t area = 0;
+    for (const auto& [key, entry] : entries) area += uint64_t(entry.region.width) * entry.region.height;
+    return float(double(area) / (double(inUse) * options.pageSize * options.pageSize));
+}
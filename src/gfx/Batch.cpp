@@ -0,0 +1,506 @@
+#include <glad/glad.h>
+
+#include "gfx/Batch.hpp"
+#include "gfx/GLState.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+mayak::gfx::QuadBatch::QuadBatch(RendererContext& ctx) : ctx(ctx) {
+    // Allocated once at full size, pushing a quad is just a counter bump (no zero-filling on resize)
+    vertices.resize(MAX_BATCH_QUADS * 4);
+    instances.reserve(MAX_BATCH_QUADS);
+    clipRects.reserve(MAX_CLIP_RECTS);
+    clipRects.push_back(ClipRect{});
+    styles.push_back(DistanceFieldStyle{});
+}
+
+void mayak::gfx::QuadBatch::Begin(int width, int height, const ClipRect& frameBounds) {
+    framebufferWidth = width;
+    framebufferHeight = height;
+    program = 0;
+    programClipsInShader = true;
+    bounds = frameBounds;
+    clip = ClipRect{};
+    drawClip = bounds;
+    clipIdValid = false;
+    clipStack.clear();
+    stencilDepth = 0;
+    stencilCleared = false;
+    SetDistanceFieldStyle(DistanceFieldStyle{});
+}
+
+void mayak::gfx::QuadBatch::FlushIfFull() {
+    if (PendingQuads() >= MAX_BATCH_QUADS || PendingRoundedRects() >= MAX_BATCH_QUADS) {
+        ++stats.overflowFlushes;
+        Flush();
+    }
+}
+
+void mayak::gfx::QuadBatch::AddToRun(RunKind kind, GLenum target, GLuint texture, GLuint runProgram,
+                                     const ClipRect& runClip, int first, uint32_t runStyle, bool runPremultiplied) {
+    if (!runs.empty()) {
+        Run& last = runs.back();
+        bool kindChanged = last.kind != kind;
+        bool textureChanged = last.texture != texture;
+        bool shaderChanged = last.program != runProgram;
+        bool clipChanged = last.clip != runClip;
+        bool styleChanged = last.style != runStyle;
+        bool blendChanged = last.premultiplied != runPremultiplied;
+        if (!kindChanged && !textureChanged && !shaderChanged && !clipChanged && !styleChanged && !blendChanged) {
+            ++last.count;
+            return;
+        }
+        // Count every reason, a break can have more than one. Switching kinds changes
+        // the shader anyway, that's a shader break
+        stats.textureBreaks += textureChanged && !kindChanged;
+        stats.shaderBreaks += shaderChanged;
+        stats.clipBreaks += clipChanged && !kindChanged;
+        stats.styleBreaks += styleChanged && !shaderChanged;
+        stats.blendBreaks += blendChanged;
+    }
+    runs.push_back(Run{kind, target, texture, runProgram, runClip, runStyle, runPremultiplied, first, 1});
+}
+
+mayak::gfx::QuadVertex* mayak::gfx::QuadBatch::Push(GLuint texture, GLenum target, uint16_t& clipSlot) {
+    FlushIfFull();
+    if (!texture) texture = ctx.whiteTexture;
+    GLuint defaultProgram = target == GL_TEXTURE_2D_ARRAY ? ctx.atlasProgram : ctx.shaderProgram;
+    // The bounds stay put all frame, as the scissor they never split a run. Custom shaders
+    // don't know uClipRects, theirs is the only case where a clip change still does
+    bool inShader = programClipsInShader;
+    clipSlot = inShader ? uint16_t(CurrentClipId()) : 0;
+    AddToRun(RunKind::Quads, target, texture, program ? program : defaultProgram, inShader ? bounds : drawClip,
+             PendingQuads(), 0, program && programPremultiplied);
+
+    ++stats.quads;
+    return &vertices[std::size_t(quadCount++) * 4];
+}
+
+bool mayak::gfx::QuadBatch::Culled(float x, float y, float width, float height) {
+    if (bounds.IsNone()) return false;
+    bool outside = x >= float(bounds.x + bounds.width) || x + width <= float(bounds.x)
+                || y >= float(bounds.y + bounds.height) || y + height <= float(bounds.y);
+    stats.culled += outside;
+    return outside;
+}
+
+void mayak::gfx::QuadBatch::DrawRect(float x, float y, float width, float height, uint32_t color) {
+    DrawTexturedRect(x, y, width, height, 0, 0, 0, 1, 1, color);
+}
+
+void mayak::gfx::QuadBatch::DrawTexturedRect(float x, float y, float width, float height, GLuint texture,
+                                             float u0, float v0, float u1, float v1, uint32_t tint) {
+    if (Culled(x, y, width, height)) return;
+    uint16_t slot;
+    QuadVertex* out = Push(texture, GL_TEXTURE_2D, slot);
+    out[0] = QuadVertex{x, y, u0, v0, tint, 0, slot};
+    out[1] = QuadVertex{x + width, y, u1, v0, tint, 0, slot};
+    out[2] = QuadVertex{x + width, y + height, u1, v1, tint, 0, slot};
+    out[3] = QuadVertex{x, y + height, u0, v1, tint, 0, slot};
+}
+
+void mayak::gfx::QuadBatch::DrawAtlasRect(float x, float y, float width, float height, const TextureAtlas& atlas,
+                                          const AtlasRegion& region, uint32_t tint) {
+    if (Culled(x, y, width, height)) return;
+    uint16_t slot;
+    QuadVertex* out = Push(atlas.Texture(), GL_TEXTURE_2D_ARRAY, slot);
+    auto layer = uint16_t(region.page);
+    out[0] = QuadVertex{x, y, region.u0, region.v0, tint, layer, slot};
+    out[1] = QuadVertex{x + width, y, region.u1, region.v0, tint, layer, slot};
+    out[2] = QuadVertex{x + width, y + height, region.u1, region.v1, tint, layer, slot};
+    out[3] = QuadVertex{x, y + height, region.u0, region.v1, tint, layer, slot};
+}
+
+void mayak::gfx::QuadBatch::DrawDistanceFieldRect(float x, float y, float width, float height,
+                                                  const TextureAtlas& atlas, const AtlasRegion& region,
+                                                  uint32_t color) {
+    if (Culled(x, y, width, height)) return;
+    // Compiled on the first distance field quad unless the deferred warm-up was faster
+    if (!LoadDistanceFieldProgram(ctx)) return;
+    FlushIfFull();
+    auto slot = uint16_t(CurrentClipId());
+    // Its own shader whatever SetShader() said, custom shaders wouldn't know what the texels mean
+    AddToRun(RunKind::Quads, GL_TEXTURE_2D_ARRAY, atlas.Texture(), ctx.distanceFieldProgram, bounds,
+             PendingQuads(), styleIndex);
+    ++stats.quads;
+
+    QuadVertex* out = &vertices[std::size_t(quadCount++) * 4];
+    auto layer = uint16_t(region.page);
+    out[0] = QuadVertex{x, y, region.u0, region.v0, color, layer, slot};
+    out[1] = QuadVertex{x + width, y, region.u1, region.v0, color, layer, slot};
+    out[2] = QuadVertex{x + width, y + height, region.u1, region.v1, color, layer, slot};
+    out[3] = QuadVertex{x, y + height, region.u0, region.v1, color, layer, slot};
+}
+
+void mayak::gfx::QuadBatch::DrawQuad(const QuadVertex (&corners)[4], GLuint texture) {
+    float left = corners[0].x, right = corners[0].x, top = corners[0].y, bottom = corners[0].y;
+    for (int i = 1; i < 4; ++i) {
+        left = std::min(left, corners[i].x);
+        right = std::max(right, corners[i].x);
+        top = std::min(top, corners[i].y);
+        bottom = std::max(bottom, corners[i].y);
+    }
+    if (Culled(left, top, right - left, bottom - top)) return;
+    uint16_t slot;
+    QuadVertex* out = Push(texture, GL_TEXTURE_2D, slot);
+    for (int i = 0; i < 4; ++i) {
+        out[i] = corners[i];
+        out[i].clip = slot;
+    }
+}
+
+uint32_t mayak::gfx::QuadBatch::CurrentClipId() {
+    if (clipIdValid) return clipId;
+    // The bounds are the scissor already
+    if (drawClip.IsNone() || drawClip == bounds) {
+        clipId = 0;
+    } else {
+        // Widgets tend to go back to the same clip, reuse its slot
+        clipId = 0;
+        for (size_t i = 1; i < clipRects.size(); ++i) {
+            if (clipRects[i] == drawClip) {
+                clipId = uint32_t(i);
+                break;
+            }
+        }
+        if (!clipId) {
+            if (clipRects.size() >= size_t(MAX_CLIP_RECTS)) {
+                ++stats.overflowFlushes;
+                ++stats.clipOverflows;
+                Flush();
+            }
+            clipId = uint32_t(clipRects.size());
+            clipRects.push_back(drawClip);
+        }
+    }
+    clipIdValid = true;
+    return clipId;
+}
+
+void mayak::gfx::QuadBatch::DrawRoundedRect(const RoundedRectInstance& rect) {
+    if (Culled(rect.x, rect.y, rect.width, rect.height)) return;
+    FlushIfFull();
+    uint32_t id = CurrentClipId();
+    // Clipping happens in the shader, so all rounded rects share one run whatever the clip
+    AddToRun(RunKind::RoundedRects, GL_TEXTURE_2D, 0, ctx.roundedRectProgram, bounds, PendingRoundedRects());
+
+    ++stats.roundedRects;
+    instances.push_back(rect);
+    instances.back().clipId = id;
+}
+
+void mayak::gfx::QuadBatch::DrawRoundedRect(float x, float y, float width, float height, float radius,
+                                            uint32_t fill, uint32_t border, float borderWidth) {
+    DrawRoundedRect(RoundedRectInstance{x, y, width, height, {radius, radius, radius, radius},
+                                        fill, border, borderWidth, 0});
+}
+
+void mayak::gfx::QuadBatch::SetShader(GLuint newProgram, bool premultiplied) {
+    // Nothing happens until the next quad, switching back and forth for nothing costs nothing
+    program = newProgram;
+    programClipsInShader = ClipsInShader(newProgram);
+    programPremultiplied = premultiplied || (ctx.quadShaders && ctx.quadShaders->Premultiplied(newProgram));
+}
+
+bool mayak::gfx::QuadBatch::ClipsInShader(GLuint candidate) const {
+    if (!candidate || candidate == ctx.shaderProgram || candidate == ctx.atlasProgram
+            || candidate == ctx.distanceFieldProgram)
+        return true;
+    // Gradients, clip masks and the like are quad variants too, same source
+    return ctx.quadShaders && ctx.quadShaders->Contains(candidate);
+}
+
+void mayak::gfx::QuadBatch::SetDistanceFieldStyle(const DistanceFieldStyle& style) {
+    if (styles[styleIndex] == style) return;
+    // Text flips between a couple of styles, look for it before adding another
+    for (std::size_t i = 0; i < styles.size(); ++i) {
+        if (styles[i] == style) {
+            styleIndex = uint32_t(i);
+            return;
+        }
+    }
+    styleIndex = uint32_t(styles.size());
+    styles.push_back(style);
+}
+
+void mayak::gfx::QuadBatch::SetClip(const ClipRect& newClip) {
+    if (newClip == clip) return;
+    clip = newClip;
+    drawClip = Intersect(clip, bounds);
+    clipIdValid = false;
+}
+
+void mayak::gfx::QuadBatch::PushClip(const ClipRect& rect) {
+    clipStack.push_back(ClipLevel{clip, false, false, {}, {}});
+    SetClip(Intersect(clip, rect));
+}
+
+void mayak::gfx::QuadBatch::PushRoundedClip(float x, float y, float width, float height, float radius) {
+    int left = int(std::floor(x)), top = int(std::floor(y));
+    ClipRect box{left, top, int(std::ceil(x + width)) - left, int(std::ceil(y + height)) - top};
+    if (radius <= 0) {
+        PushClip(box);
+        return;
+    }
+
+    ClipLevel level{clip, true, true, {}, {}};
+    level.roundedShape = RoundedRectInstance{x, y, width, height, {radius, radius, radius, radius},
+                                             PackColor(255, 255, 255), 0, 0, 0};
+    if (stencilDepth >= 255) {
+        MAYAK_LOG_WARN("QuadBatch: more than 255 nested stencil clips, the rest clip to their bounding box");
+        level.stencil = false;
+    } else {
+        DrawStencilShape(level, true);
+    }
+    clipStack.push_back(level);
+    // The box as well, quads outside it get dropped by the shader instead of the stencil
+    SetClip(Intersect(clip, box));
+}
+
+void mayak::gfx::QuadBatch::PushClip(const QuadVertex (&corners)[4]) {
+    float left = corners[0].x, right = corners[0].x, top = corners[0].y, bottom = corners[0].y;
+    for (int i = 1; i < 4; ++i) {
+        left = std::min(left, corners[i].x);
+        right = std::max(right, corners[i].x);
+        top = std::min(top, corners[i].y);
+        bottom = std::max(bottom, corners[i].y);
+    }
+    ClipRect box{int(std::floor(left)), int(std::floor(top)), 0, 0};
+    box.width = int(std::ceil(right)) - box.x;
+    box.height = int(std::ceil(bottom)) - box.y;
+
+    // Rotated by a multiple of 90 degrees is still a rectangle, no stencil needed
+    const QuadVertex* c = corners;
+    bool axisAligned = (c[0].y == c[1].y && c[1].x == c[2].x && c[2].y == c[3].y && c[3].x == c[0].x)
+                    || (c[0].x == c[1].x && c[1].y == c[2].y && c[2].x == c[3].x && c[3].y == c[0].y);
+    if (axisAligned) {
+        PushClip(box);
+        return;
+    }
+
+    ClipLevel level{clip, true, false, {}, {}};
+    for (int i = 0; i < 4; ++i) level.quadShape[i] = corners[i];
+    if (stencilDepth >= 255) {
+        MAYAK_LOG_WARN("QuadBatch: more than 255 nested stencil clips, the rest clip to their bounding box");
+        level.stencil = false;
+    } else {
+        DrawStencilShape(level, true);
+    }
+    clipStack.push_back(level);
+    SetClip(Intersect(clip, box));
+}
+
+void mayak::gfx::QuadBatch::PopClip() {
+    if (clipStack.empty()) {
+        MAYAK_LOG_WARN("QuadBatch: PopClip() without a PushClip()");
+        return;
+    }
+    ClipLevel level = clipStack.back();
+    clipStack.pop_back();
+    // The shape comes out under the same clip it went in with, so exactly the same pixels
+    SetClip(level.saved);
+    if (level.stencil) DrawStencilShape(level, false);
+}
+
+void mayak::gfx::QuadBatch::DrawStencilShape(const ClipLevel& level, bool push) {
+    // What's pending was drawn under the old stencil
+    stats.stencilBreaks += PendingRuns() > 0;
+    Flush();
+
+    GLState& gl = State();
+    if (!stencilCleared) {
+        // Whatever was in there before this frame's first stencil clip, it's ours now
+        gl.SetScissorTest(false);
+        gl.SetStencilMask(0xFF);
+        glClearStencil(0);
+        glClear(GL_STENCIL_BUFFER_BIT);
+        stencilCleared = true;
+    }
+
+    // Only where every enclosing shape is, that makes nested ones intersect.
+    // Popping takes the same pixels back down by one
+    writingStencil = true;
+    gl.SetStencilTest(true);
+    gl.SetStencilMask(0xFF);
+    gl.SetStencilFunc(GL_EQUAL, stencilDepth, 0xFF);
+    gl.SetStencilOp(GL_KEEP, GL_KEEP, push ? GL_INCR : GL_DECR);
+    gl.SetColorMask(false);
+
+    // Straight into a run, it isn't something anybody drew: no stats, no culling, and our
+    // shaders whatever SetShader() said. The rounded one leaves out coverage below 0.5
+    uint32_t id = CurrentClipId();
+    if (level.rounded) {
+        AddToRun(RunKind::RoundedRects, GL_TEXTURE_2D, 0, ctx.roundedRectProgram, bounds, PendingRoundedRects());
+        instances.push_back(level.roundedShape);
+        instances.back().clipId = id;
+    } else {
+        AddToRun(RunKind::Quads, GL_TEXTURE_2D, ctx.whiteTexture, ctx.shaderProgram, bounds, PendingQuads());
+        QuadVertex* out = &vertices[std::size_t(quadCount++) * 4];
+        for (int i = 0; i < 4; ++i) {
+            out[i] = level.quadShape[i];
+            out[i].color = PackColor(255, 255, 255);
+            out[i].clip = uint16_t(id);
+        }
+    }
+    ++stats.stencilBreaks;
+    Flush();
+
+    gl.SetColorMask(true);
+    writingStencil = false;
+    stencilDepth += push ? 1 : -1;
+    stats.stencilClips += push;
+}
+
+void mayak::gfx::QuadBatch::ApplyStencil() {
+    // Frames without stencil clips leave the stencil to whoever else uses it
+    if (!stencilCleared) return;
+    GLState& gl = State();
+    gl.SetStencilTest(stencilDepth > 0);
+    if (!stencilDepth) return;
+    gl.SetStencilFunc(GL_EQUAL, stencilDepth, 0xFF);
+    gl.SetStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+}
+
+GLint mayak::gfx::QuadBatch::ClipRectsLocation(GLuint runProgram) {
+    if (runProgram == ctx.roundedRectProgram) return ctx.clipRectsLocation;
+    if (!ClipsInShader(runProgram)) return -1;
+    for (const auto& cached : clipRectsLocations)
+        if (cached.first == runProgram) return cached.second;
+    GLint location = glGetUniformLocation(runProgram, "uClipRects");
+    clipRectsLocations.emplace_back(runProgram, location);
+    return location;
+}
+
+GLint mayak::gfx::QuadBatch::TransformLocation(GLuint runProgram) {
+    if (runProgram == ctx.shaderProgram) return ctx.transformLocation;
+    if (runProgram == ctx.roundedRectProgram) return ctx.roundedRectTransformLocation;
+    if (runProgram == ctx.atlasProgram) return ctx.atlasTransformLocation;
+    if (runProgram == ctx.distanceFieldProgram) return ctx.distanceFieldTransformLocation;
+    for (const auto& cached : transformLocations)
+        if (cached.first == runProgram) return cached.second;
+    GLint location = glGetUniformLocation(runProgram, "uTransform");
+    transformLocations.emplace_back(runProgram, location);
+    return location;
+}
+
+void mayak::gfx::QuadBatch::ApplyStyle(const DistanceFieldStyle& style) {
+    auto channels = [](uint32_t color, GLint location) {
+        glUniform4f(location, float(color & 0xFF) / 255.0f, float((color >> 8) & 0xFF) / 255.0f,
+                    float((color >> 16) & 0xFF) / 255.0f, float(color >> 24) / 255.0f);
+    };
+    glUniform4f(ctx.distanceFieldParamsLocation, style.outlineWidth, style.glowWidth, style.weight, 0.0f);
+    channels(style.outlineColor, ctx.distanceFieldOutlineLocation);
+    channels(style.glowColor, ctx.distanceFieldGlowLocation);
+}
+
+void mayak::gfx::QuadBatch::Flush() {
+    if (runs.empty()) return;
+    GLState& gl = State();
+
+    // Both kinds in one allocation, a second Map() could fence the first one before it got drawn.
+    // Vertex-sized alignment, so the offset works as a base vertex and the indices stay 0-based
+    GLsizeiptr vertexBytes = GLsizeiptr(quadCount) * 4 * sizeof(QuadVertex);
+    GLsizeiptr instanceBytes = instances.size() * sizeof(RoundedRectInstance);
+    StreamAllocation upload = ctx.vertexStream.Map(vertexBytes + instanceBytes, sizeof(QuadVertex));
+    if (!upload) {
+        MAYAK_LOG_ERROR("QuadBatch: couldn't map the vertex stream, dropping " + std::to_string(runs.size()) + " runs");
+        Discard();
+        return;
+    }
+    auto* out = static_cast<uint8_t*>(upload.data);
+    if (vertexBytes) std::memcpy(out, vertices.data(), vertexBytes);
+    if (instanceBytes) std::memcpy(out + vertexBytes, instances.data(), instanceBytes);
+    ctx.vertexStream.Unmap();
+    GLint baseVertex = GLint(upload.offset / GLintptr(sizeof(QuadVertex)));
+    GLintptr instanceOffset = upload.offset + vertexBytes;
+
+    gl.SetBlend(true);
+    gl.SetDepthTest(false);
+    if (!writingStencil) ApplyStencil();
+
+    // One table for every program of the flush, packed once
+    std::array<float, MAX_CLIP_RECTS * 4> packed;
+    for (size_t i = 0; i < clipRects.size(); ++i) {
+        packed[i * 4 + 0] = float(clipRects[i].x);
+        packed[i * 4 + 1] = float(clipRects[i].y);
+        packed[i * 4 + 2] = float(clipRects[i].width);
+        packed[i * 4 + 3] = float(clipRects[i].height);
+    }
+
+    GLuint lastProgram = 0;
+    uint32_t lastStyle = ~0u;
+    for (const Run& run : runs) {
+        gl.UseProgram(run.program);
+        if (run.program != lastProgram) {
+            // Uniforms live in the program, a custom shader may have seen another framebuffer size
+            glUniform4f(TransformLocation(run.program),
+                        2.0f / framebufferWidth, -2.0f / framebufferHeight, -1.0f, 1.0f);
+            GLint clipLocation = clipRects.size() > 1 ? ClipRectsLocation(run.program) : -1;
+            if (clipLocation >= 0) glUniform4fv(clipLocation, GLsizei(clipRects.size()), packed.data());
+            lastProgram = run.program;
+            if (run.program == ctx.distanceFieldProgram) lastStyle = ~0u; // the program may have another one
+            // Half-covered edge pixels would grow a stencil shape, drawn ones keep their anti-aliasing
+            if (run.program == ctx.roundedRectProgram)
+                glUniform1f(ctx.roundedRectMinCoverageLocation, writingStencil ? 0.5f : 0.0f);
+        }
+        if (run.program == ctx.distanceFieldProgram && run.style != lastStyle) {
+            ApplyStyle(styles[run.style]);
+            lastStyle = run.style;
+        }
+
+        // Premultiplied color already carries its alpha, the shadow skips it when it stays the same
+        gl.SetBlendFunc(run.premultiplied ? GL_ONE : GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+        if (run.clip.IsNone()) {
+            gl.SetScissorTest(false);
+        } else {
+            gl.SetScissorTest(true);
+            // GL's scissor counts from the bottom
+            gl.SetScissor(run.clip.x, framebufferHeight - run.clip.y - run.clip.height,
+                          run.clip.width, run.clip.height);
+        }
+
+        if (run.kind == RunKind::Quads) {
+            gl.BindVertexArray(VertexArray(ctx));
+            gl.BindTexture(0, run.textureTarget, run.texture);
+            glDrawElementsBaseVertex(GL_TRIANGLES, run.count * 6, GL_UNSIGNED_SHORT,
+                                     (void*)(intptr_t(run.first) * 6 * sizeof(uint16_t)), baseVertex);
+        } else {
+            RoundedRectVertexArray(ctx, instanceOffset + GLintptr(run.first) * GLintptr(sizeof(RoundedRectInstance)));
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, run.count);
+        }
+        ++stats.drawCalls;
+    }
+    ++stats.flushes;
+    Discard();
+}
+
+void mayak::gfx::QuadBatch::Discard() {
+    quadCount = 0;
+    instances.clear();
+    runs.clear();
+    clipRects.resize(1);
+    clipIdValid = false;
+    // The current style stays current, it just moves to a fresh table
+    DistanceFieldStyle current = styles[styleIndex];
+    styles.resize(1);
+    styleIndex = 0;
+    SetDistanceFieldStyle(current);
+}
+
+void mayak::gfx::QuadBatch::End() {
+    if (!clipStack.empty()) {
+        MAYAK_LOG_WARN("QuadBatch: " + std::to_string(clipStack.size()) + " clips still pushed at End()");
+        // Stencil clips have to come out again, the next frame expects a clean stencil
+        while (!clipStack.empty()) PopClip();
+    }
+    Flush();
+    if (stencilCleared) State().SetStencilTest(false);
+    lastFrame = stats;
+    stats = BatchStats{};
+}
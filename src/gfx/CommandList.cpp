@@ -0,0 +1,383 @@
+#include "gfx/CommandList.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+    using mayak::gfx::CommandList;
+
+    // Payloads, all of them start with the Command header so Replay() can switch on it
+    struct RectCommand {
+        CommandList::Command header;
+        float x, y, width, height;
+        uint32_t color;
+    };
+
+    struct ImageCommand {
+        CommandList::Command header;
+        float x, y, width, height;
+        float u0, v0, u1, v1;
+        GLuint texture;
+        uint32_t tint;
+    };
+
+    struct AtlasImageCommand {
+        CommandList::Command header;
+        float x, y, width, height;
+        mayak::gfx::TextureAtlas* atlas;
+        uint64_t key; // looked up at replay, the region may have moved since
+        uint32_t tint;
+    };
+
+    struct RoundedRectCommand {
+        CommandList::Command header;
+        mayak::gfx::RoundedRectInstance rect;
+    };
+
+    struct TextCommand {
+        CommandList::Command header;
+        mayak::gfx::GlyphCache* glyphs;
+        const char* text;
+        uint32_t length;
+        mayak::gfx::FontId font;
+        float size, x, baseline;
+        uint32_t color;
+    };
+
+    struct DistanceFieldTextCommand {
+        CommandList::Command header;
+        mayak::gfx::SdfGlyphCache* glyphs;
+        const char* text;
+        uint32_t length;
+        mayak::gfx::FontId font;
+        float size, x, baseline;
+        uint32_t color;
+        mayak::gfx::SdfTextStyle style;
+    };
+
+    struct CustomCommand {
+        CommandList::Command header;
+        CommandList::CustomFn fn;
+        const void* data;
+    };
+
+    template <typename T>
+    constexpr mayak::gfx::CommandType type_of();
+    template <> constexpr mayak::gfx::CommandType type_of<RectCommand>() { return mayak::gfx::CommandType::Rect; }
+    template <> constexpr mayak::gfx::CommandType type_of<ImageCommand>() { return mayak::gfx::CommandType::Image; }
+    template <> constexpr mayak::gfx::CommandType type_of<AtlasImageCommand>() { return mayak::gfx::CommandType::AtlasImage; }
+    template <> constexpr mayak::gfx::CommandType type_of<RoundedRectCommand>() { return mayak::gfx::CommandType::RoundedRect; }
+    template <> constexpr mayak::gfx::CommandType type_of<TextCommand>() { return mayak::gfx::CommandType::Text; }
+    template <> constexpr mayak::gfx::CommandType type_of<DistanceFieldTextCommand>() {
+        return mayak::gfx::CommandType::DistanceFieldText;
+    }
+    template <> constexpr mayak::gfx::CommandType type_of<CustomCommand>() { return mayak::gfx::CommandType::Custom; }
+
+    uint16_t pipeline(mayak::gfx::SortPipeline value) { return static_cast<uint16_t>(value); }
+
+    // Below the depth in the sort key: pipeline and texture
+    constexpr int STATE_BITS = 40;
+    constexpr uint64_t STATE_MASK = (uint64_t(1) << STATE_BITS) - 1;
+    constexpr uint32_t NO_ENTRY = 0xFFFFFFFFu;
+
+    using Bounds = mayak::gfx::CommandList::Bounds;
+
+    constexpr Bounds EVERYWHERE{-1e30f, -1e30f, 1e30f, 1e30f};
+
+    bool overlap(const Bounds& a, const Bounds& b) {
+        return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+    }
+
+    Bounds rect_bounds(float x, float y, float width, float height) {
+        // A pixel of slack for anti-aliased edges
+        return Bounds{x - 1, y - 1, x + width + 1, y + height + 1};
+    }
+
+    // Not laid out until replay, so a box no glyph gets out of: an em per byte, bearings and all
+    Bounds text_bounds(float size, float x, float baseline, std::size_t length) {
+        return Bounds{x - size, baseline - 2 * size, x + size * float(length + 1), baseline + size};
+    }
+
+    // Where the batch and a CommandTarget spell things differently
+    using mayak::gfx::QuadBatch;
+    using mayak::gfx::CommandTarget;
+
+    void draw_image(QuadBatch& batch, const ImageCommand& image) {
+        batch.DrawTexturedRect(image.x, image.y, image.width, image.height, image.texture,
+                               image.u0, image.v0, image.u1, image.v1, image.tint);
+    }
+    void draw_image(CommandTarget& target, const ImageCommand& image) {
+        target.DrawImage(image.x, image.y, image.width, image.height, image.texture,
+                         image.u0, image.v0, image.u1, image.v1, image.tint);
+    }
+
+    // Gone from the atlas since it was recorded: nothing to draw
+    void draw_atlas_image(QuadBatch& batch, const AtlasImageCommand& image) {
+        if (const mayak::gfx::AtlasRegion* region = image.atlas->Find(image.key))
+            batch.DrawAtlasRect(image.x, image.y, image.width, image.height, *image.atlas, *region, image.tint);
+    }
+    void draw_atlas_image(CommandTarget& target, const AtlasImageCommand& image) {
+        if (const mayak::gfx::AtlasRegion* region = image.atlas->Find(image.key))
+            target.DrawAtlasImage(image.x, image.y, image.width, image.height, *image.atlas, *region, image.tint);
+    }
+
+    void draw_text(QuadBatch& batch, const TextCommand& text) {
+        text.glyphs->DrawText(batch, text.font, text.size, text.x, text.baseline,
+                              std::string_view(text.text, text.length), text.color);
+    }
+    void draw_text(CommandTarget& target, const TextCommand& text) {
+        target.DrawText(*text.glyphs, text.font, text.size, text.x, text.baseline,
+                        std::string_view(text.text, text.length), text.color);
+    }
+
+    void draw_text(QuadBatch& batch, const DistanceFieldTextCommand& text) {
+        text.glyphs->DrawText(batch, text.font, text.size, text.x, text.baseline,
+                              std::string_view(text.text, text.length), text.color, text.style);
+    }
+    void draw_text(CommandTarget& target, const DistanceFieldTextCommand& text) {
+        target.DrawText(*text.glyphs, text.font, text.size, text.x, text.baseline,
+                        std::string_view(text.text, text.length), text.color, text.style);
+    }
+
+    void draw_custom(QuadBatch& batch, const CustomCommand& custom) { custom.fn(batch, custom.data); }
+    void draw_custom(CommandTarget& target, const CustomCommand& custom) { target.DrawCustom(custom.fn, custom.data); }
+}
+
+template <typename T>
+T* mayak::gfx::CommandList::Record(uint16_t sortPipeline, uint32_t texture, Bounds bounds) {
+    static_assert(std::is_trivially_destructible_v<T>, "the arena doesn't run destructors");
+    T* command = arena.New<T>();
+    command->header.type = type_of<T>();
+    command->header.clip = clips.empty() ? nullptr : clips.back();
+    // Nothing shows outside the clip, so nothing there can overlap
+    if (const ClipRect* clip = command->header.clip) {
+        bounds.left = std::max(bounds.left, float(clip->x));
+        bounds.top = std::max(bounds.top, float(clip->y));
+        bounds.right = std::min(bounds.right, float(clip->x + clip->width));
+        bounds.bottom = std::min(bounds.bottom, float(clip->y + clip->height));
+    }
+    entries.push_back(Entry{MakeSortKey(layer, depth, sortPipeline, texture), uint32_t(entries.size()), 0,
+                            bounds, &command->header});
+    sorted = false;
+    return command;
+}
+
+std::string_view mayak::gfx::CommandList::Copy(std::string_view text) {
+    if (text.empty()) return {};
+    char* copy = arena.AllocateArray<char>(text.size());
+    std::memcpy(copy, text.data(), text.size());
+    return std::string_view(copy, text.size());
+}
+
+void mayak::gfx::CommandList::PushClip(const ClipRect& clip) {
+    const ClipRect* outer = clips.empty() ? nullptr : clips.back();
+    ClipRect merged = outer ? Intersect(clip, *outer) : clip;
+    // "No clip" inside a clip is still the outer clip, no need for another copy
+    if (outer && merged == *outer) {
+        clips.push_back(outer);
+        return;
+    }
+    clips.push_back(merged.IsNone() ? nullptr : arena.New<ClipRect>(merged));
+}
+
+void mayak::gfx::CommandList::PopClip() {
+    if (clips.empty()) {
+        MAYAK_LOG_WARN("CommandList: PopClip() without a PushClip()");
+        return;
+    }
+    clips.pop_back();
+}
+
+void mayak::gfx::CommandList::DrawRect(float x, float y, float width, float height, uint32_t color) {
+    RectCommand* command = Record<RectCommand>(pipeline(SortPipeline::Quads), 0, rect_bounds(x, y, width, height));
+    command->x = x;
+    command->y = y;
+    command->width = width;
+    command->height = height;
+    command->color = color;
+}
+
+void mayak::gfx::CommandList::DrawImage(float x, float y, float width, float height, GLuint texture,
+                                        float u0, float v0, float u1, float v1, uint32_t tint) {
+    ImageCommand* command =
+        Record<ImageCommand>(pipeline(SortPipeline::Quads), texture, rect_bounds(x, y, width, height));
+    *command = ImageCommand{command->header, x, y, width, height, u0, v0, u1, v1, texture, tint};
+}
+
+void mayak::gfx::CommandList::DrawAtlasImage(float x, float y, float width, float height, TextureAtlas& atlas,
+                                             uint64_t key, uint32_t tint) {
+    AtlasImageCommand* command = Record<AtlasImageCommand>(pipeline(SortPipeline::Atlas), atlas.Texture(),
+                                                           rect_bounds(x, y, width, height));
+    *command = AtlasImageCommand{command->header, x, y, width, height, &atlas, key, tint};
+}
+
+void mayak::gfx::CommandList::DrawRoundedRect(const RoundedRectInstance& rect) {
+    RoundedRectCommand* command = Record<RoundedRectCommand>(pipeline(SortPipeline::RoundedRects), 0,
+                                                             rect_bounds(rect.x, rect.y, rect.width, rect.height));
+    command->rect = rect;
+}
+
+void mayak::gfx::CommandList::DrawText(GlyphCache& glyphs, FontId font, float size, float x, float baseline,
+                                       std::string_view text, uint32_t color) {
+    if (text.empty()) return;
+    std::string_view copy = Copy(text);
+    TextCommand* command = Record<TextCommand>(pipeline(SortPipeline::Atlas), glyphs.Atlas().Texture(),
+                                               text_bounds(size, x, baseline, text.size()));
+    *command = TextCommand{command->header, &glyphs, copy.data(), uint32_t(copy.size()), font, size, x, baseline, color};
+}
+
+void mayak::gfx::CommandList::DrawText(SdfGlyphCache& glyphs, FontId font, float size, float x, float baseline,
+                                       std::string_view text, uint32_t color, const SdfTextStyle& style) {
+    if (text.empty()) return;
+    std::string_view copy = Copy(text);
+    DistanceFieldTextCommand* command =
+        Record<DistanceFieldTextCommand>(pipeline(SortPipeline::DistanceField), glyphs.Atlas().Texture(),
+                                         text_bounds(size, x, baseline, text.size()));
+    *command = DistanceFieldTextCommand{command->header, &glyphs, copy.data(), uint32_t(copy.size()),
+                                        font, size, x, baseline, color, style};
+}
+
+void mayak::gfx::CommandList::DrawCustom(CustomFn fn, const void* data, std::size_t size) {
+    const void* copy = data;
+    if (data && size) {
+        void* bytes = arena.Allocate(size);
+        std::memcpy(bytes, data, size);
+        copy = bytes;
+    }
+    // It could draw anything anywhere, nothing gets moved past it
+    CustomCommand* command = Record<CustomCommand>(pipeline(SortPipeline::Custom), 0, EVERYWHERE);
+    command->fn = fn;
+    command->data = copy;
+}
+
+void mayak::gfx::CommandList::Append(const CommandList& other) {
+    entries.reserve(entries.size() + other.entries.size());
+    // Their order among each other stays, they just come after everything recorded so far
+    std::vector<Entry> appended(other.entries);
+    std::sort(appended.begin(), appended.end(),
+              [](const Entry& a, const Entry& b) { return a.sequence < b.sequence; });
+    for (const Entry& entry : appended)
+        entries.push_back(Entry{entry.key, uint32_t(entries.size()), 0, entry.bounds, entry.command});
+    sorted = false;
+}
+
+void mayak::gfx::CommandList::Sort() {
+    if (sorted) return;
+    // Recording order within each layer and depth, the slots are worked out in it
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        uint64_t depthA = a.key >> STATE_BITS, depthB = b.key >> STATE_BITS;
+        return depthA != depthB ? depthA < depthB : a.sequence < b.sequence;
+    });
+    for (std::size_t begin = 0, end; begin < entries.size(); begin = end) {
+        end = begin + 1;
+        while (end < entries.size() && entries[end].key >> STATE_BITS == entries[begin].key >> STATE_BITS) ++end;
+        AssignSlots(begin, end);
+    }
+    // Sequence as the tie breaker makes it stable without stable_sort's temporary buffer
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        uint64_t depthA = a.key >> STATE_BITS, depthB = b.key >> STATE_BITS;
+        if (depthA != depthB) return depthA < depthB;
+        if (a.slot != b.slot) return a.slot < b.slot;
+        return a.key != b.key ? a.key < b.key : a.sequence < b.sequence;
+    });
+    sorted = true;
+}
+
+void mayak::gfx::CommandList::AssignSlots(std::size_t begin, std::size_t end) {
+    slots.clear();
+    nextInSlot.resize(entries.size());
+    for (std::size_t i = begin; i < end; ++i) {
+        Entry& entry = entries[i];
+        uint32_t slot = 0;
+        // The newest slot with something under this command: same state can join it, anything else goes after
+        for (std::size_t s = slots.size(); s-- > 0;) {
+            if (!overlap(slots[s].area, entry.bounds)) continue;
+            bool under = false, differs = false;
+            for (uint32_t j = slots[s].first; j != NO_ENTRY && !differs; j = nextInSlot[j]) {
+                if (!overlap(entries[j].bounds, entry.bounds)) continue;
+                under = true;
+                differs = (entries[j].key & STATE_MASK) != (entry.key & STATE_MASK);
+            }
+            if (!under) continue;
+            slot = uint32_t(differs ? s + 1 : s);
+            break;
+        }
+
+        entry.slot = slot;
+        if (slot == slots.size()) {
+            slots.push_back(Slot{entry.bounds, uint32_t(i)});
+            nextInSlot[i] = NO_ENTRY;
+            continue;
+        }
+        Bounds& area = slots[slot].area;
+        area = Bounds{std::min(area.left, entry.bounds.left), std::min(area.top, entry.bounds.top),
+                      std::max(area.right, entry.bounds.right), std::max(area.bottom, entry.bounds.bottom)};
+        nextInSlot[i] = slots[slot].first;
+        slots[slot].first = uint32_t(i);
+    }
+}
+
+template <typename Target>
+void mayak::gfx::CommandList::ReplayInto(Target& target, const ClipRect& outside) {
+    const ClipRect* currentClip = nullptr;
+    bool first = true;
+
+    for (const Entry& entry : entries) {
+        const Command* command = entry.command;
+        // The batch ignores clips that didn't change, this just saves the compare.
+        // Replayed inside a pushed clip, the commands stay inside it too
+        if (first || command->clip != currentClip) {
+            target.SetClip(command->clip ? Intersect(*command->clip, outside) : outside);
+            currentClip = command->clip;
+            first = false;
+        }
+
+        switch (command->type) {
+            case CommandType::Rect: {
+                auto* rect = reinterpret_cast<const RectCommand*>(command);
+                target.DrawRect(rect->x, rect->y, rect->width, rect->height, rect->color);
+                break;
+            }
+            case CommandType::Image:
+                draw_image(target, *reinterpret_cast<const ImageCommand*>(command));
+                break;
+            case CommandType::AtlasImage:
+                draw_atlas_image(target, *reinterpret_cast<const AtlasImageCommand*>(command));
+                break;
+            case CommandType::RoundedRect:
+                target.DrawRoundedRect(reinterpret_cast<const RoundedRectCommand*>(command)->rect);
+                break;
+            case CommandType::Text:
+                draw_text(target, *reinterpret_cast<const TextCommand*>(command));
+                break;
+            case CommandType::DistanceFieldText:
+                draw_text(target, *reinterpret_cast<const DistanceFieldTextCommand*>(command));
+                break;
+            case CommandType::Custom:
+                draw_custom(target, *reinterpret_cast<const CustomCommand*>(command));
+                break;
+        }
+    }
+    target.SetClip(outside);
+}
+
+void mayak::gfx::CommandList::Replay(QuadBatch& batch) {
+    Sort();
+    ReplayInto(batch, ClipRect(batch.Clip()));
+}
+
+void mayak::gfx::CommandList::Replay(CommandTarget& target) {
+    Sort();
+    ReplayInto(target, ClipRect{});
+}
+
+void mayak::gfx::CommandList::Clear() {
+    entries.clear();
+    clips.clear();
+    arena.Reset();
+    layer = 0;
+    depth = 0;
+    sorted = true;
+}
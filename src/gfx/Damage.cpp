@@ -0,0 +1,219 @@
+#include "gfx/Damage.hpp"
+#include "gfx/GLState.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+
+namespace {
+    using mayak::gfx::ClipRect;
+
+    int64_t area(const ClipRect& rect) {
+        return int64_t(rect.width) * rect.height;
+    }
+
+    bool overlaps(const ClipRect& a, const ClipRect& b) {
+        return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+    }
+
+    ClipRect bounding_box(const ClipRect& a, const ClipRect& b) {
+        int left = std::min(a.x, b.x), top = std::min(a.y, b.y);
+        int right = std::max(a.x + a.width, b.x + b.width);
+        int bottom = std::max(a.y + a.height, b.y + b.height);
+        return ClipRect{left, top, right - left, bottom - top};
+    }
+
+    /// Pixels the bounding box covers that neither of them does (the overlap counted once is fine, it's a heuristic)
+    int64_t waste(const ClipRect& a, const ClipRect& b) {
+        return area(bounding_box(a, b)) - area(a) - area(b);
+    }
+}
+
+void mayak::gfx::DamageTracker::SetSize(int newWidth, int newHeight) {
+    if (newWidth == width && newHeight == height) return;
+    width = newWidth;
+    height = newHeight;
+    AddAll();
+}
+
+void mayak::gfx::DamageTracker::Add(const ClipRect& rect) {
+    if (full || rect.IsNone()) return;
+    ClipRect clamped = Intersect(rect, ClipRect{0, 0, width, height});
+    if (clamped.width <= 0 || clamped.height <= 0) return;
+    Insert(clamped);
+    if (Area() * 100 >= int64_t(width) * height * FULL_PERCENT) AddAll();
+}
+
+void mayak::gfx::DamageTracker::AddAll() {
+    regions.clear();
+    full = true;
+    if (width > 0 && height > 0) regions.push_back(ClipRect{0, 0, width, height});
+}
+
+void mayak::gfx::DamageTracker::Insert(ClipRect rect) {
+    // Swallow everything it touches, the bounding box may touch more, so go again until it doesn't
+    for (bool merged = true; merged;) {
+        merged = false;
+        for (std::size_t i = 0; i < regions.size(); ++i) {
+            if (overlaps(regions[i], rect) || waste(regions[i], rect) <= 0) {
+                rect = bounding_box(regions[i], rect);
+                regions[i] = regions.back();
+                regions.pop_back();
+                merged = true;
+                break;
+            }
+        }
+    }
+    regions.push_back(rect);
+    if (int(regions.size()) <= MAX_REGIONS) return;
+
+    // One too many, merge the cheapest pair. Never overlaps anything else, it goes through Insert() again
+    std::size_t bestA = 0, bestB = 1;
+    int64_t best = waste(regions[0], regions[1]);
+    for (std::size_t a = 0; a < regions.size(); ++a) {
+        for (std::size_t b = a + 1; b < regions.size(); ++b) {
+            int64_t cost = waste(regions[a], regions[b]);
+            if (cost < best) {
+                best = cost;
+                bestA = a;
+                bestB = b;
+            }
+        }
+    }
+    ClipRect combined = bounding_box(regions[bestA], regions[bestB]);
+    regions.erase(regions.begin() + bestB);
+    regions.erase(regions.begin() + bestA);
+    Insert(combined);
+}
+
+int64_t mayak::gfx::DamageTracker::Area() const {
+    int64_t total = 0;
+    for (const ClipRect& rect : regions) total += area(rect);
+    return total;
+}
+
+void mayak::gfx::DamageTracker::Clear() {
+    regions.clear();
+    full = false;
+}
+
+void mayak::gfx::DamageTracker::Commit() {
+    Frame& frame = history[committed % HISTORY];
+    frame.regions = regions;
+    frame.full = full;
+    ++committed;
+    Clear();
+}
+
+void mayak::gfx::DamageTracker::RegionsSince(int age, std::vector<ClipRect>& out) const {
+    out.clear();
+    bool everything = full || age <= 0 || uint64_t(age - 1) > committed || age - 1 > HISTORY;
+    for (int back = 1; back < age && !everything; ++back)
+        everything = history[(committed - back) % HISTORY].full;
+    if (everything) {
+        if (width > 0 && height > 0) out.push_back(ClipRect{0, 0, width, height});
+        return;
+    }
+
+    DamageTracker merged;
+    merged.width = width;
+    merged.height = height;
+    for (const ClipRect& rect : regions) merged.Add(rect);
+    for (int back = 1; back < age; ++back)
+        for (const ClipRect& rect : history[(committed - back) % HISTORY].regions) merged.Add(rect);
+    out = merged.regions;
+}
+
+void mayak::gfx::PartialRedraw::Invalidate(const ClipRect& rect) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.Add(rect);
+}
+
+void mayak::gfx::PartialRedraw::InvalidateAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.AddAll();
+}
+
+bool mayak::gfx::PartialRedraw::HasDamage() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // No framebuffer yet means nothing to show, that's damage too
+    return !fbo || !pending.Empty();
+}
+
+bool mayak::gfx::PartialRedraw::Begin(int width, int height) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        damage.SetSize(width, height);
+        if (pending.IsFull()) {
+            damage.AddAll();
+        } else {
+            for (const ClipRect& rect : pending.Regions()) damage.Add(rect);
+        }
+        // Rects from now on are against this size
+        pending.SetSize(width, height);
+        pending.Clear();
+    }
+
+    if (!fbo || fboWidth != width || fboHeight != height) {
+        GLState& gl = State();
+        if (!fbo) {
+            glGenFramebuffers(1, &fbo);
+            glGenRenderbuffers(1, &colorBuffer);
+            glGenRenderbuffers(1, &depthBuffer);
+        }
+        fboWidth = width;
+        fboHeight = height;
+
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+        gl.BindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            MAYAK_LOG_ERROR("PartialRedraw: retained framebuffer is incomplete.");
+        // Fresh storage is garbage
+        damage.AddAll();
+    }
+
+    if (damage.Empty()) return false;
+    ++stats.frames;
+    stats.fullFrames += damage.IsFull();
+    stats.lastRegions = int(damage.Regions().size());
+    stats.lastRedrawnPixels = damage.Area();
+    stats.redrawnPixels += uint64_t(stats.lastRedrawnPixels);
+    return true;
+}
+
+void mayak::gfx::PartialRedraw::Present(GLuint target, int bufferAge) {
+    GLState& gl = State();
+    damage.RegionsSince(bufferAge, presentRegions);
+
+    gl.BindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    gl.BindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+    // Blits are scissored too
+    gl.SetScissorTest(false);
+    for (const ClipRect& rect : presentRegions) {
+        // Both bottom-up, the rects are top-down
+        int y = fboHeight - rect.y - rect.height;
+        glBlitFramebuffer(rect.x, y, rect.x + rect.width, y + rect.height,
+                          rect.x, y, rect.x + rect.width, y + rect.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        stats.presentedPixels += uint64_t(rect.width) * uint64_t(rect.height);
+    }
+    gl.BindFramebuffer(GL_FRAMEBUFFER, target);
+}
+
+void mayak::gfx::PartialRedraw::End() {
+    damage.Commit();
+}
+
+void mayak::gfx::PartialRedraw::Destroy() {
+    if (!fbo) return;
+    State().ForgetFramebuffer(fbo);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    fbo = colorBuffer = depthBuffer = 0;
+    fboWidth = fboHeight = 0;
+}
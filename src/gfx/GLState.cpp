@@ -0,0 +1,310 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "gfx/GLState.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    // Every context has its own state, the render thread and the main thread may ask at once
+    std::mutex statesMutex;
+    std::unordered_map<GLFWwindow*, std::unique_ptr<mayak::gfx::GLState>> states;
+
+    // Bumped whenever a shadow gets deleted, so no thread keeps a dangling cache
+    std::atomic<uint64_t> generation{0};
+
+    struct CachedState {
+        GLFWwindow* context = nullptr;
+        mayak::gfx::GLState* state = nullptr;
+        uint64_t generation = 0;
+    };
+    thread_local CachedState cached;
+
+    int buffer_slot(GLenum target) {
+        switch (target) {
+            case GL_ARRAY_BUFFER: return 0;
+            case GL_ELEMENT_ARRAY_BUFFER: return 1;
+            case GL_UNIFORM_BUFFER: return 2;
+            case GL_PIXEL_UNPACK_BUFFER: return 3;
+            default: return -1;
+        }
+    }
+
+    int texture_slot(GLenum target) {
+        switch (target) {
+            case GL_TEXTURE_2D: return 0;
+            case GL_TEXTURE_2D_ARRAY: return 1;
+            default: return -1;
+        }
+    }
+}
+
+void mayak::gfx::GLState::UseProgram(GLuint newProgram) {
+    if (Changed(program != newProgram)) {
+        glUseProgram(newProgram);
+        program = newProgram;
+    }
+}
+
+void mayak::gfx::GLState::BindVertexArray(GLuint vao) {
+    if (Changed(vertexArray != vao)) {
+        glBindVertexArray(vao);
+        vertexArray = vao;
+        // The element buffer binding is part of the VAO
+        buffers[ELEMENT] = UNKNOWN;
+    }
+}
+
+void mayak::gfx::GLState::BindBuffer(GLenum target, GLuint buffer) {
+    int slot = buffer_slot(target);
+    if (slot < 0) {
+        Changed(true);
+        glBindBuffer(target, buffer);
+        return;
+    }
+    if (Changed(buffers[slot] != buffer)) {
+        glBindBuffer(target, buffer);
+        buffers[slot] = buffer;
+    }
+}
+
+void mayak::gfx::GLState::BindTexture(int unit, GLenum target, GLuint texture) {
+    int slot = texture_slot(target);
+    bool shadowed = slot >= 0 && unit >= 0 && unit < TEXTURE_UNITS;
+    if (!Changed(!shadowed || textures[unit][slot] != texture)) return;
+
+    if (activeUnit != static_cast<GLuint>(unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    glBindTexture(target, texture);
+    if (shadowed) textures[unit][slot] = texture;
+}
+
+void mayak::gfx::GLState::BindFramebuffer(GLenum target, GLuint framebuffer) {
+    bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+    bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+    if (!Changed((draw && drawFramebuffer != framebuffer) || (read && readFramebuffer != framebuffer))) return;
+
+    glBindFramebuffer(target, framebuffer);
+    if (draw) drawFramebuffer = framebuffer;
+    if (read) readFramebuffer = framebuffer;
+}
+
+bool mayak::gfx::GLState::SetFlag(int8_t& shadow, bool enabled, GLenum capability) {
+    if (!Changed(shadow != static_cast<int8_t>(enabled))) return false;
+    if (enabled) glEnable(capability);
+    else glDisable(capability);
+    shadow = enabled;
+    return true;
+}
+
+void mayak::gfx::GLState::SetBlend(bool enabled) {
+    SetFlag(blend, enabled, GL_BLEND);
+}
+
+void mayak::gfx::GLState::SetBlendFunc(GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha, GLenum dstAlpha) {
+    std::array<GLenum, 4> wanted{srcRgb, dstRgb, srcAlpha, dstAlpha};
+    if (Changed(blendFunc != wanted)) {
+        glBlendFuncSeparate(srcRgb, dstRgb, srcAlpha, dstAlpha);
+        blendFunc = wanted;
+    }
+}
+
+void mayak::gfx::GLState::SetBlendEquation(GLenum mode) {
+    if (Changed(blendEquation != mode)) {
+        glBlendEquation(mode);
+        blendEquation = mode;
+    }
+}
+
+void mayak::gfx::GLState::SetScissorTest(bool enabled) {
+    SetFlag(scissorTest, enabled, GL_SCISSOR_TEST);
+}
+
+void mayak::gfx::GLState::SetScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    std::array<GLint, 4> wanted{x, y, width, height};
+    if (Changed(scissor != wanted)) {
+        glScissor(x, y, width, height);
+        scissor = wanted;
+    }
+}
+
+void mayak::gfx::GLState::SetViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    std::array<GLint, 4> wanted{x, y, width, height};
+    if (Changed(viewport != wanted)) {
+        glViewport(x, y, width, height);
+        viewport = wanted;
+    }
+}
+
+void mayak::gfx::GLState::SetDepthTest(bool enabled) {
+    SetFlag(depthTest, enabled, GL_DEPTH_TEST);
+}
+
+void mayak::gfx::GLState::SetDepthMask(bool enabled) {
+    if (Changed(depthMask != static_cast<int8_t>(enabled))) {
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+        depthMask = enabled;
+    }
+}
+
+void mayak::gfx::GLState::SetDepthFunc(GLenum func) {
+    if (Changed(depthFunc != func)) {
+        glDepthFunc(func);
+        depthFunc = func;
+    }
+}
+
+void mayak::gfx::GLState::SetStencilTest(bool enabled) {
+    SetFlag(stencilTest, enabled, GL_STENCIL_TEST);
+}
+
+void mayak::gfx::GLState::SetStencilFunc(GLenum func, GLint ref, GLuint mask) {
+    if (Changed(stencilFunc != func || stencilRef != ref || stencilFuncMask != mask)) {
+        glStencilFunc(func, ref, mask);
+        stencilFunc = func;
+        stencilRef = ref;
+        stencilFuncMask = mask;
+    }
+}
+
+void mayak::gfx::GLState::SetStencilOp(GLenum stencilFail, GLenum depthFail, GLenum depthPass) {
+    std::array<GLenum, 3> wanted{stencilFail, depthFail, depthPass};
+    if (Changed(stencilOp != wanted)) {
+        glStencilOp(stencilFail, depthFail, depthPass);
+        stencilOp = wanted;
+    }
+}
+
+void mayak::gfx::GLState::SetStencilMask(GLuint mask) {
+    if (Changed(stencilWriteMask != mask)) {
+        glStencilMask(mask);
+        stencilWriteMask = mask;
+    }
+}
+
+void mayak::gfx::GLState::SetColorMask(bool enabled) {
+    if (Changed(colorMask != static_cast<int8_t>(enabled))) {
+        GLboolean value = enabled ? GL_TRUE : GL_FALSE;
+        glColorMask(value, value, value, value);
+        colorMask = enabled;
+    }
+}
+
+void mayak::gfx::GLState::Invalidate() {
+    program = vertexArray = drawFramebuffer = readFramebuffer = UNKNOWN;
+    buffers.fill(UNKNOWN);
+    for (auto& unit : textures) unit.fill(UNKNOWN);
+    activeUnit = UNKNOWN;
+
+    blend = scissorTest = depthTest = depthMask = stencilTest = colorMask = UNKNOWN_FLAG;
+    blendFunc.fill(UNKNOWN);
+    blendEquation = UNKNOWN;
+    scissor.fill(-1);
+    viewport.fill(-1);
+    depthFunc = UNKNOWN;
+    stencilFunc = UNKNOWN;
+    stencilRef = -1;
+    stencilFuncMask = stencilWriteMask = UNKNOWN;
+    stencilOp.fill(UNKNOWN);
+}
+
+// GL unbinds deleted objects by itself, and 0 is what's bound afterwards
+
+void mayak::gfx::GLState::ForgetProgram(GLuint deleted) {
+    // A deleted program stays in use until another one is, so it's "unknown", not 0
+    if (program == deleted) program = UNKNOWN;
+}
+
+void mayak::gfx::GLState::ForgetVertexArray(GLuint deleted) {
+    if (vertexArray == deleted) {
+        vertexArray = 0;
+        buffers[ELEMENT] = UNKNOWN;
+    }
+}
+
+// Other contexts keep the deleted object bound until they bind something else, binding 0 there isn't a no-op
+
+void mayak::gfx::GLState::ForgetBuffer(GLuint deleted, bool current) {
+    GLuint now = current ? 0 : UNKNOWN;
+    for (auto& buffer : buffers)
+        if (buffer == deleted) buffer = now;
+}
+
+void mayak::gfx::GLState::ForgetTexture(GLuint deleted, bool current) {
+    GLuint now = current ? 0 : UNKNOWN;
+    for (auto& unit : textures)
+        for (auto& texture : unit)
+            if (texture == deleted) texture = now;
+}
+
+void mayak::gfx::GLState::ForgetFramebuffer(GLuint deleted, bool current) {
+    GLuint now = current ? 0 : UNKNOWN;
+    if (drawFramebuffer == deleted) drawFramebuffer = now;
+    if (readFramebuffer == deleted) readFramebuffer = now;
+}
+
+void mayak::gfx::GLState::EndFrame() {
+    lastFrame = stats;
+    stats = GLStateStats{};
+}
+
+GLuint& mayak::gfx::GLState::ContextObject(uint64_t key) {
+    for (auto& object : contextObjects)
+        if (object.first == key) return object.second;
+    contextObjects.emplace_back(key, 0);
+    return contextObjects.back().second;
+}
+
+void mayak::gfx::GLState::ForgetContextObject(uint64_t key) {
+    for (auto it = contextObjects.begin(); it != contextObjects.end(); ++it) {
+        if (it->first == key) {
+            contextObjects.erase(it);
+            return;
+        }
+    }
+}
+
+mayak::gfx::GLState& mayak::gfx::State() {
+    GLFWwindow* context = glfwGetCurrentContext();
+    if (cached.context == context && cached.state && cached.generation == generation.load(std::memory_order_acquire))
+        return *cached.state;
+
+    GLState& state = State(context);
+    cached = CachedState{context, &state, generation.load()};
+    return state;
+}
+
+mayak::gfx::GLState& mayak::gfx::State(GLFWwindow* context) {
+    std::lock_guard<std::mutex> lock(statesMutex);
+    auto& state = states[context];
+    if (!state) state = std::make_unique<GLState>();
+    return *state;
+}
+
+void mayak::gfx::ForgetSharedProgram(GLuint program) {
+    std::lock_guard<std::mutex> lock(statesMutex);
+    for (auto& state : states) state.second->ForgetProgram(program);
+}
+
+void mayak::gfx::ForgetSharedBuffer(GLuint buffer) {
+    GLFWwindow* current = glfwGetCurrentContext();
+    std::lock_guard<std::mutex> lock(statesMutex);
+    for (auto& state : states) state.second->ForgetBuffer(buffer, state.first == current);
+}
+
+void mayak::gfx::ForgetSharedTexture(GLuint texture) {
+    GLFWwindow* current = glfwGetCurrentContext();
+    std::lock_guard<std::mutex> lock(statesMutex);
+    for (auto& state : states) state.second->ForgetTexture(texture, state.first == current);
+}
+
+void mayak::gfx::ForgetContext(GLFWwindow* context) {
+    std::lock_guard<std::mutex> lock(statesMutex);
+    states.erase(context);
+    generation.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,208 @@
+#include "gfx/GlyphCache.hpp"
+#include "gfx/Batch.hpp"
+#include "core/Mainloop.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr std::size_t INITIAL_SLOTS = 256;
+    static_assert(mayak::gfx::GLYPH_SUBPIXEL_STEPS <= 4, "the key has 2 bits for the subpixel step");
+
+    std::size_t slot_of(uint64_t key, std::size_t mask) {
+        // Fibonacci hashing, the high bits of the product are the well mixed ones
+        return std::size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    }
+}
+
+mayak::gfx::GlyphCache::GlyphCache(GlyphRasterizer& rasterizer, AtlasOptions atlasOptions)
+    : rasterizer(rasterizer), atlas([&] {
+          atlasOptions.internalFormat = GL_R8;
+          return atlasOptions;
+      }()) {
+    table.resize(INITIAL_SLOTS);
+}
+
+uint64_t mayak::gfx::GlyphCache::MakeKey(FontId font, uint32_t sizeQuarters, uint32_t codepoint, uint32_t subpixel) {
+    // 1 | font:16 | size:16 | subpixel:2 | codepoint:21, the top bit keeps it away from the "empty" 0
+    return (1ull << 63) | (uint64_t(font) << 39) | (uint64_t(std::min(sizeQuarters, 0xFFFFu)) << 23)
+         | (uint64_t(subpixel & 3) << 21) | (codepoint & 0x1FFFFF);
+}
+
+const mayak::gfx::CachedGlyph& mayak::gfx::GlyphCache::Get(FontId font, float size, uint32_t codepoint, float subpixel) {
+    uint32_t sizeQuarters = uint32_t(std::max(0L, std::lround(size * 4)));
+    int step = std::clamp(int(subpixel * GLYPH_SUBPIXEL_STEPS), 0, GLYPH_SUBPIXEL_STEPS - 1);
+    return Lookup(font, sizeQuarters, codepoint, uint32_t(step), core::frame_count());
+}
+
+const mayak::gfx::CachedGlyph& mayak::gfx::GlyphCache::Lookup(FontId font, uint32_t sizeQuarters,
+                                                              uint32_t codepoint, uint32_t subpixel, uint64_t frame) {
+    uint64_t key = MakeKey(font, sizeQuarters, codepoint, subpixel);
+    std::size_t mask = table.size() - 1;
+    for (std::size_t i = slot_of(key, mask);; i = (i + 1) & mask) {
+        Slot& slot = table[i];
+        if (slot.key == key) {
+            ++stats.hits;
+            CachedGlyph& glyph = glyphs[slot.index];
+            if (!glyph.drawable) {
+                // The atlas makes room between frames, earlier glyphs of this one can't move
+                if (glyph.waitingForRoom && glyph.lastUsedFrame != frame)
+                    return Rasterize(glyph, key, font, sizeQuarters, codepoint, subpixel, frame);
+                return glyph;
+            }
+
+            if (glyph.atlasGeneration != atlas.Generation()) {
+                // Something in the atlas moved, maybe us
+                ++stats.refreshes;
+                const AtlasRegion* region = atlas.Find(key);
+                if (!region) return Rasterize(glyph, key, font, sizeQuarters, codepoint, subpixel, frame);
+                glyph.region = *region;
+                glyph.atlasGeneration = atlas.Generation();
+                glyph.lastUsedFrame = frame;
+            } else if (glyph.lastUsedFrame != frame) {
+                // Once per glyph per frame is enough to keep the atlas LRU honest
+                atlas.Find(key);
+                glyph.lastUsedFrame = frame;
+            }
+            return glyph;
+        }
+        if (slot.key == 0) {
+            if ((glyphs.size() + 1) * 2 > table.size()) {
+                Grow();
+                return Lookup(font, sizeQuarters, codepoint, subpixel, frame);
+            }
+            slot.key = key;
+            slot.index = uint32_t(glyphs.size());
+            glyphs.emplace_back();
+            return Rasterize(glyphs.back(), key, font, sizeQuarters, codepoint, subpixel, frame);
+        }
+    }
+}
+
+const mayak::gfx::CachedGlyph& mayak::gfx::GlyphCache::Rasterize(CachedGlyph& glyph, uint64_t key, FontId font,
+                                                                 uint32_t sizeQuarters, uint32_t codepoint,
+                                                                 uint32_t subpixel, uint64_t frame) {
+    ++stats.misses;
+    GlyphBitmap bitmap;
+    bool found = rasterizer.Rasterize(font, sizeQuarters / 4.0f, codepoint,
+                                      float(subpixel) / GLYPH_SUBPIXEL_STEPS, bitmap);
+
+    glyph = CachedGlyph{};
+    glyph.bearingX = int16_t(bitmap.bearingX);
+    glyph.bearingY = int16_t(bitmap.bearingY);
+    glyph.advance = bitmap.advance;
+    glyph.lastUsedFrame = frame;
+    if (found && bitmap.width > 0 && bitmap.height > 0) {
+        const AtlasRegion* region = atlas.Insert(key, bitmap.width, bitmap.height, bitmap.pixels.data());
+        if (region) {
+            glyph.region = *region;
+            glyph.drawable = true;
+            // After the insert, it may have evicted stuff itself
+            glyph.atlasGeneration = atlas.Generation();
+        } else {
+            glyph.waitingForRoom = atlas.CanHold(bitmap.width, bitmap.height);
+        }
+    }
+    return glyph;
+}
+
+void mayak::gfx::GlyphCache::Grow() {
+    std::vector<Slot> old(table.size() * 2);
+    old.swap(table);
+    std::size_t mask = table.size() - 1;
+    for (const Slot& slot : old) {
+        if (!slot.key) continue;
+        std::size_t i = slot_of(slot.key, mask);
+        while (table[i].key) i = (i + 1) & mask;
+        table[i] = slot;
+    }
+}
+
+void mayak::gfx::GlyphCache::Clear() {
+    table.assign(INITIAL_SLOTS, Slot{});
+    glyphs.clear();
+    atlas.Clear();
+}
+
+template <typename Advance>
+float mayak::gfx::GlyphCache::Walk(FontId font, float size, float x, float baseline, std::string_view text,
+                                   Advance&& advance) {
+    float penX = x, lineY = baseline, widest = 0;
+    float lineHeight = -1; // only asked for when there's a second line
+
+    std::size_t offset = 0;
+    while (offset < text.size()) {
+        uint32_t codepoint = DecodeUtf8(text, offset);
+        if (codepoint == '\n') {
+            if (lineHeight < 0) lineHeight = rasterizer.Metrics(font, size).LineHeight();
+            widest = std::max(widest, penX - x);
+            penX = x;
+            lineY += lineHeight;
+            continue;
+        }
+
+        // Glyphs sit on whole pixels, the fraction picks the pre-shifted rasterization
+        float pixel = std::floor(penX);
+        int step = std::min(int((penX - pixel) * GLYPH_SUBPIXEL_STEPS), GLYPH_SUBPIXEL_STEPS - 1);
+        penX += advance(pixel, std::round(lineY), codepoint, uint32_t(step));
+    }
+    return std::max(widest, penX - x);
+}
+
+template <typename Place>
+float mayak::gfx::GlyphCache::Layout(FontId font, float size, float x, float baseline, std::string_view text,
+                                     Place&& place) {
+    uint32_t sizeQuarters = uint32_t(std::max(0L, std::lround(size * 4)));
+    uint64_t frame = core::frame_count();
+    return Walk(font, size, x, baseline, text, [&](float penX, float lineY, uint32_t codepoint, uint32_t subpixel) {
+        const CachedGlyph& glyph = Lookup(font, sizeQuarters, codepoint, subpixel, frame);
+        if (glyph.drawable) place(glyph, penX + glyph.bearingX, lineY - glyph.bearingY);
+        return glyph.advance;
+    });
+}
+
+float mayak::gfx::GlyphCache::DrawText(QuadBatch& batch, FontId font, float size, float x, float baseline,
+                                       std::string_view text, uint32_t color) {
+    auto draw = [&](const CachedGlyph& glyph, float left, float top) {
+        batch.DrawAtlasRect(left, top, float(glyph.region.width), float(glyph.region.height), atlas,
+                            glyph.region, color);
+    };
+    return Layout(font, size, x, baseline, text, draw);
+}
+
+float mayak::gfx::GlyphCache::MeasureText(FontId font, float size, std::string_view text) {
+    return Layout(font, size, 0, 0, text, [](const CachedGlyph&, float, float) {});
+}
+
+float mayak::gfx::GlyphCache::LayoutText(FontId font, float size, float x, float baseline, std::string_view text,
+                                         const std::function<float(const PlacedGlyph&)>& visit) {
+    uint32_t sizeQuarters = uint32_t(std::max(0L, std::lround(size * 4)));
+    return Walk(font, size, x, baseline, text, [&](float penX, float lineY, uint32_t codepoint, uint32_t subpixel) {
+        return visit(PlacedGlyph{codepoint, sizeQuarters, subpixel, penX, lineY});
+    });
+}
+
+uint32_t mayak::gfx::DecodeUtf8(std::string_view text, std::size_t& offset) {
+    const uint32_t REPLACEMENT = 0xFFFD;
+    auto byte = [&](std::size_t i) { return uint8_t(text[i]); };
+
+    uint8_t lead = byte(offset++);
+    if (lead < 0x80) return lead;
+
+    int extra;
+    uint32_t codepoint;
+    if ((lead & 0xE0) == 0xC0) { extra = 1; codepoint = lead & 0x1F; }
+    else if ((lead & 0xF0) == 0xE0) { extra = 2; codepoint = lead & 0x0F; }
+    else if ((lead & 0xF8) == 0xF0) { extra = 3; codepoint = lead & 0x07; }
+    else return REPLACEMENT; // stray continuation byte or garbage
+
+    for (int i = 0; i < extra; ++i) {
+        if (offset >= text.size() || (byte(offset) & 0xC0) != 0x80) return REPLACEMENT;
+        codepoint = (codepoint << 6) | (byte(offset++) & 0x3F);
+    }
+    // Overlong encodings and surrogates aren't text
+    static const uint32_t minimum[] = { 0, 0x80, 0x800, 0x10000 };
+    if (codepoint < minimum[extra] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+        return REPLACEMENT;
+    return codepoint;
+}
@@ -0,0 +1,327 @@
+#include <glad/glad.h>
+
+#include "gfx/ProgramCache.hpp"
+#include "core/Time.hpp"
+#include "utils/logger.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace {
+    namespace fs = std::filesystem;
+
+    constexpr char MAGIC[4] = {'M', 'Y', 'K', 'P'};
+    constexpr uint32_t FORMAT_VERSION = 1;
+
+    // What's in front of every binary on disk
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t size;
+        uint64_t checksum;
+        int64_t compileNs;
+    };
+
+    uint64_t fnv1a(std::string_view data, uint64_t hash = 0xcbf29ce484222325ull) {
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    std::mutex cacheMutex;
+    bool directoryChosen = false;
+    std::string cacheDirectory;
+    mayak::gfx::ProgramCacheStats stats;
+
+    std::string default_directory() {
+        auto from_env = [](const char* name) -> std::string {
+            const char* value = std::getenv(name);
+            return value && *value ? value : "";
+        };
+#if defined(_WIN32)
+        std::string base = from_env("LOCALAPPDATA");
+#elif defined(__APPLE__)
+        std::string home = from_env("HOME");
+        std::string base = home.empty() ? "" : home + "/Library/Caches";
+#else
+        std::string base = from_env("XDG_CACHE_HOME");
+        if (base.empty()) {
+            std::string home = from_env("HOME");
+            if (!home.empty()) base = home + "/.cache";
+        }
+#endif
+        if (base.empty()) return "";
+        return (fs::path(base) / "mayakui" / "shaders").string();
+    }
+
+    std::string driver_string() {
+        auto get = [](GLenum name) {
+            const GLubyte* value = glGetString(name);
+            return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+        };
+        return get(GL_VENDOR) + "|" + get(GL_RENDERER) + "|" + get(GL_VERSION);
+    }
+
+    bool binaries_supported() {
+        if (!GLAD_GL_VERSION_4_1) return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    // defines go after the #version line, which has to stay first
+    std::string with_defines(const char* source, const std::string& defines) {
+        std::string text = source;
+        if (defines.empty()) return text;
+        std::size_t version = text.find("#version");
+        std::size_t at = version == std::string::npos ? 0 : text.find('\n', version);
+        if (at == std::string::npos) {
+            text += '\n';
+            at = text.size();
+        } else if (version != std::string::npos) {
+            ++at;
+        }
+        text.insert(at, defines.back() == '\n' ? defines : defines + '\n');
+        return text;
+    }
+
+    bool CheckCompileErrors(GLuint shader, const std::string& type) {
+        GLint success;
+        GLchar infoLog[1024];
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+            MAYAK_LOG_ERROR("Error while compiling " + type + " shader: " + infoLog);
+            return false;
+        }
+        return true;
+    }
+    bool CheckLinkErrors(GLuint program) {
+        GLint success;
+        GLchar infoLog[1024];
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(program, 1024, NULL, infoLog);
+            MAYAK_LOG_ERROR(std::string("Error while linking shader program: ") + infoLog);
+            return false;
+        }
+        return true;
+    }
+
+    GLuint CompileProgram(const char* vertexSource, const char* fragmentSource, const std::string& name,
+                          bool retrievable) {
+        // Compile vertex shader
+        GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertexShader, 1, &vertexSource, nullptr);
+        glCompileShader(vertexShader);
+
+        // Check for compile errors
+        if (!CheckCompileErrors(vertexShader, name + " vertex")) {
+            glDeleteShader(vertexShader);
+            return 0;
+        }
+
+        // Compile fragment shader
+        GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+        glCompileShader(fragmentShader);
+
+        // Check for compile errors
+        if (!CheckCompileErrors(fragmentShader, name + " fragment")) {
+            glDeleteShader(vertexShader);
+            glDeleteShader(fragmentShader);
+            return 0;
+        }
+
+        // Link shaders, asking for a binary we can keep
+        GLuint program = glCreateProgram();
+        if (retrievable) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(program, vertexShader);
+        glAttachShader(program, fragmentShader);
+        glLinkProgram(program);
+
+        // Delete shaders, the program keeps what it needs
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+
+        if (!CheckLinkErrors(program)) {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+}
+
+uint64_t mayak::gfx::ProgramBinaryCache::Key(std::string_view vertexSource, std::string_view fragmentSource,
+                                             std::string_view defines, std::string_view driver) {
+    // Separators so moving text from one part to the next changes the key
+    uint64_t hash = fnv1a(vertexSource);
+    hash = fnv1a("\x1f", hash);
+    hash = fnv1a(fragmentSource, hash);
+    hash = fnv1a("\x1f", hash);
+    hash = fnv1a(defines, hash);
+    hash = fnv1a("\x1f", hash);
+    return fnv1a(driver, hash);
+}
+
+std::string mayak::gfx::ProgramBinaryCache::Path(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (fs::path(directory) / name).string();
+}
+
+bool mayak::gfx::ProgramBinaryCache::Load(uint64_t key, ProgramBinary& out) {
+    std::ifstream file(Path(key), std::ios::binary);
+    if (!file) return false;
+
+    FileHeader header{};
+    bool good = bool(file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        && std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+        && header.version == FORMAT_VERSION && header.key == key && header.size > 0;
+    if (good) {
+        out.data.resize(header.size);
+        good = bool(file.read(reinterpret_cast<char*>(out.data.data()), header.size))
+            && file.peek() == std::ifstream::traits_type::eof()
+            && fnv1a(std::string_view(reinterpret_cast<const char*>(out.data.data()), out.data.size()))
+                   == header.checksum;
+    }
+    file.close();
+    if (!good) {
+        MAYAK_LOG_WARN("ProgramCache: " + Path(key) + " is broken, removing it");
+        Remove(key);
+        out = ProgramBinary{};
+        return false;
+    }
+    out.format = header.format;
+    out.compileNs = header.compileNs;
+    return true;
+}
+
+bool mayak::gfx::ProgramBinaryCache::Store(uint64_t key, const ProgramBinary& binary) {
+    if (binary.data.empty()) return false;
+    std::error_code error;
+    fs::create_directories(directory, error);
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.key = key;
+    header.format = binary.format;
+    header.size = uint32_t(binary.data.size());
+    header.checksum = fnv1a(std::string_view(reinterpret_cast<const char*>(binary.data.data()), binary.data.size()));
+    header.compileNs = binary.compileNs;
+
+    std::string path = Path(key);
+    // Per thread, a background warm-up may be writing the same program right now
+    std::string temporary = path + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(binary.data.data()), std::streamsize(binary.data.size()));
+        if (!file) {
+            file.close();
+            fs::remove(temporary, error);
+            return false;
+        }
+    }
+    fs::rename(temporary, path, error);
+    if (error) {
+        fs::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+void mayak::gfx::ProgramBinaryCache::Remove(uint64_t key) {
+    std::error_code error;
+    fs::remove(Path(key), error);
+}
+
+void mayak::gfx::SetProgramCacheDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cacheDirectory = directory;
+    directoryChosen = true;
+}
+
+std::string mayak::gfx::ProgramCacheDirectory() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!directoryChosen) {
+        cacheDirectory = default_directory();
+        directoryChosen = true;
+    }
+    return cacheDirectory;
+}
+
+mayak::gfx::ProgramCacheStats mayak::gfx::ProgramCacheStatistics() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return stats;
+}
+
+GLuint mayak::gfx::BuildProgram(const char* vertexSource, const char* fragmentSource, const std::string& name,
+                                const std::string& defines) {
+    std::string vertex = with_defines(vertexSource, defines);
+    std::string fragment = with_defines(fragmentSource, defines);
+
+    std::string directory = ProgramCacheDirectory();
+    bool cached = !directory.empty() && binaries_supported();
+    ProgramBinaryCache cache(directory);
+    uint64_t key = cached ? ProgramBinaryCache::Key(vertex, fragment, defines, driver_string()) : 0;
+
+    if (cached) {
+        int64_t start = core::time::now_ns();
+        ProgramBinary binary;
+        if (cache.Load(key, binary)) {
+            GLuint program = glCreateProgram();
+            glProgramBinary(program, binary.format, binary.data.data(), GLsizei(binary.data.size()));
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            int64_t loadNs = core::time::now_ns() - start;
+            if (linked) {
+                std::lock_guard<std::mutex> lock(cacheMutex);
+                ++stats.hits;
+                stats.loadNs += loadNs;
+                stats.savedNs += binary.compileNs - loadNs;
+                return program;
+            }
+            // Driver update or another GPU, it's allowed to refuse. Compile and overwrite it
+            MAYAK_LOG_WARN("ProgramCache: driver refused the binary of " + name + ", compiling it");
+            glDeleteProgram(program);
+            cache.Remove(key);
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            ++stats.rejected;
+        }
+    }
+
+    int64_t start = core::time::now_ns();
+    GLuint program = CompileProgram(vertex.c_str(), fragment.c_str(), name, cached);
+    int64_t compileNs = core::time::now_ns() - start;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        ++stats.misses;
+        stats.compileNs += compileNs;
+    }
+    if (!program || !cached) return program;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return program;
+    ProgramBinary binary;
+    binary.data.resize(std::size_t(length));
+    binary.compileNs = compileNs;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &binary.format, binary.data.data());
+    binary.data.resize(std::size_t(written));
+    if (!cache.Store(key, binary))
+        MAYAK_LOG_WARN("ProgramCache: couldn't write " + cache.Path(key));
+    return program;
+}
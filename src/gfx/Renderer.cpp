@@ -1,109 +1,390 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
-#include "utils/Logger.hpp"
+#include "utils/logger.hpp"
 #include "gfx/Renderer.hpp"
+#include "gfx/GLState.hpp"
+#include "gfx/ProgramCache.hpp"
+#include "gfx/ShaderVariants.hpp"
+#include "core/Startup.hpp"
 
 namespace {
+    // Pixels in, uTransform = (2 / width, -2 / height, -1, 1) maps them to clip space
     const char* vertexShaderSource = R"(
         #version 330 core
-        layout (location = 0) in vec3 aPos;
+        layout (location = 0) in vec2 aPos;
+        layout (location = 1) in vec2 aUV;
+        layout (location = 2) in vec4 aColor;
+        layout (location = 3) in uvec2 aLayerClip;
+        uniform vec4 uTransform;
+        out vec2 vUV;
+        out vec4 vColor;
+        out float vLayer;
+        out vec2 vPixel;
+        flat out uint vClip;
         void main() {
-            gl_Position = vec4(aPos, 1.0);
+            vUV = aUV;
+            vColor = aColor;
+            vLayer = float(aLayerClip.x);
+            vClip = aLayerClip.y;
+            vPixel = aPos;
+            gl_Position = vec4(aPos * uTransform.xy + uTransform.zw, 0.0, 1.0);
         }
     )";
 
-    const char* fragmentShaderSource = R"(
+    // Every quad variant, see ShaderFeature for the switches. Only what's defined gets compiled
+    const char* quadFragmentSource = R"(
         #version 330 core
+        in vec2 vUV;
+        in vec4 vColor;
+        in float vLayer;
+        in vec2 vPixel;
+        flat in uint vClip;
+        uniform vec4 uClipRects[64]; // MAX_CLIP_RECTS, the batch's clip stack
+        #if defined(TEXTURE_ARRAY)
+            uniform sampler2DArray uTexture;
+            #define SAMPLE(uv) texture(uTexture, vec3(uv, vLayer))
+        #elif defined(TEXTURED)
+            uniform sampler2D uTexture;
+            #define SAMPLE(uv) texture(uTexture, uv)
+        #endif
+        #ifdef DISTANCE_FIELD
+            uniform vec4 uParams; // outline width, glow width, weight, unused; in field units
+            uniform vec4 uOutlineColor;
+            uniform vec4 uGlowColor;
+        #endif
+        #ifdef GRADIENT
+            uniform vec4 uGradientLine; // from.xy, to.xy, framebuffer pixels
+            uniform vec4 uGradientStart;
+            uniform vec4 uGradientEnd;
+        #endif
+        #ifdef CLIP_MASK
+            uniform sampler2D uClipMask; // coverage in .r
+            uniform vec4 uClipMaskRect;  // where the mask sits, framebuffer pixels
+        #endif
         out vec4 FragColor;
         void main() {
-            FragColor = vec4(0.7f, 0.2f, 0.3f, 1.0f);
+            vec4 color = vColor;
+        #ifdef GRADIENT
+            vec2 axis = uGradientLine.zw - uGradientLine.xy;
+            float t = clamp(dot(vPixel - uGradientLine.xy, axis) / max(dot(axis, axis), 1e-6), 0.0, 1.0);
+            color *= mix(uGradientStart, uGradientEnd, t);
+        #endif
+        #if defined(DISTANCE_FIELD)
+            // The page holds signed distances (0.5 = the outline, more = inside).
+            // fwidth() keeps the edge about a pixel wide at whatever size it's drawn
+            float d = SAMPLE(vUV).a + uParams.z;
+            float w = max(fwidth(d) * 0.5, 1e-4);
+            float edge = 0.5 - uParams.x;
+            float fill = smoothstep(0.5 - w, 0.5 + w, d);
+            float shape = smoothstep(edge - w, edge + w, d);
+            vec4 ring = uParams.x > 0.0 ? uOutlineColor : color;
+            vec4 body = mix(ring, color, fill);
+            body.a *= shape;
+
+            float glow = uParams.y > 0.0 ? smoothstep(edge - uParams.y, edge, d) * uGlowColor.a : 0.0;
+            float under = glow * (1.0 - body.a);
+            float alpha = body.a + under;
+            color = vec4((body.rgb * body.a + uGlowColor.rgb * under) / max(alpha, 1e-4), alpha);
+        #elif defined(TEXTURED) || defined(TEXTURE_ARRAY)
+            color *= SAMPLE(vUV);
+        #endif
+        #ifdef CLIP_MASK
+            color.a *= texture(uClipMask, (vPixel - uClipMaskRect.xy) / uClipMaskRect.zw).r;
+        #endif
+        #ifdef PREMULTIPLIED
+            color.rgb *= color.a;
+        #endif
+            // Same pixels a scissor would keep, but a clip change doesn't end the draw call.
+            // Last, so the derivatives above still see all four pixels of the quad
+            if (vClip != 0u) {
+                vec4 clip = uClipRects[vClip];
+                if (any(lessThan(vPixel, clip.xy)) || any(greaterThanEqual(vPixel, clip.xy + clip.zw))) discard;
+            }
+            FragColor = color;
         }
     )";
 
-    bool CheckCompileErrors(GLuint shader, const std::string& type) {
-        GLint success;
-        GLchar infoLog[1024];
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            MAYAK_LOG_ERROR("Error while compiling " + type + " shader: " + infoLog);
-            return false;
+    // One instance = one rounded rect, the 4 corners come from gl_VertexID.
+    // The quad grows by a pixel on each side so the anti-aliased edge has room.
+    const char* roundedRectVertexSource = R"(
+        #version 330 core
+        layout (location = 0) in vec4 iRect;
+        layout (location = 1) in vec4 iRadii;
+        layout (location = 2) in vec4 iFill;
+        layout (location = 3) in vec4 iBorder;
+        layout (location = 4) in float iBorderWidth;
+        layout (location = 5) in uint iClip;
+        uniform vec4 uTransform;
+        out vec2 vLocal;
+        out vec2 vPixel;
+        flat out vec2 vHalfSize;
+        flat out vec4 vRadii;
+        flat out vec4 vFill;
+        flat out vec4 vBorder;
+        flat out float vBorderWidth;
+        flat out uint vClip;
+        void main() {
+            vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+            vec2 halfSize = iRect.zw * 0.5;
+            vec2 pos = iRect.xy - 1.0 + corner * (iRect.zw + 2.0);
+            vLocal = pos - (iRect.xy + halfSize);
+            vPixel = pos;
+            vHalfSize = halfSize;
+            vRadii = min(iRadii, vec4(min(halfSize.x, halfSize.y)));
+            vFill = iFill;
+            vBorder = iBorder;
+            vBorderWidth = iBorderWidth;
+            vClip = iClip;
+            gl_Position = vec4(pos * uTransform.xy + uTransform.zw, 0.0, 1.0);
         }
-        return true;
-    }
-    bool CheckLinkErrors(GLuint program) {
-        GLint success;
-        GLchar infoLog[1024];
-        glGetProgramiv(program, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(program, 1024, NULL, infoLog);
-            MAYAK_LOG_ERROR(std::string("Error while linking shader program: ") + infoLog);
-            return false;
+    )";
+
+    // Distances are in pixels, so clamp(0.5 - d) is a one pixel wide anti-aliased edge
+    const char* roundedRectFragmentSource = R"(
+        #version 330 core
+        in vec2 vLocal;
+        in vec2 vPixel;
+        flat in vec2 vHalfSize;
+        flat in vec4 vRadii;
+        flat in vec4 vFill;
+        flat in vec4 vBorder;
+        flat in float vBorderWidth;
+        flat in uint vClip;
+        uniform vec4 uClipRects[64]; // MAX_CLIP_RECTS
+        uniform float uMinCoverage;  // 0.5 while it writes a stencil clip, 0 otherwise
+        out vec4 FragColor;
+
+        // Radii are top-left, top-right, bottom-right, bottom-left, y goes down
+        float roundedBox(vec2 p, vec2 halfSize, vec4 radii) {
+            float r = p.x > 0.0 ? (p.y > 0.0 ? radii.z : radii.y) : (p.y > 0.0 ? radii.w : radii.x);
+            vec2 q = abs(p) - halfSize + r;
+            return min(max(q.x, q.y), 0.0) + length(max(q, 0.0)) - r;
+        }
+
+        void main() {
+            float d = roundedBox(vLocal, vHalfSize, vRadii);
+            float outer = clamp(0.5 - d, 0.0, 1.0);
+            float inner = clamp(0.5 - d - vBorderWidth, 0.0, 1.0);
+            // Fill covers inner, the border the ring between, added up premultiplied so a
+            // missing (transparent) border doesn't pull the edge towards black
+            vec4 fill = vec4(vFill.rgb * vFill.a, vFill.a) * inner;
+            vec4 ring = vec4(vBorder.rgb * vBorder.a, vBorder.a) * (outer - inner);
+            vec4 sum = fill + ring;
+            vec4 color = vec4(sum.a > 0.0 ? sum.rgb / sum.a : vec3(0.0), sum.a);
+            if (vClip != 0u) {
+                vec4 clip = uClipRects[vClip];
+                vec2 low = vPixel - clip.xy;
+                vec2 high = clip.xy + clip.zw - vPixel;
+                color.a *= clamp(min(min(low.x, low.y), min(high.x, high.y)) + 0.5, 0.0, 1.0);
+            }
+            if (color.a <= 0.0 || color.a < uMinCoverage) discard;
+            FragColor = color;
+        }
+    )";
+
+    std::atomic<uint64_t> nextContextId{1};
+
+    // Loaded contexts by id, so deferred warm-ups don't touch one that got destroyed. Main thread only
+    std::unordered_map<uint64_t, mayak::gfx::ShaderVariants*> liveShaders;
+
+    // What the first frame rarely needs: distance field text and the custom-feature quads
+    const std::vector<uint32_t> DEFERRED_VARIANTS = {
+        mayak::gfx::FEATURE_DISTANCE_FIELD,
+        mayak::gfx::FEATURE_GRADIENT,
+        mayak::gfx::FEATURE_CLIP_MASK,
+        mayak::gfx::FEATURE_TEXTURED | mayak::gfx::FEATURE_CLIP_MASK,
+        mayak::gfx::FEATURE_TEXTURE_ARRAY | mayak::gfx::FEATURE_CLIP_MASK,
+    };
+
+    // VAO slots in GLState::ContextObject(), two per RendererContext
+    uint64_t quad_vao_key(const mayak::gfx::RendererContext& ctx) { return ctx.id * 2; }
+    uint64_t rounded_rect_vao_key(const mayak::gfx::RendererContext& ctx) { return ctx.id * 2 + 1; }
+
+    bool CreateBuffers(mayak::gfx::RendererContext& ctx) {
+        using namespace mayak::gfx;
+
+        // Same pattern for every quad, so it's uploaded once and never touched again
+        std::vector<uint16_t> indices(MAX_BATCH_QUADS * 6);
+        for (int quad = 0; quad < MAX_BATCH_QUADS; ++quad) {
+            uint16_t base = uint16_t(quad * 4);
+            uint16_t* out = &indices[quad * 6];
+            out[0] = base; out[1] = base + 1; out[2] = base + 2;
+            out[3] = base + 2; out[4] = base + 3; out[5] = base;
         }
+        glGenBuffers(1, &ctx.indexBuffer);
+        // Element buffer binds go into whatever VAO is bound, don't mess up someone else's
+        State().BindVertexArray(0);
+        State().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
+
+        // One partition fits a full batch of both kinds, the GPU can be two flushes behind without a stall
+        GLsizeiptr partition = MAX_BATCH_QUADS * (4 * sizeof(QuadVertex) + sizeof(RoundedRectInstance));
+        if (!ctx.vertexStream.Create(GL_ARRAY_BUFFER, partition))
+            return false;
+
+        const uint32_t white = 0xffffffffu;
+        glGenTextures(1, &ctx.whiteTexture);
+        State().BindTexture(0, GL_TEXTURE_2D, ctx.whiteTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         return true;
     }
-
 }
 
 /// @brief Compiles and links shaders, stores shaderProgram in given ctx.
 ///
-/// Compiles and links vertex and fragment shaders.
-/// Stores the resulting shader program in the given renderer context.
-/// This is a barebones setup w/o VAO/VBO, but they're planned.
+/// Compiles and links the quad and rounded rect shaders (or loads them from the
+/// program binary cache, see BuildProgram()), and makes the buffers the batch
+/// streams into (VAOs are per context, see VertexArray()). The distance field
+/// program and the custom-feature variants get warmed on a background context
+/// once the first frame is out (startup::defer()), or compiled on first use.
 ///
-/// @param ctx Renderer context, saves shaderProgram (someday VAO, VBO, etc.)
+/// @param ctx Renderer context, saves both programs, buffers and the white texture
 /// @return True if shaders compiled and linked successfully, false otherwise.
 /// @see mayak::gfx::RendererContext
 bool mayak::gfx::LoadShaders(RendererContext& ctx) {
-    // Compile vertex shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-    glCompileShader(vertexShader);
-    
-    // Check for compile errors
-    if (!CheckCompileErrors(vertexShader, "vertex shader")) {
-        glDeleteShader(vertexShader);
+    mayak::core::startup::Scope phase("shaders");
+    ProgramCacheStats before = ProgramCacheStatistics();
+
+    // The batch's three programs are quad variants, everything else asks ctx.quadShaders
+    ctx.quadShaders = std::make_unique<ShaderVariants>(vertexShaderSource, quadFragmentSource, "quad");
+    ctx.shaderProgram = ctx.quadShaders->Get(FEATURE_TEXTURED);
+    if (!ctx.shaderProgram) {
+        ctx.quadShaders.reset();
         return false;
     }
 
-    // Compile fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    // Check for compile errors
-    if (!CheckCompileErrors(fragmentShader, "fragment shader")) {
-        glDeleteShader(fragmentShader);
+    ctx.roundedRectProgram = BuildProgram(roundedRectVertexSource, roundedRectFragmentSource, "rounded rect");
+    ctx.atlasProgram = ctx.quadShaders->Get(FEATURE_TEXTURE_ARRAY);
+    if (!ctx.roundedRectProgram || !ctx.atlasProgram) {
+        if (ctx.roundedRectProgram) glDeleteProgram(ctx.roundedRectProgram);
+        ctx.quadShaders->Destroy();
+        ctx.quadShaders.reset();
+        ctx.shaderProgram = ctx.roundedRectProgram = ctx.atlasProgram = ctx.distanceFieldProgram = 0;
         return false;
     }
 
-    // Link shaders
-    ctx.shaderProgram = glCreateProgram();
-    glAttachShader(ctx.shaderProgram, vertexShader);
-    glAttachShader(ctx.shaderProgram, fragmentShader);
-    glLinkProgram(ctx.shaderProgram);
+    ctx.transformLocation = glGetUniformLocation(ctx.shaderProgram, "uTransform");
+    ctx.roundedRectTransformLocation = glGetUniformLocation(ctx.roundedRectProgram, "uTransform");
+    ctx.atlasTransformLocation = glGetUniformLocation(ctx.atlasProgram, "uTransform");
+    ctx.clipRectsLocation = glGetUniformLocation(ctx.roundedRectProgram, "uClipRects");
+    ctx.roundedRectMinCoverageLocation = glGetUniformLocation(ctx.roundedRectProgram, "uMinCoverage");
+    ctx.id = nextContextId++;
 
-    if (!CheckLinkErrors(ctx.shaderProgram)) {
-        glDeleteProgram(ctx.shaderProgram);
-        return false;
-    }
+    liveShaders[ctx.id] = ctx.quadShaders.get();
+    uint64_t id = ctx.id;
+    mayak::core::startup::defer([id] {
+        auto found = liveShaders.find(id);
+        if (found != liveShaders.end()) found->second->Warm(DEFERRED_VARIANTS);
+    });
 
-    // Delete shaders
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    ProgramCacheStats after = ProgramCacheStatistics();
+    char summary[160];
+    std::snprintf(summary, sizeof(summary), "Shaders: %llu from the binary cache, %llu compiled, %.2f ms saved",
+                  static_cast<unsigned long long>(after.hits - before.hits),
+                  static_cast<unsigned long long>(after.misses - before.misses),
+                  (after.savedNs - before.savedNs) * 1e-6);
+    MAYAK_LOG_INFO(summary);
+    return CreateBuffers(ctx);
+}
 
+bool mayak::gfx::LoadDistanceFieldProgram(RendererContext& ctx) {
+    if (ctx.distanceFieldProgram) return true;
+    if (!ctx.quadShaders) return false;
+    // Free if the warm-up got to it already
+    ctx.distanceFieldProgram = ctx.quadShaders->Get(FEATURE_DISTANCE_FIELD);
+    if (!ctx.distanceFieldProgram) return false;
+    ctx.distanceFieldTransformLocation = glGetUniformLocation(ctx.distanceFieldProgram, "uTransform");
+    ctx.distanceFieldParamsLocation = glGetUniformLocation(ctx.distanceFieldProgram, "uParams");
+    ctx.distanceFieldOutlineLocation = glGetUniformLocation(ctx.distanceFieldProgram, "uOutlineColor");
+    ctx.distanceFieldGlowLocation = glGetUniformLocation(ctx.distanceFieldProgram, "uGlowColor");
     return true;
 }
 
 void mayak::gfx::Use(const RendererContext& ctx) {
-    glUseProgram(ctx.shaderProgram);
+    // Goes through the shadow, switching to the program that's already in use is free
+    State().UseProgram(ctx.shaderProgram);
+}
+
+GLuint mayak::gfx::VertexArray(const RendererContext& ctx) {
+    GLuint& vao = State().ContextObject(quad_vao_key(ctx));
+    if (vao) return vao;
+
+    glGenVertexArrays(1, &vao);
+    State().BindVertexArray(vao);
+    State().BindBuffer(GL_ARRAY_BUFFER, ctx.vertexStream.Buffer());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ctx.indexBuffer); // goes into the VAO, not the shadow
+
+    const GLsizei stride = sizeof(QuadVertex);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadVertex, x));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadVertex, u));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(QuadVertex, color));
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 2, GL_UNSIGNED_SHORT, stride, (void*)offsetof(QuadVertex, layer));
+    return vao;
+}
+
+GLuint mayak::gfx::RoundedRectVertexArray(const RendererContext& ctx, GLintptr instanceOffset) {
+    GLuint& vao = State().ContextObject(rounded_rect_vao_key(ctx));
+    bool created = !vao;
+    if (created) glGenVertexArrays(1, &vao);
+    State().BindVertexArray(vao);
+    State().BindBuffer(GL_ARRAY_BUFFER, ctx.vertexStream.Buffer());
+
+    // The instances sit somewhere else in the ring every flush, so the pointers get redone each time.
+    // Enabling and divisors are VAO state, those only once
+    const GLsizei stride = sizeof(RoundedRectInstance);
+    auto at = [instanceOffset](size_t member) { return (void*)(instanceOffset + GLintptr(member)); };
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, stride, at(offsetof(RoundedRectInstance, x)));
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, at(offsetof(RoundedRectInstance, radii)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, at(offsetof(RoundedRectInstance, fill)));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, at(offsetof(RoundedRectInstance, border)));
+    glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride, at(offsetof(RoundedRectInstance, borderWidth)));
+    glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, stride, at(offsetof(RoundedRectInstance, clipId)));
+
+    if (created) {
+        for (GLuint attribute = 0; attribute < 6; ++attribute) {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribDivisor(attribute, 1);
+        }
+    }
+    return vao;
 }
 
 void mayak::gfx::Destroy(RendererContext& ctx) {
-    if (ctx.shaderProgram) {
-        glDeleteProgram(ctx.shaderProgram);
-        ctx.shaderProgram = 0;
+    if (ctx.roundedRectProgram) {
+        ForgetSharedProgram(ctx.roundedRectProgram);
+        glDeleteProgram(ctx.roundedRectProgram);
+    }
+    // The quad programs are variants, they go with the rest of them
+    liveShaders.erase(ctx.id);
+    if (ctx.quadShaders) ctx.quadShaders->Destroy();
+    ctx.quadShaders.reset();
+    ctx.shaderProgram = ctx.roundedRectProgram = ctx.atlasProgram = ctx.distanceFieldProgram = 0;
+    // Only the current context's VAOs can be deleted from here, the rest go with their contexts
+    for (uint64_t key : { quad_vao_key(ctx), rounded_rect_vao_key(ctx) }) {
+        if (GLuint vao = State().ContextObject(key)) {
+            State().ForgetVertexArray(vao);
+            glDeleteVertexArrays(1, &vao);
+        }
+        State().ForgetContextObject(key);
     }
+    ctx.vertexStream.Destroy();
+    ForgetSharedBuffer(ctx.indexBuffer);
+    glDeleteBuffers(1, &ctx.indexBuffer);
+    ForgetSharedTexture(ctx.whiteTexture);
+    glDeleteTextures(1, &ctx.whiteTexture);
+    ctx = RendererContext{};
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "gfx/ScaleCache.hpp"
+#include "core/Mainloop.hpp"
+#include "core/Window.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+mayak::gfx::ScaleBucket mayak::gfx::ScaleToBucket(float scale) {
+    int bucket = static_cast<int>(std::lround(scale * 4.0f));
+    return static_cast<ScaleBucket>(std::max(bucket, 1));
+}
+
+float mayak::gfx::BucketToScale(ScaleBucket bucket) {
+    return bucket / 4.0f;
+}
+
+mayak::gfx::ScaleCache::ScaleCache(RasterizeFn rasterize, ReleaseFn release)
+    : rasterize(std::move(rasterize)), release(std::move(release)) {}
+
+mayak::gfx::ScaleCache::~ScaleCache() {
+    Clear();
+}
+
+const mayak::gfx::ScaledResource& mayak::gfx::ScaleCache::Get(uint64_t key, float scale) {
+    ScaleBucket bucket = ScaleToBucket(scale);
+    uint64_t frame = core::frame_count();
+
+    auto it = entries.find(Key{key, bucket});
+    if (it != entries.end()) {
+        ++hits;
+        it->second.lastUsedFrame = frame;
+        return it->second.resource;
+    }
+
+    ++misses;
+    // Rasterize at the bucket's scale, so everything in a bucket looks the same
+    Entry entry;
+    entry.resource = rasterize(key, BucketToScale(bucket));
+    entry.lastUsedFrame = frame;
+    bytesUsed += entry.resource.bytes;
+    bucketBytes[bucket] += entry.resource.bytes;
+    return entries.emplace(Key{key, bucket}, entry).first->second.resource;
+}
+
+void mayak::gfx::ScaleCache::Release(Entry& entry, ScaleBucket bucket) {
+    bytesUsed -= entry.resource.bytes;
+    bucketBytes[bucket] -= entry.resource.bytes;
+    if (release) release(entry.resource);
+}
+
+void mayak::gfx::ScaleCache::RetainScales(const std::vector<ScaleBucket>& active) {
+    std::size_t before = bytesUsed;
+    for (auto it = entries.begin(); it != entries.end();) {
+        ScaleBucket bucket = it->first.bucket;
+        if (std::find(active.begin(), active.end(), bucket) != active.end()) {
+            ++it;
+            continue;
+        }
+        Release(it->second, bucket);
+        it = entries.erase(it);
+    }
+    for (auto it = bucketBytes.begin(); it != bucketBytes.end();) {
+        if (it->second == 0) it = bucketBytes.erase(it);
+        else ++it;
+    }
+    if (before != bytesUsed)
+        MAYAK_LOG_DEBUG("Scale cache released " + std::to_string((before - bytesUsed) / 1024) + " KiB of unused scales");
+}
+
+void mayak::gfx::ScaleCache::SyncWithWindows() {
+    const auto& open = core::windows();
+    if (open.empty()) return; // no windows says nothing about which scales we'll need
+    std::vector<ScaleBucket> active;
+    // The ratio drawing multiplies by, the content scale can say 2 while X11 / Windows draw at 1
+    for (auto* window : open) active.push_back(ScaleToBucket(window->GetPixelRatio().x));
+    RetainScales(active);
+}
+
+void mayak::gfx::ScaleCache::Trim(std::size_t budgetBytes) {
+    if (bytesUsed <= budgetBytes) return;
+
+    uint64_t frame = core::frame_count();
+    std::vector<std::pair<uint64_t, Key>> candidates;
+    for (auto& [key, entry] : entries)
+        if (entry.lastUsedFrame != frame) candidates.emplace_back(entry.lastUsedFrame, key);
+    std::sort(candidates.begin(), candidates.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (auto& [lastUsed, key] : candidates) {
+        if (bytesUsed <= budgetBytes) break;
+        auto it = entries.find(key);
+        Release(it->second, key.bucket);
+        entries.erase(it);
+    }
+}
+
+void mayak::gfx::ScaleCache::Clear() {
+    for (auto& [key, entry] : entries) Release(entry, key.bucket);
+    entries.clear();
+    bucketBytes.clear();
+}
+
+std::size_t mayak::gfx::ScaleCache::BytesAt(ScaleBucket bucket) const {
+    auto it = bucketBytes.find(bucket);
+    return it == bucketBytes.end() ? 0 : it->second;
+}
@@ -0,0 +1,330 @@
+#include "gfx/SdfText.hpp"
+#include "gfx/Batch.hpp"
+#include "core/Mainloop.hpp"
+#include "core/Time.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+namespace {
+    constexpr float FAR = 1e20f;
+
+    // Squared distance to the nearest seed (f == 0) along one line, Felzenszwalb-Huttenlocher.
+    // v and z are scratch, n and n + 1 long
+    void edt_1d(const float* f, float* d, int n, int* v, float* z) {
+        const float infinity = std::numeric_limits<float>::infinity();
+        auto intersection = [f](int q, int p) {
+            return ((f[q] + float(q) * q) - (f[p] + float(p) * p)) / (2.0f * (q - p));
+        };
+        int k = 0;
+        v[0] = 0;
+        z[0] = -infinity;
+        z[1] = infinity;
+        for (int q = 1; q < n; ++q) {
+            // Lower envelope of parabolas, drop the ones the new one hides
+            float s = intersection(q, v[k]);
+            while (s <= z[k]) {
+                --k;
+                s = intersection(q, v[k]);
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = infinity;
+        }
+        k = 0;
+        for (int q = 0; q < n; ++q) {
+            while (z[k + 1] < q) ++k;
+            float dx = float(q - v[k]);
+            d[q] = dx * dx + f[v[k]];
+        }
+    }
+
+    // In place: seeds are 0, the rest FAR, afterwards squared distances to the nearest seed
+    void edt_2d(std::vector<float>& grid, int width, int height) {
+        int longest = std::max(width, height);
+        std::vector<float> line(longest), out(longest), z(longest + 1);
+        std::vector<int> v(longest);
+        for (int x = 0; x < width; ++x) {
+            for (int y = 0; y < height; ++y) line[y] = grid[std::size_t(y) * width + x];
+            edt_1d(line.data(), out.data(), height, v.data(), z.data());
+            for (int y = 0; y < height; ++y) grid[std::size_t(y) * width + x] = out[y];
+        }
+        for (int y = 0; y < height; ++y) {
+            float* row = &grid[std::size_t(y) * width];
+            edt_1d(row, out.data(), width, v.data(), z.data());
+            std::copy(out.begin(), out.begin() + width, row);
+        }
+    }
+}
+
+void mayak::gfx::BuildDistanceField(const GlyphBitmap& coverage, int oversample, int spread, GlyphBitmap& out) {
+    oversample = std::max(oversample, 1);
+    spread = std::max(spread, 1);
+    out.width = (coverage.width + oversample - 1) / oversample + 2 * spread;
+    out.height = (coverage.height + oversample - 1) / oversample + 2 * spread;
+
+    // The oversampled grid, glyph in the middle, big enough to average down evenly
+    int width = out.width * oversample, height = out.height * oversample;
+    int margin = spread * oversample;
+    std::vector<uint8_t> inside(std::size_t(width) * height, 0);
+    for (int y = 0; y < coverage.height; ++y)
+        for (int x = 0; x < coverage.width; ++x)
+            inside[std::size_t(y + margin) * width + x + margin] =
+                coverage.pixels[std::size_t(y) * coverage.width + x] >= 128;
+
+    // Distance to the nearest inside pixel, and to the nearest outside one
+    std::vector<float> toInside(inside.size()), toOutside(inside.size());
+    for (std::size_t i = 0; i < inside.size(); ++i) {
+        toInside[i] = inside[i] ? 0 : FAR;
+        toOutside[i] = inside[i] ? FAR : 0;
+    }
+    edt_2d(toInside, width, height);
+    edt_2d(toOutside, width, height);
+
+    // Pixel centers are half a pixel away from the edge between them
+    std::vector<float> signedDistance(inside.size());
+    for (std::size_t i = 0; i < inside.size(); ++i)
+        signedDistance[i] = inside[i] ? std::sqrt(toOutside[i]) - 0.5f : 0.5f - std::sqrt(toInside[i]);
+
+    out.pixels.resize(std::size_t(out.width) * out.height);
+    float toReference = 1.0f / (float(oversample) * oversample * oversample); // average, then oversampled -> reference px
+    for (int oy = 0; oy < out.height; ++oy) {
+        for (int ox = 0; ox < out.width; ++ox) {
+            float sum = 0;
+            for (int sy = 0; sy < oversample; ++sy) {
+                const float* row = &signedDistance[std::size_t(oy * oversample + sy) * width + ox * oversample];
+                for (int sx = 0; sx < oversample; ++sx) sum += row[sx];
+            }
+            float value = 0.5f + sum * toReference / (2.0f * spread);
+            out.pixels[std::size_t(oy) * out.width + ox] = uint8_t(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+}
+
+mayak::gfx::SdfGlyphCache::SdfGlyphCache(GlyphRasterizer& rasterizer, const SdfOptions& options,
+                                         core::JobSystem* jobs)
+    : rasterizer(rasterizer), options(options), jobs(jobs ? *jobs : core::job_system()), atlas([&] {
+          AtlasOptions atlasOptions = options.atlas;
+          atlasOptions.internalFormat = GL_R8;
+          return atlasOptions;
+      }()) {}
+
+mayak::gfx::SdfGlyphCache::~SdfGlyphCache() {
+    // The jobs hold `this`
+    jobs.Wait(inFlight);
+}
+
+const mayak::gfx::SdfGlyph* mayak::gfx::SdfGlyphCache::Get(FontId font, uint32_t codepoint) {
+    uint64_t key = MakeKey(font, codepoint);
+    auto [it, added] = glyphs.try_emplace(key);
+    SdfGlyph& glyph = it->second;
+    if (added) {
+        Queue(glyph, key);
+        return nullptr;
+    }
+    if (!glyph.ready) return nullptr;
+    ++stats.hits;
+    if (!glyph.drawable) return &glyph;
+
+    uint64_t frame = core::frame_count();
+    if (glyph.atlasGeneration != atlas.Generation()) {
+        const AtlasRegion* region = atlas.Find(key);
+        if (!region) {
+            // Evicted, the field is gone with it
+            ++stats.regenerated;
+            Queue(glyph, key);
+            return nullptr;
+        }
+        glyph.region = *region;
+        glyph.atlasGeneration = atlas.Generation();
+        glyph.lastUsedFrame = frame;
+    } else if (glyph.lastUsedFrame != frame) {
+        atlas.Find(key);
+        glyph.lastUsedFrame = frame;
+    }
+    return &glyph;
+}
+
+void mayak::gfx::SdfGlyphCache::Queue(SdfGlyph& glyph, uint64_t key) {
+    glyph.ready = false;
+    ++pending;
+    ++stats.queued;
+    inFlight.push_back(jobs.Run([this, key] {
+        Finished result = Generate(key);
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finished.push_back(std::move(result));
+        anyFinished.store(true, std::memory_order_release);
+    }));
+}
+
+mayak::gfx::SdfGlyphCache::Finished mayak::gfx::SdfGlyphCache::Generate(uint64_t key) const {
+    int64_t start = core::time::now_ns();
+    Finished result{key, {}, 0, 0, 0, 0};
+    int oversample = std::max(options.oversample, 1);
+
+    GlyphBitmap coverage;
+    bool found;
+    {
+        std::lock_guard<std::mutex> lock(rasterizerMutex);
+        found = rasterizer.Rasterize(FontId(key >> 21), options.referenceSize * oversample,
+                                     uint32_t(key & 0x1FFFFF), 0, coverage);
+    }
+    result.advance = coverage.advance / oversample;
+    if (found && coverage.width > 0 && coverage.height > 0) {
+        BuildDistanceField(coverage, oversample, options.spread, result.field);
+        result.bearingX = float(coverage.bearingX) / oversample - options.spread;
+        result.bearingY = float(coverage.bearingY) / oversample + options.spread;
+    }
+    result.ns = uint64_t(core::time::now_ns() - start);
+    return result;
+}
+
+int mayak::gfx::SdfGlyphCache::Update() {
+    uint64_t frame = core::frame_count();
+    // The atlas makes the room it refused between frames, so those go again once per frame
+    bool retry = !waitingForRoom.empty() && frame != refusedFrame;
+    if (!retry && !anyFinished.load(std::memory_order_acquire)) return 0;
+
+    std::vector<Finished> batch;
+    if (retry) batch.swap(waitingForRoom);
+    if (anyFinished.load(std::memory_order_acquire)) {
+        {
+            std::lock_guard<std::mutex> lock(finishedMutex);
+            std::move(finished.begin(), finished.end(), std::back_inserter(batch));
+            finished.clear();
+            anyFinished.store(false, std::memory_order_relaxed);
+        }
+        inFlight.erase(std::remove_if(inFlight.begin(), inFlight.end(),
+                                      [](const core::JobHandle& job) { return job.Done(); }),
+                       inFlight.end());
+    }
+
+    int ready = 0;
+    for (Finished& result : batch) {
+        --pending;
+        stats.generateNs += result.ns;
+        auto it = glyphs.find(result.key);
+        if (it == glyphs.end() || it->second.ready) continue;
+
+        const AtlasRegion* region = nullptr;
+        if (!result.field.pixels.empty()) {
+            region = atlas.Insert(result.key, result.field.width, result.field.height, result.field.pixels.data());
+            if (!region && atlas.CanHold(result.field.width, result.field.height)) {
+                // Earlier text of this frame is batched already, the atlas won't move it to make room
+                ++pending;
+                result.ns = 0;
+                refusedFrame = frame;
+                waitingForRoom.push_back(std::move(result));
+                continue;
+            }
+        }
+
+        SdfGlyph& glyph = it->second;
+        glyph.advance = result.advance;
+        glyph.bearingX = result.bearingX;
+        glyph.bearingY = result.bearingY;
+        glyph.drawable = false;
+        glyph.ready = true;
+        ++ready;
+        if (!region) continue;
+
+        ++stats.uploaded;
+        glyph.region = *region;
+        glyph.width = float(result.field.width);
+        glyph.height = float(result.field.height);
+        glyph.drawable = true;
+        glyph.atlasGeneration = atlas.Generation();
+    }
+    return ready;
+}
+
+void mayak::gfx::SdfGlyphCache::WaitIdle() {
+    jobs.Wait(inFlight);
+    Update();
+}
+
+void mayak::gfx::SdfGlyphCache::Prefetch(FontId font, std::string_view text) {
+    for (std::size_t offset = 0; offset < text.size();) {
+        uint32_t codepoint = DecodeUtf8(text, offset);
+        if (codepoint != '\n') Get(font, codepoint);
+    }
+}
+
+mayak::gfx::FontMetrics mayak::gfx::SdfGlyphCache::Metrics(FontId font, float size) {
+    auto it = metrics.find(font);
+    if (it == metrics.end()) {
+        std::lock_guard<std::mutex> lock(rasterizerMutex);
+        it = metrics.emplace(font, rasterizer.Metrics(font, options.referenceSize)).first;
+    }
+    float scale = size / options.referenceSize;
+    return FontMetrics{it->second.ascent * scale, it->second.descent * scale, it->second.lineGap * scale};
+}
+
+template <typename Place>
+float mayak::gfx::SdfGlyphCache::Layout(FontId font, float size, float x, float baseline, std::string_view text,
+                                        Place&& place) {
+    float scale = size / options.referenceSize;
+    float penX = x, lineY = baseline, widest = 0;
+    float lineHeight = -1;
+
+    for (std::size_t offset = 0; offset < text.size();) {
+        uint32_t codepoint = DecodeUtf8(text, offset);
+        if (codepoint == '\n') {
+            if (lineHeight < 0) lineHeight = Metrics(font, size).LineHeight();
+            widest = std::max(widest, penX - x);
+            penX = x;
+            lineY += lineHeight;
+            continue;
+        }
+        const SdfGlyph* glyph = Get(font, codepoint);
+        if (!glyph) {
+            ++stats.skippedDraws;
+            continue;
+        }
+        // No pixel snapping, the whole point is smooth scaling
+        if (glyph->drawable) place(*glyph, penX + glyph->bearingX * scale, lineY - glyph->bearingY * scale, scale);
+        penX += glyph->advance * scale;
+    }
+    return std::max(widest, penX - x);
+}
+
+float mayak::gfx::SdfGlyphCache::DrawText(QuadBatch& batch, FontId font, float size, float x, float baseline,
+                                          std::string_view text, uint32_t color, const SdfTextStyle& style) {
+    Update();
+
+    // Pixels at this size -> field units, 0.5 of those is the whole spread
+    float toField = options.referenceSize / (std::max(size, 1e-3f) * 2.0f * options.spread);
+    DistanceFieldStyle field;
+    field.outlineWidth = std::clamp(style.outline * toField, 0.0f, 0.5f);
+    field.outlineColor = style.outlineColor;
+    field.glowWidth = std::clamp(style.glow * toField, 0.0f, 0.5f - field.outlineWidth);
+    field.glowColor = style.glowColor;
+    field.weight = std::clamp(style.weight * toField, -0.5f, 0.5f);
+    batch.SetDistanceFieldStyle(field);
+
+    return Layout(font, size, x, baseline, text, [&](const SdfGlyph& glyph, float left, float top, float scale) {
+        batch.DrawDistanceFieldRect(left, top, glyph.width * scale, glyph.height * scale, atlas, glyph.region, color);
+    });
+}
+
+float mayak::gfx::SdfGlyphCache::MeasureText(FontId font, float size, std::string_view text) {
+    return Layout(font, size, 0, 0, text, [](const SdfGlyph&, float, float, float) {});
+}
+
+void mayak::gfx::SdfGlyphCache::Clear() {
+    // Results of old jobs would land in the new table otherwise
+    jobs.Wait(inFlight);
+    inFlight.clear();
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finished.clear();
+        anyFinished.store(false);
+    }
+    waitingForRoom.clear();
+    pending = 0;
+    glyphs.clear();
+    atlas.Clear();
+}
@@ -0,0 +1,181 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "gfx/ShaderVariants.hpp"
+#include "gfx/GLState.hpp"
+#include "gfx/ProgramCache.hpp"
+#include "core/Init.hpp"
+#include "core/Mainloop.hpp"
+#include "core/Window.hpp"
+#include "utils/logger.hpp"
+
+namespace {
+    struct FeatureName {
+        uint32_t bit;
+        const char* define;
+    };
+
+    constexpr FeatureName FEATURE_NAMES[] = {
+        { mayak::gfx::FEATURE_TEXTURED, "TEXTURED" },
+        { mayak::gfx::FEATURE_TEXTURE_ARRAY, "TEXTURE_ARRAY" },
+        { mayak::gfx::FEATURE_DISTANCE_FIELD, "DISTANCE_FIELD" },
+        { mayak::gfx::FEATURE_GRADIENT, "GRADIENT" },
+        { mayak::gfx::FEATURE_CLIP_MASK, "CLIP_MASK" },
+        { mayak::gfx::FEATURE_PREMULTIPLIED, "PREMULTIPLIED" },
+    };
+    static_assert(sizeof(FEATURE_NAMES) / sizeof(FEATURE_NAMES[0]) == mayak::gfx::SHADER_FEATURE_COUNT,
+                  "every feature needs its define");
+
+    // Samplers default to unit 0, the mask goes on 1
+    void bind_clip_mask_unit(GLuint program) {
+        GLint location = glGetUniformLocation(program, "uClipMask");
+        if (location >= 0) glUniform1i(location, 1);
+    }
+}
+
+mayak::gfx::ShaderVariants::ShaderVariants(const char* vertexSource, const char* fragmentSource, std::string name)
+    : vertexSource(vertexSource), fragmentSource(fragmentSource), name(std::move(name)) {
+    for (auto& program : programs) program.store(0, std::memory_order_relaxed);
+}
+
+mayak::gfx::ShaderVariants::~ShaderVariants() {
+    WaitWarm();
+}
+
+uint32_t mayak::gfx::ShaderVariants::Normalize(uint32_t features) {
+    features &= SHADER_VARIANT_COUNT - 1;
+    if (features & FEATURE_DISTANCE_FIELD) features |= FEATURE_TEXTURE_ARRAY;
+    if (features & FEATURE_TEXTURE_ARRAY) features &= ~uint32_t(FEATURE_TEXTURED);
+    return features;
+}
+
+std::string mayak::gfx::ShaderVariants::Defines(uint32_t features) {
+    features = Normalize(features);
+    std::string defines;
+    for (const FeatureName& feature : FEATURE_NAMES) {
+        if (features & feature.bit) defines += std::string("#define ") + feature.define + " 1\n";
+    }
+    return defines;
+}
+
+bool mayak::gfx::ShaderVariants::Ready(uint32_t features) const {
+    return programs[Normalize(features)].load(std::memory_order_acquire) != 0;
+}
+
+int mayak::gfx::ShaderVariants::Count() const {
+    int count = 0;
+    for (const auto& program : programs) count += program.load(std::memory_order_relaxed) != 0;
+    return count;
+}
+
+bool mayak::gfx::ShaderVariants::Contains(GLuint program) const {
+    if (!program) return false;
+    for (const auto& variant : programs)
+        if (variant.load(std::memory_order_relaxed) == program) return true;
+    return false;
+}
+
+bool mayak::gfx::ShaderVariants::Premultiplied(GLuint program) const {
+    if (!program) return false;
+    for (uint32_t features = 0; features < SHADER_VARIANT_COUNT; ++features)
+        if ((features & FEATURE_PREMULTIPLIED) && programs[features].load(std::memory_order_relaxed) == program)
+            return true;
+    return false;
+}
+
+GLuint mayak::gfx::ShaderVariants::Get(uint32_t features) {
+    features = Normalize(features);
+    if (GLuint program = programs[features].load(std::memory_order_acquire)) return program;
+    return Compile(features, true);
+}
+
+GLuint mayak::gfx::ShaderVariants::Compile(uint32_t features, bool onMainContext) {
+    std::string defines = Defines(features);
+    GLuint program = BuildProgram(vertexSource, fragmentSource, name + " [" + std::to_string(features) + "]", defines);
+    if (!program) return 0;
+
+    if (features & FEATURE_CLIP_MASK) {
+        if (onMainContext) {
+            State().UseProgram(program);
+            bind_clip_mask_unit(program);
+        } else {
+            // The warm-up context is private, no shadow to keep honest
+            glUseProgram(program);
+            bind_clip_mask_unit(program);
+            glUseProgram(0);
+        }
+    }
+    if (!onMainContext) return program; // the warm-up publishes after glFinish()
+
+    GLuint expected = 0;
+    if (!programs[features].compare_exchange_strong(expected, program, std::memory_order_acq_rel)) {
+        // The warm-up got there first, keep its copy
+        ForgetSharedProgram(program);
+        glDeleteProgram(program);
+        return expected;
+    }
+    return program;
+}
+
+bool mayak::gfx::ShaderVariants::Warm(const std::vector<uint32_t>& variants) {
+    GLFWwindow* share = core::shared_context();
+    if (!share || warming) return false;
+    WaitWarm(); // the last one is done, its thread still wants joining
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* context = glfwCreateWindow(1, 1, "mayak shader warm-up", nullptr, share);
+    core::_apply_window_hints(); // back to what every other window gets
+    if (!context) {
+        MAYAK_LOG_WARN("ShaderVariants: couldn't make a warm-up context, variants compile on first use");
+        return false;
+    }
+
+    // Whoever comes first destroys it: the posted task, or WaitWarm() if the loop never runs it
+    auto leftover = std::make_shared<std::atomic<GLFWwindow*>>(context);
+    warmContext = leftover;
+    warming = true;
+    warmThread = std::thread([this, context, leftover, variants] {
+        glfwMakeContextCurrent(context);
+        std::vector<std::pair<uint32_t, GLuint>> compiled;
+        for (uint32_t features : variants) {
+            features = Normalize(features);
+            if (Ready(features)) continue;
+            bool duplicate = false;
+            for (const auto& done : compiled) duplicate |= done.first == features;
+            if (duplicate) continue;
+            if (GLuint program = Compile(features, false)) compiled.emplace_back(features, program);
+        }
+        // Other contexts only see finished objects
+        glFinish();
+        for (const auto& [features, program] : compiled) {
+            GLuint expected = 0;
+            if (!programs[features].compare_exchange_strong(expected, program, std::memory_order_acq_rel))
+                glDeleteProgram(program);
+        }
+        MAYAK_LOG_DEBUG("ShaderVariants: warmed " + std::to_string(compiled.size()) + " variants of " + name);
+        glfwMakeContextCurrent(nullptr);
+        // Windows get destroyed on the main thread only
+        core::post_task([leftover] {
+            if (GLFWwindow* context = leftover->exchange(nullptr)) glfwDestroyWindow(context);
+        });
+        warming = false;
+    });
+    return true;
+}
+
+void mayak::gfx::ShaderVariants::WaitWarm() {
+    if (warmThread.joinable()) warmThread.join();
+    if (!warmContext) return;
+    if (GLFWwindow* context = warmContext->exchange(nullptr)) glfwDestroyWindow(context);
+    warmContext.reset();
+}
+
+void mayak::gfx::ShaderVariants::Destroy() {
+    WaitWarm();
+    for (auto& slot : programs) {
+        GLuint program = slot.exchange(0);
+        if (!program) continue;
+        ForgetSharedProgram(program);
+        glDeleteProgram(program);
+    }
+}
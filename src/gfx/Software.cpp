@@ -0,0 +1,490 @@
+#include <glad/glad.h>
+
+#include "gfx/Software.hpp"
+#include "gfx/GLState.hpp"
+#include "core/Jobs.hpp"
+#include "utils/logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MAYAK_SOFTWARE_SSE2 1
+#include <emmintrin.h>
+// GCC and Clang build single functions for AVX2 and pick at runtime, MSVC only with /arch:AVX2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MAYAK_SOFTWARE_AVX2 1
+#define MAYAK_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+namespace {
+    using mayak::gfx::ClipRect;
+
+    uint32_t channel(uint32_t color, int index) { return (color >> (index * 8)) & 0xFF; }
+
+    /// x / 255 rounded, exact for x up to 65535
+    uint32_t div255(uint32_t x) {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    // Everything blends like glBlendFuncSeparate(SRC_ALPHA, ONE_MINUS_SRC_ALPHA, ONE, ONE_MINUS_SRC_ALPHA):
+    // color = src * a + dst * (1 - a), alpha = a + dst * (1 - a). Written as src * a for all four
+    // channels (alpha's "src" being 255), so every channel is div255(premultiplied + dst * (255 - a))
+
+    /// What a span blend needs of a color: premultiplied channels and 255 - alpha
+    struct SpanColor {
+        uint32_t premultiplied[4];
+        uint32_t inverse;
+    };
+
+    SpanColor span_color(uint32_t color) {
+        uint32_t alpha = channel(color, 3);
+        return SpanColor{{channel(color, 0) * alpha, channel(color, 1) * alpha, channel(color, 2) * alpha, 255 * alpha},
+                         255 - alpha};
+    }
+
+    uint32_t blend(uint32_t dst, const SpanColor& src) {
+        uint32_t out = 0;
+        for (int i = 0; i < 4; ++i) out |= div255(src.premultiplied[i] + channel(dst, i) * src.inverse) << (i * 8);
+        return out;
+    }
+
+    void blend_pixel(uint32_t& dst, uint32_t color) {
+        uint32_t alpha = channel(color, 3);
+        if (alpha == 255) {
+            dst = color;
+        } else if (alpha) {
+            dst = blend(dst, span_color(color));
+        }
+    }
+
+    void blend_span_scalar(uint32_t* dst, int count, const SpanColor& src) {
+        for (int i = 0; i < count; ++i) dst[i] = blend(dst[i], src);
+    }
+
+#if MAYAK_SOFTWARE_SSE2
+    /// Pixels in 16-bit lanes, r g b a r g b a
+    __m128i sse2_blend(__m128i pixels, __m128i premultiplied, __m128i inverse) {
+        __m128i x = _mm_add_epi16(_mm_mullo_epi16(pixels, inverse), premultiplied); // premultiplied has the + 128
+        return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+    }
+
+    void blend_span_sse2(uint32_t* dst, int count, const SpanColor& src) {
+        const uint32_t* p = src.premultiplied;
+        __m128i premultiplied = _mm_set_epi16(short(p[3] + 128), short(p[2] + 128), short(p[1] + 128), short(p[0] + 128),
+                                              short(p[3] + 128), short(p[2] + 128), short(p[1] + 128), short(p[0] + 128));
+        __m128i inverse = _mm_set1_epi16(short(src.inverse));
+        __m128i zero = _mm_setzero_si128();
+        int i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            __m128i low = sse2_blend(_mm_unpacklo_epi8(pixels, zero), premultiplied, inverse);
+            __m128i high = sse2_blend(_mm_unpackhi_epi8(pixels, zero), premultiplied, inverse);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+        }
+        blend_span_scalar(dst + i, count - i, src);
+    }
+#endif
+
+#if MAYAK_SOFTWARE_AVX2
+    MAYAK_TARGET_AVX2 __m256i avx2_blend(__m256i pixels, __m256i premultiplied, __m256i inverse) {
+        __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(pixels, inverse), premultiplied);
+        return _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+    }
+
+    // Unpack and pack work per 128-bit half, so the pixels come back out in order
+    MAYAK_TARGET_AVX2 void blend_span_avx2(uint32_t* dst, int count, const SpanColor& src) {
+        const uint32_t* p = src.premultiplied;
+        __m256i premultiplied = _mm256_set_epi16(
+            short(p[3] + 128), short(p[2] + 128), short(p[1] + 128), short(p[0] + 128),
+            short(p[3] + 128), short(p[2] + 128), short(p[1] + 128), short(p[0] + 128),
+            short(p[3] + 128), short(p[2] + 128), short(p[1] + 128), short(p[0] + 128),
+            short(p[3] + 128), short(p[2] + 128), short(p[1] + 128), short(p[0] + 128));
+        __m256i inverse = _mm256_set1_epi16(short(src.inverse));
+        __m256i zero = _mm256_setzero_si256();
+        int i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+            __m256i low = avx2_blend(_mm256_unpacklo_epi8(pixels, zero), premultiplied, inverse);
+            __m256i high = avx2_blend(_mm256_unpackhi_epi8(pixels, zero), premultiplied, inverse);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(low, high));
+        }
+        blend_span_sse2(dst + i, count - i, src);
+    }
+#endif
+
+    using SpanFn = void (*)(uint32_t*, int, const SpanColor&);
+
+    SpanFn pick_span_blend() {
+#if MAYAK_SOFTWARE_AVX2
+        if (__builtin_cpu_supports("avx2")) return blend_span_avx2;
+#endif
+#if MAYAK_SOFTWARE_SSE2
+        return blend_span_sse2;
+#else
+        return blend_span_scalar;
+#endif
+    }
+
+    const SpanFn blend_span_simd = pick_span_blend();
+
+    /// count pixels of one color, opaque ones are just a fill
+    void fill_span(uint32_t* dst, int count, uint32_t color) {
+        if (count <= 0) return;
+        uint32_t alpha = channel(color, 3);
+        if (alpha == 255) {
+            std::fill_n(dst, count, color);
+        } else if (alpha) {
+            blend_span_simd(dst, count, span_color(color));
+        }
+    }
+
+    /// Channel-wise a * b / 255, for tints and text colors
+    uint32_t modulate(uint32_t a, uint32_t b) {
+        uint32_t out = 0;
+        for (int i = 0; i < 4; ++i) out |= div255(channel(a, i) * channel(b, i)) << (i * 8);
+        return out;
+    }
+
+    uint32_t with_alpha(uint32_t color, uint32_t alpha) { return (color & 0x00FFFFFFu) | (alpha << 24); }
+
+    /// First pixel whose center is at or after edge, the GL rasterization rule
+    int first_pixel(float edge) { return int(std::ceil(edge - 0.5f)); }
+
+    /// The rounded rect fragment shader, on one pixel center
+    struct RoundedShape {
+        float centerX, centerY, halfWidth, halfHeight;
+        float radii[4];
+        float borderWidth;
+        float fill[4], border[4];
+
+        explicit RoundedShape(const mayak::gfx::RoundedRectInstance& rect) {
+            halfWidth = rect.width * 0.5f;
+            halfHeight = rect.height * 0.5f;
+            centerX = rect.x + halfWidth;
+            centerY = rect.y + halfHeight;
+            float limit = std::min(halfWidth, halfHeight);
+            for (int i = 0; i < 4; ++i) {
+                radii[i] = std::min(rect.radii[i], limit);
+                fill[i] = float(channel(rect.fill, i)) / 255.0f;
+                border[i] = float(channel(rect.border, i)) / 255.0f;
+            }
+            borderWidth = rect.borderWidth;
+        }
+
+        float Distance(float px, float py) const {
+            px -= centerX;
+            py -= centerY;
+            // Top-left, top-right, bottom-right, bottom-left, y goes down
+            float r = px > 0 ? (py > 0 ? radii[2] : radii[1]) : (py > 0 ? radii[3] : radii[0]);
+            float qx = std::abs(px) - halfWidth + r, qy = std::abs(py) - halfHeight + r;
+            float outside = std::sqrt(std::max(qx, 0.0f) * std::max(qx, 0.0f) + std::max(qy, 0.0f) * std::max(qy, 0.0f));
+            return std::min(std::max(qx, qy), 0.0f) + outside - r;
+        }
+
+        /// Fully inside the fill, the pixel is just the fill color
+        bool Inside(float d) const { return 0.5f - d - borderWidth >= 1.0f; }
+
+        uint32_t Color(float d) const {
+            float outer = std::clamp(0.5f - d, 0.0f, 1.0f);
+            float inner = std::clamp(0.5f - d - borderWidth, 0.0f, 1.0f);
+            // Premultiplied like the shader, fill over inner and the border over the ring
+            float fillWeight = fill[3] * inner, borderWeight = border[3] * (outer - inner);
+            float alpha = fillWeight + borderWeight;
+            if (alpha <= 0) return 0;
+            uint32_t out = uint32_t(std::lround(std::clamp(alpha, 0.0f, 1.0f) * 255.0f)) << 24;
+            for (int i = 0; i < 3; ++i) {
+                float value = (fill[i] * fillWeight + border[i] * borderWeight) / alpha;
+                out |= uint32_t(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f)) << (i * 8);
+            }
+            return out;
+        }
+    };
+
+    uint64_t glyph_key(mayak::gfx::FontId font, const mayak::gfx::PlacedGlyph& placed) {
+        // font:16 | size:22 | codepoint:24 | subpixel:2
+        return (uint64_t(font) << 48) | (uint64_t(placed.sizeQuarters & 0x3FFFFF) << 26)
+             | (uint64_t(placed.codepoint & 0xFFFFFF) << 2) | (placed.subpixel & 3);
+    }
+}
+
+void mayak::gfx::SoftwareFramebuffer::Resize(int newWidth, int newHeight) {
+    width = std::max(newWidth, 0);
+    height = std::max(newHeight, 0);
+    pixels.assign(std::size_t(width) * height, 0);
+}
+
+void mayak::gfx::SoftwareFramebuffer::Clear(uint32_t color) {
+    std::fill(pixels.begin(), pixels.end(), color);
+}
+
+void mayak::gfx::SoftwareFramebuffer::Upload(GLuint texture) const {
+    if (!texture || pixels.empty()) return;
+    State().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    State().BindTexture(0, GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
+
+bool mayak::gfx::SoftwareFramebuffer::WritePPM(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << "P6\n" << width << ' ' << height << "\n255\n";
+    std::vector<char> row(std::size_t(width) * 3);
+    for (int y = 0; y < height && file; ++y) {
+        const uint32_t* source = &pixels[std::size_t(y) * width];
+        for (int x = 0; x < width; ++x) {
+            row[x * 3 + 0] = char(channel(source[x], 0));
+            row[x * 3 + 1] = char(channel(source[x], 1));
+            row[x * 3 + 2] = char(channel(source[x], 2));
+        }
+        file.write(row.data(), std::streamsize(row.size()));
+    }
+    if (!file) {
+        MAYAK_LOG_WARN("SoftwareFramebuffer: couldn't write " + path);
+        return false;
+    }
+    return true;
+}
+
+mayak::gfx::SoftwareRenderer::SoftwareRenderer(core::JobSystem* jobs)
+    : jobs(jobs ? *jobs : core::job_system()) {}
+
+void mayak::gfx::SoftwareRenderer::SetTexture(GLuint texture, const SoftwareImage& image) {
+    textures[texture] = image;
+}
+
+void mayak::gfx::SoftwareRenderer::RemoveTexture(GLuint texture) {
+    textures.erase(texture);
+}
+
+void mayak::gfx::SoftwareRenderer::ClearGlyphs() {
+    glyphBitmaps.clear();
+}
+
+const char* mayak::gfx::SoftwareRenderer::SpanBackend() {
+#if MAYAK_SOFTWARE_AVX2
+    if (blend_span_simd == blend_span_avx2) return "avx2";
+#endif
+#if MAYAK_SOFTWARE_SSE2
+    if (blend_span_simd == blend_span_sse2) return "sse2";
+#endif
+    return "scalar";
+}
+
+void mayak::gfx::SoftwareRenderer::Render(CommandList& list, SoftwareFramebuffer& framebuffer) {
+    stats = SoftwareStats{};
+    target = &framebuffer;
+    clip = ClipRect{};
+    primitives.clear();
+    list.Replay(*this);
+
+    // Binned up front, so a tile only looks at what touches it and no two jobs write the same pixel
+    tilesX = (framebuffer.Width() + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (framebuffer.Height() + TILE_SIZE - 1) / TILE_SIZE;
+    bins.resize(std::size_t(tilesX) * tilesY);
+    for (std::vector<uint32_t>& bin : bins) bin.clear();
+    for (std::size_t i = 0; i < primitives.size(); ++i) {
+        const Primitive& primitive = primitives[i];
+        for (int ty = primitive.top / TILE_SIZE; ty <= (primitive.bottom - 1) / TILE_SIZE; ++ty)
+            for (int tx = primitive.left / TILE_SIZE; tx <= (primitive.right - 1) / TILE_SIZE; ++tx)
+                bins[std::size_t(ty) * tilesX + tx].push_back(uint32_t(i));
+    }
+    stats.primitives = primitives.size();
+    for (const std::vector<uint32_t>& bin : bins) stats.tiles += !bin.empty();
+
+    jobs.ParallelFor(0, bins.size(), 1, [this](std::size_t begin, std::size_t end) {
+        for (std::size_t tile = begin; tile < end; ++tile)
+            if (!bins[tile].empty()) RasterizeTile(int(tile));
+    });
+    target = nullptr;
+}
+
+bool mayak::gfx::SoftwareRenderer::Bounds(float x, float y, float width, float height, Primitive& primitive) const {
+    ClipRect area = Intersect(ClipRect{0, 0, target->Width(), target->Height()}, clip);
+    primitive.left = std::max(first_pixel(x), area.x);
+    primitive.top = std::max(first_pixel(y), area.y);
+    primitive.right = std::min(first_pixel(x + width), area.x + area.width);
+    primitive.bottom = std::min(first_pixel(y + height), area.y + area.height);
+    return primitive.left < primitive.right && primitive.top < primitive.bottom;
+}
+
+void mayak::gfx::SoftwareRenderer::RasterizeTile(int tile) {
+    int tileLeft = (tile % tilesX) * TILE_SIZE, tileTop = (tile / tilesX) * TILE_SIZE;
+    int tileRight = std::min(tileLeft + TILE_SIZE, target->Width());
+    int tileBottom = std::min(tileTop + TILE_SIZE, target->Height());
+    int stride = target->Width();
+    uint32_t* pixels = target->Pixels();
+
+    for (uint32_t index : bins[tile]) {
+        const Primitive& primitive = primitives[index];
+        int left = std::max(primitive.left, tileLeft), right = std::min(primitive.right, tileRight);
+        int top = std::max(primitive.top, tileTop), bottom = std::min(primitive.bottom, tileBottom);
+
+        switch (primitive.type) {
+            case PrimitiveType::Fill:
+                for (int y = top; y < bottom; ++y) fill_span(pixels + std::size_t(y) * stride + left, right - left, primitive.color);
+                break;
+
+            case PrimitiveType::Image: {
+                const SoftwareImage& image = *primitive.image;
+                float du = (primitive.u1 - primitive.u0) / primitive.width;
+                float dv = (primitive.v1 - primitive.v0) / primitive.height;
+                for (int y = top; y < bottom; ++y) {
+                    float v = primitive.v0 + (float(y) + 0.5f - primitive.y) * dv;
+                    int ty = std::clamp(int(std::floor(v * float(image.height))), 0, image.height - 1);
+                    const uint32_t* texels = image.pixels + std::size_t(ty) * image.width;
+                    uint32_t* row = pixels + std::size_t(y) * stride;
+                    for (int x = left; x < right; ++x) {
+                        float u = primitive.u0 + (float(x) + 0.5f - primitive.x) * du;
+                        int tx = std::clamp(int(std::floor(u * float(image.width))), 0, image.width - 1);
+                        blend_pixel(row[x], modulate(texels[tx], primitive.color));
+                    }
+                }
+                break;
+            }
+
+            case PrimitiveType::RoundedRect: {
+                RoundedShape shape(primitive.rounded);
+                uint32_t fill = primitive.rounded.fill;
+                for (int y = top; y < bottom; ++y) {
+                    uint32_t* row = pixels + std::size_t(y) * stride;
+                    float py = float(y) + 0.5f;
+                    // The inside of a row is one piece, only the ends need the distance function
+                    int x = left;
+                    for (; x < right; ++x) {
+                        float d = shape.Distance(float(x) + 0.5f, py);
+                        if (shape.Inside(d)) break;
+                        blend_pixel(row[x], shape.Color(d));
+                    }
+                    int end = right;
+                    for (; end > x; --end) {
+                        float d = shape.Distance(float(end - 1) + 0.5f, py);
+                        if (shape.Inside(d)) break;
+                        blend_pixel(row[end - 1], shape.Color(d));
+                    }
+                    fill_span(row + x, end - x, fill);
+                }
+                break;
+            }
+
+            case PrimitiveType::Glyph: {
+                const GlyphBitmap& glyph = *primitive.glyph;
+                int glyphLeft = first_pixel(primitive.x), glyphTop = first_pixel(primitive.y);
+                uint32_t alpha = channel(primitive.color, 3);
+                for (int y = top; y < bottom; ++y) {
+                    const uint8_t* coverage = &glyph.pixels[std::size_t(y - glyphTop) * glyph.width];
+                    uint32_t* row = pixels + std::size_t(y) * stride;
+                    for (int x = left; x < right; ++x) {
+                        uint32_t value = coverage[x - glyphLeft];
+                        if (value) blend_pixel(row[x], with_alpha(primitive.color, div255(alpha * value)));
+                    }
+                }
+                break;
+            }
+        }
+    }
+}
+
+void mayak::gfx::SoftwareRenderer::SetClip(const ClipRect& newClip) {
+    clip = newClip;
+}
+
+void mayak::gfx::SoftwareRenderer::DrawRect(float x, float y, float width, float height, uint32_t color) {
+    Primitive primitive{};
+    primitive.type = PrimitiveType::Fill;
+    primitive.color = color;
+    if (channel(color, 3) && Bounds(x, y, width, height, primitive)) primitives.push_back(primitive);
+}
+
+void mayak::gfx::SoftwareRenderer::DrawImage(float x, float y, float width, float height, GLuint texture,
+                                             float u0, float v0, float u1, float v1, uint32_t tint) {
+    // Texture 0 is the batch's white texture, a plain rect
+    if (!texture) {
+        DrawRect(x, y, width, height, tint);
+        return;
+    }
+    auto found = textures.find(texture);
+    if (found == textures.end() || !found->second.pixels || found->second.width <= 0 || found->second.height <= 0) {
+        ++stats.skipped;
+        return;
+    }
+    Primitive primitive{};
+    primitive.type = PrimitiveType::Image;
+    primitive.color = tint;
+    primitive.x = x;
+    primitive.y = y;
+    primitive.width = width;
+    primitive.height = height;
+    primitive.u0 = u0;
+    primitive.v0 = v0;
+    primitive.u1 = u1;
+    primitive.v1 = v1;
+    primitive.image = &found->second;
+    if (channel(tint, 3) && Bounds(x, y, width, height, primitive)) primitives.push_back(primitive);
+}
+
+void mayak::gfx::SoftwareRenderer::DrawAtlasImage(float, float, float, float, const TextureAtlas&,
+                                                  const AtlasRegion&, uint32_t) {
+    // The atlas only has its pixels on the GPU
+    ++stats.skipped;
+}
+
+void mayak::gfx::SoftwareRenderer::DrawRoundedRect(const RoundedRectInstance& rect) {
+    Primitive primitive{};
+    primitive.type = PrimitiveType::RoundedRect;
+    primitive.rounded = rect;
+    // Same one pixel margin as the shader's quad, for the anti-aliased edge
+    if (Bounds(rect.x - 1, rect.y - 1, rect.width + 2, rect.height + 2, primitive)) primitives.push_back(primitive);
+}
+
+void mayak::gfx::SoftwareRenderer::DrawText(GlyphCache& glyphs, FontId font, float size, float x, float baseline,
+                                            std::string_view text, uint32_t color) {
+    GlyphRasterizer& rasterizer = glyphs.Rasterizer();
+    std::unordered_map<uint64_t, GlyphBitmap>& bitmaps = glyphBitmaps[&rasterizer];
+
+    // Same layout as on the GPU, the bitmaps come from the same rasterizer at the same size and
+    // offset. Only ours though, the atlas never sees them
+    glyphs.LayoutText(font, size, x, baseline, text, [&](const PlacedGlyph& placed) {
+        uint64_t key = glyph_key(font, placed);
+        auto found = bitmaps.find(key);
+        if (found == bitmaps.end()) {
+            GlyphBitmap bitmap;
+            if (!rasterizer.Rasterize(font, float(placed.sizeQuarters) * 0.25f, placed.codepoint,
+                                      float(placed.subpixel) / GLYPH_SUBPIXEL_STEPS, bitmap)) {
+                // Missing glyphs still advance, like in the GlyphCache
+                bitmap.width = bitmap.height = 0;
+                bitmap.pixels.clear();
+            }
+            found = bitmaps.emplace(key, std::move(bitmap)).first;
+            ++stats.glyphsRasterized;
+        }
+
+        const GlyphBitmap& bitmap = found->second;
+        if (bitmap.width <= 0 || bitmap.height <= 0
+            || bitmap.pixels.size() < std::size_t(bitmap.width) * std::size_t(bitmap.height))
+            return bitmap.advance;
+        float left = placed.penX + float(bitmap.bearingX), top = placed.baseline - float(bitmap.bearingY);
+        Primitive primitive{};
+        primitive.type = PrimitiveType::Glyph;
+        primitive.color = color;
+        primitive.x = left;
+        primitive.y = top;
+        primitive.glyph = &bitmap;
+        if (Bounds(left, top, float(bitmap.width), float(bitmap.height), primitive)) primitives.push_back(primitive);
+        return bitmap.advance;
+    });
+}
+
+void mayak::gfx::SoftwareRenderer::DrawText(SdfGlyphCache&, FontId, float, float, float, std::string_view, uint32_t,
+                                            const SdfTextStyle&) {
+    // Distance fields get made into the atlas on the GPU side, nothing to sample here
+    ++stats.skipped;
+}
+
+void mayak::gfx::SoftwareRenderer::DrawCustom(CommandList::CustomFn, const void*) {
+    ++stats.skipped;
+}
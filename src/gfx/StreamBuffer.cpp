@@ -0,0 +1,157 @@
+#include <glad/glad.h>
+
+#include "gfx/StreamBuffer.hpp"
+#include "gfx/GLState.hpp"
+#include "core/Time.hpp"
+#include "utils/logger.hpp"
+
+#include <string>
+
+namespace {
+    // Don't hang forever on a broken driver, a second is already a disaster
+    constexpr GLuint64 FENCE_TIMEOUT_NS = 1'000'000'000;
+
+    GLsizeiptr align_up(GLsizeiptr value, GLsizeiptr alignment) {
+        if (alignment <= 1) return value;
+        GLsizeiptr rest = value % alignment;
+        return rest ? value + alignment - rest : value;
+    }
+}
+
+bool mayak::gfx::StreamBuffer::Create(GLenum newTarget, GLsizeiptr newPartitionSize, int partitions) {
+    if (partitions < 1 || partitions > MAX_PARTITIONS || newPartitionSize <= 0) {
+        MAYAK_LOG_ERROR("StreamBuffer: bad size, " + std::to_string(partitions) + " partitions of "
+                        + std::to_string(newPartitionSize) + " bytes");
+        return false;
+    }
+    target = newTarget;
+    partitionSize = newPartitionSize;
+    partitionCount = partitions;
+    partition = 0;
+    cursor = 0;
+    fences.fill(nullptr);
+    stats = StreamBufferStats{};
+
+    GLsizeiptr total = partitionSize * partitionCount;
+    glGenBuffers(1, &buffer);
+    State().BindBuffer(target, buffer);
+
+    // glad only loads core, so buffer storage means GL 4.4 here
+    persistent = GLAD_GL_VERSION_4_4 && glBufferStorage;
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, total, nullptr, flags);
+        persistentData = static_cast<uint8_t*>(glMapBufferRange(target, 0, total, flags));
+        if (!persistentData) {
+            // Storage is immutable now, start over with a plain buffer
+            MAYAK_LOG_WARN("StreamBuffer: persistent mapping failed, falling back to orphaning");
+            ForgetSharedBuffer(buffer);
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            State().BindBuffer(target, buffer);
+            persistent = false;
+        }
+    }
+    if (!persistent) glBufferData(target, total, nullptr, GL_STREAM_DRAW);
+    return true;
+}
+
+void mayak::gfx::StreamBuffer::Destroy() {
+    if (!buffer) return;
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (persistent || mapped) {
+        State().BindBuffer(target, buffer);
+        glUnmapBuffer(target);
+    }
+    ForgetSharedBuffer(buffer);
+    glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    persistentData = nullptr;
+    mapped = false;
+}
+
+void mayak::gfx::StreamBuffer::NextPartition() {
+    // Everything that reads the old partition got issued already, fence it
+    if (fences[partition]) glDeleteSync(fences[partition]);
+    fences[partition] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // Other contexts may wait on this one, it has to reach the GPU
+    glFlush();
+
+    partition = (partition + 1) % partitionCount;
+    cursor = 0;
+
+    GLsync& fence = fences[partition];
+    if (!fence) return;
+
+    // Free already? That's the normal case with 3 partitions
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        if (persistent) {
+            ++stats.waitStalls;
+            int64_t start = core::time::now_ns();
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+            stats.waitNs += core::time::now_ns() - start;
+        } else {
+            // Orphan: the driver hands us new storage, the GPU keeps reading the old one.
+            // Every other fence guarded the old storage too, they're all meaningless now
+            ++stats.orphans;
+            State().BindBuffer(target, buffer);
+            glBufferData(target, partitionSize * partitionCount, nullptr, GL_STREAM_DRAW);
+            for (GLsync& other : fences) {
+                if (other) glDeleteSync(other);
+                other = nullptr;
+            }
+            return;
+        }
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+mayak::gfx::StreamAllocation mayak::gfx::StreamBuffer::Map(GLsizeiptr bytes, GLsizeiptr alignment) {
+    if (!buffer || bytes <= 0 || bytes > partitionSize) {
+        MAYAK_LOG_ERROR("StreamBuffer: can't map " + std::to_string(bytes) + " bytes, partitions are "
+                        + std::to_string(partitionSize));
+        return {};
+    }
+    if (mapped) Unmap();
+
+    GLsizeiptr partitionStart = partition * partitionSize;
+    GLsizeiptr offset = align_up(partitionStart + cursor, alignment);
+    if (offset + bytes > partitionStart + partitionSize) {
+        NextPartition();
+        partitionStart = partition * partitionSize;
+        offset = align_up(partitionStart, alignment);
+        // Alignment padding pushed it over, only happens with silly alignments
+        if (offset + bytes > partitionStart + partitionSize) return {};
+    }
+    cursor = offset + bytes - partitionStart;
+
+    StreamAllocation allocation;
+    allocation.offset = offset;
+    allocation.size = bytes;
+    if (persistent) {
+        allocation.data = persistentData + offset;
+    } else {
+        // Nobody reads this range (the fence said so), no need for the driver to sync
+        State().BindBuffer(target, buffer);
+        allocation.data = glMapBufferRange(target, offset, bytes,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        mapped = allocation.data != nullptr;
+        if (!mapped) return {};
+    }
+
+    ++stats.allocations;
+    stats.bytesStreamed += uint64_t(bytes);
+    return allocation;
+}
+
+void mayak::gfx::StreamBuffer::Unmap() {
+    if (!mapped) return;
+    State().BindBuffer(target, buffer);
+    glUnmapBuffer(target);
+    mapped = false;
+}
@@ -0,0 +1,42 @@
+#include "ui/Label.hpp"
+#include "gfx/Batch.hpp"
+
+#include <cmath>
+
+namespace {
+    template <typename Cache>
+    mayak::vec2 measure_with(Cache& glyphs, mayak::gfx::FontId font, float fontSize, const std::string& text) {
+        mayak::gfx::FontMetrics metrics = glyphs.Metrics(font, fontSize);
+        float width = glyphs.MeasureText(font, fontSize, text);
+        int lines = 1;
+        for (char c : text) lines += c == '\n';
+        return mayak::vec2(width, metrics.ascent + metrics.descent + (lines - 1) * metrics.LineHeight());
+    }
+}
+
+mayak::ui::Label::Label(const std::string& text) : text(text) {}
+
+mayak::vec2 mayak::ui::Label::measure(gfx::GlyphCache& glyphs) const {
+    return measure_with(glyphs, font, fontSize, text);
+}
+
+mayak::vec2 mayak::ui::Label::measure(gfx::SdfGlyphCache& glyphs) const {
+    return measure_with(glyphs, font, fontSize, text);
+}
+
+void mayak::ui::Label::draw(DrawContext& ctx) {
+    if (text.empty()) return;
+    if (ctx.sdfGlyphs) {
+        // Any size works, no rounding so animated sizes and zoom move smoothly
+        float pixelSize = fontSize * ctx.scale;
+        float baseline = position.y * ctx.scale + ctx.sdfGlyphs->Metrics(font, pixelSize).ascent;
+        ctx.sdfGlyphs->DrawText(ctx.batch, font, pixelSize, position.x * ctx.scale, baseline, text, color, style);
+        return;
+    }
+    if (!ctx.glyphs) return;
+    // Rasterize at the real pixel size, so text stays sharp on HiDPI
+    float pixelSize = fontSize * ctx.scale;
+    gfx::FontMetrics metrics = ctx.glyphs->Metrics(font, pixelSize);
+    float baseline = std::round(position.y * ctx.scale + metrics.ascent);
+    ctx.glyphs->DrawText(ctx.batch, font, pixelSize, position.x * ctx.scale, baseline, text, color);
+}
@@ -0,0 +1,15 @@
+#include "ui/Widget.hpp"
+#include "core/Window.hpp"
+
+void mayak::ui::Widget::onMouseEvent(const mayak::Event&) {}
+
+void mayak::ui::Widget::draw(DrawContext&) {}
+
+bool mayak::ui::Widget::contains(const vec2& point) const {
+    return point.x >= position.x && point.y >= position.y
+        && point.x < position.x + size.x && point.y < position.y + size.y;
+}
+
+void mayak::ui::Widget::invalidate(core::Window& window) const {
+    window.Invalidate(position, size);
+}
@@ -0,0 +1,172 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "gfx/Atlas.hpp"
+#include "core/Mainloop.hpp"
+
+#include <random>
+#include <vector>
+
+using namespace mayak::gfx;
+
+// Everything here runs the atlas CPU-only (no Create()), packing and bookkeeping are the same
+
+namespace {
+    struct Size { int width, height; };
+
+    // Mostly icon / glyph sized, some bigger images
+    std::vector<Size> random_sizes(int count, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> small(4, 48);
+        std::uniform_int_distribution<int> big(48, 160);
+        std::uniform_int_distribution<int> pick(0, 9);
+        std::vector<Size> sizes;
+        for (int i = 0; i < count; ++i) {
+            auto& dist = pick(rng) == 0 ? big : small;
+            sizes.push_back(Size{dist(rng), dist(rng)});
+        }
+        return sizes;
+    }
+
+    bool overlap(const AtlasRegion& a, const AtlasRegion& b) {
+        return a.page == b.page && a.x < b.x + b.width && b.x < a.x + a.width
+            && a.y < b.y + b.height && b.y < a.y + a.height;
+    }
+}
+
+TEST_CASE("Skyline packs without overlaps and stays in bounds", "[atlas]") {
+    SkylinePacker packer(256, 256);
+    std::vector<AtlasRegion> placed;
+    for (const Size& size : random_sizes(400, 1)) {
+        AtlasRegion region;
+        region.page = 0;
+        region.width = size.width / 2;
+        region.height = size.height / 2;
+        if (!packer.Insert(region.width, region.height, region.x, region.y)) continue;
+        REQUIRE(region.x >= 0);
+        REQUIRE(region.y >= 0);
+        REQUIRE(region.x + region.width <= 256);
+        REQUIRE(region.y + region.height <= 256);
+        placed.push_back(region);
+    }
+    REQUIRE(placed.size() > 50);
+
+    bool anyOverlap = false;
+    for (std::size_t i = 0; i < placed.size(); ++i)
+        for (std::size_t j = i + 1; j < placed.size(); ++j)
+            anyOverlap = anyOverlap || overlap(placed[i], placed[j]);
+    REQUIRE_FALSE(anyOverlap);
+}
+
+TEST_CASE("10k random images pack tightly", "[atlas]") {
+    AtlasOptions options;
+    options.pageSize = 2048;
+    options.maxPages = 16;
+    TextureAtlas atlas(options);
+
+    for (const Size& size : random_sizes(10000, 2))
+        REQUIRE(atlas.Insert(atlas.Count() + 1, size.width, size.height, nullptr) != nullptr);
+
+    REQUIRE(atlas.Count() == 10000);
+    REQUIRE(atlas.Stats().evictions == 0);
+    // The last page is only partly filled, so this is a lower bound of the real packing density
+    REQUIRE(atlas.Efficiency() > 0.7f);
+}
+
+TEST_CASE("Full atlas evicts the least recently used images", "[atlas]") {
+    AtlasOptions options;
+    options.pageSize = 64;
+    options.maxPages = 1;
+    options.padding = 0;
+    TextureAtlas atlas(options);
+
+    // 16 tiles of 16x16 fill the page exactly
+    for (uint64_t key = 1; key <= 16; ++key) REQUIRE(atlas.Insert(key, 16, 16, nullptr));
+    mayak::core::_advance_frame_count();
+    REQUIRE(atlas.Find(1)); // 1 is fresh now, 2 is the oldest
+
+    // A frame later nothing on the page is being drawn, so it may be repacked
+    mayak::core::_advance_frame_count();
+    REQUIRE(atlas.Insert(100, 16, 16, nullptr));
+    REQUIRE(atlas.Find(1));
+    REQUIRE_FALSE(atlas.Find(2));
+    REQUIRE(atlas.Find(100));
+    REQUIRE(atlas.Stats().evictions >= 1);
+    REQUIRE(atlas.Stats().compactions >= 1);
+}
+
+TEST_CASE("Pages the frame draws from are never repacked under it", "[atlas]") {
+    AtlasOptions options;
+    options.pageSize = 64;
+    options.maxPages = 2;
+    options.padding = 0;
+    TextureAtlas atlas(options);
+
+    // Page 0 gets 1..16, page 1 gets 17..32
+    for (uint64_t key = 1; key <= 32; ++key) REQUIRE(atlas.Insert(key, 16, 16, nullptr));
+    mayak::core::_advance_frame_count();
+    AtlasRegion five = *atlas.Find(5);
+    REQUIRE(five.page == 0);
+
+    // Only page 1 is free to move, its oldest make room
+    const AtlasRegion* added = atlas.Insert(100, 16, 16, nullptr);
+    REQUIRE(added);
+    REQUIRE(added->page == 1);
+    REQUIRE_FALSE(atlas.Find(17));
+    REQUIRE(atlas.Find(5)->x == five.x);
+    REQUIRE(atlas.Find(5)->y == five.y);
+
+    // Now both pages are in use: refused, nothing moves or goes
+    uint64_t evictions = atlas.Stats().evictions;
+    REQUIRE(atlas.Insert(101, 48, 48, nullptr) == nullptr);
+    REQUIRE(atlas.Stats().evictions == evictions);
+    REQUIRE(atlas.Find(5)->x == five.x);
+    REQUIRE(atlas.Find(100));
+
+    // The next frame makes the room before anything gets drawn
+    mayak::core::_advance_frame_count();
+    REQUIRE(atlas.Insert(101, 48, 48, nullptr));
+    REQUIRE(atlas.Stats().evictions > evictions);
+}
+
+TEST_CASE("Compaction gets back the space of removed images", "[atlas]") {
+    AtlasOptions options;
+    options.pageSize = 128;
+    options.maxPages = 1;
+    options.padding = 1;
+    TextureAtlas atlas(options);
+
+    for (uint64_t key = 1; key <= 40; ++key) atlas.Insert(key, 14, 14, nullptr);
+    for (uint64_t key = 1; key <= 40; key += 2) atlas.Remove(key);
+    REQUIRE(atlas.Fragmentation(0) > 0.4f);
+
+    REQUIRE(atlas.CompactFragmented() == 1);
+    REQUIRE(atlas.Fragmentation(0) == 0.0f);
+    REQUIRE(atlas.Count() == 20);
+    for (uint64_t key = 2; key <= 40; key += 2) REQUIRE(atlas.Find(key));
+}
+
+TEST_CASE("Images bigger than a page are refused", "[atlas]") {
+    AtlasOptions options;
+    options.pageSize = 64;
+    TextureAtlas atlas(options);
+    REQUIRE(atlas.Insert(1, 64, 10, nullptr) == nullptr); // no room for the padding
+    REQUIRE(atlas.Stats().failures == 1);
+}
+
+TEST_CASE("Atlas packing", "[atlas][!benchmark]") {
+    std::vector<Size> sizes = random_sizes(10000, 3);
+    AtlasOptions options;
+    options.pageSize = 2048;
+    options.maxPages = 16;
+
+    BENCHMARK("Insert 10k random sizes") {
+        TextureAtlas atlas(options);
+        for (std::size_t i = 0; i < sizes.size(); ++i)
+            atlas.Insert(i + 1, sizes[i].width, sizes[i].height, nullptr);
+        return atlas.Efficiency();
+    };
+
+    TextureAtlas atlas(options);
+    for (std::size_t i = 0; i < sizes.size(); ++i) atlas.Insert(i + 1, sizes[i].width, sizes[i].height, nullptr);
+    WARN("10k images: " << atlas.PagesInUse() << " pages, efficiency " << atlas.Efficiency());
+}
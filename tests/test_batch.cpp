@@ -0,0 +1,253 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "gfx/Batch.hpp"
+#include "gfx/GLState.hpp"
+#include "test_helpers.hpp"
+
+using namespace mayak::gfx;
+
+// No GL in here, mostly how quads get grouped into runs (= draw calls).
+// Flushes only get to the (fake) draws with FakeGL and fake_vertex_stream().
+
+TEST_CASE("Same state quads become one draw call", "[batch]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    for (int i = 0; i < 10000; ++i)
+        batch.DrawRect(float(i % 100), float(i / 100), 4, 4, PackColor(255, 0, 0));
+
+    REQUIRE(batch.PendingQuads() == 10000);
+    REQUIRE(batch.PendingRuns() == 1);
+}
+
+TEST_CASE("Plain colored quads batch with the white texture", "[batch]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    batch.DrawRect(0, 0, 10, 10, PackColor(0, 0, 0));
+    batch.DrawTexturedRect(10, 0, 10, 10, ctx.whiteTexture);
+    batch.DrawRect(20, 0, 10, 10, PackColor(0, 0, 0));
+    REQUIRE(batch.PendingRuns() == 1);
+}
+
+TEST_CASE("Texture and shader changes break the batch, clips don't", "[batch]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    batch.DrawTexturedRect(0, 0, 10, 10, 5);
+    batch.DrawTexturedRect(0, 0, 10, 10, 5);
+    batch.DrawTexturedRect(0, 0, 10, 10, 6);
+    REQUIRE(batch.PendingRuns() == 2);
+    REQUIRE(batch.Stats().textureBreaks == 1);
+
+    // Tested in the shader, the run goes on
+    batch.SetClip(ClipRect{0, 0, 100, 100});
+    batch.DrawTexturedRect(0, 0, 10, 10, 6);
+    REQUIRE(batch.PendingRuns() == 2);
+    REQUIRE(batch.Stats().clipBreaks == 0);
+
+    batch.SetShader(9);
+    batch.DrawTexturedRect(0, 0, 10, 10, 6);
+    REQUIRE(batch.PendingRuns() == 3);
+    REQUIRE(batch.Stats().shaderBreaks == 1);
+
+    // A custom shader doesn't know the clip table, it gets scissored instead
+    uint64_t clipBreaks = batch.Stats().clipBreaks;
+    batch.SetClip(ClipRect{0, 0, 50, 50});
+    batch.DrawTexturedRect(0, 0, 10, 10, 6);
+    REQUIRE(batch.PendingRuns() == 4);
+    REQUIRE(batch.Stats().clipBreaks == clipBreaks + 1);
+}
+
+TEST_CASE("Premultiplied runs blend with ONE", "[batch]") {
+    mayak::test::FakeGL gl;
+    RendererContext ctx = mayak::test::fake_context();
+    mayak::test::fake_vertex_stream(ctx);
+    State().Invalidate(); // another test may have left the same blend func in the shadow
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    batch.DrawRect(0, 0, 10, 10, PackColor(0, 0, 0));
+    batch.SetShader(9, true);
+    batch.DrawTexturedRect(0, 0, 10, 10, 6);
+    batch.SetShader(0);
+    batch.DrawRect(0, 0, 10, 10, PackColor(0, 0, 0));
+    REQUIRE(batch.PendingRuns() == 3);
+    REQUIRE(batch.Stats().blendBreaks == 2);
+
+    batch.Flush();
+    REQUIRE(batch.Stats().drawCalls == 3);
+    const auto& issued = mayak::test::fake_gl::blendFuncs;
+    REQUIRE(issued.size() == 3);
+    REQUIRE((issued[0] == std::array<GLenum, 4>{GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA}));
+    REQUIRE((issued[1] == std::array<GLenum, 4>{GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA}));
+    REQUIRE((issued[2] == issued[0]));
+    ctx.vertexStream.Destroy();
+}
+
+TEST_CASE("The clip stack intersects and pops back", "[batch]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    batch.PushClip(ClipRect{0, 0, 400, 300});      // panel
+    batch.PushClip(ClipRect{200, 100, 400, 400});  // scroll view sticking out of it
+    REQUIRE((batch.Clip() == ClipRect{200, 100, 200, 200}));
+    REQUIRE(batch.ClipDepth() == 2);
+
+    // Every item of the scroll view clipped differently, still one run
+    for (int i = 0; i < 10; ++i) {
+        batch.PushClip(ClipRect{200, 100 + i * 30, 200, 30});
+        batch.DrawRect(200, float(100 + i * 30), 200, 30, PackColor(0, 0, 0));
+        batch.DrawRoundedRect(210, float(105 + i * 30), 50, 20, 4, PackColor(255, 255, 255));
+        batch.PopClip();
+    }
+    REQUIRE(batch.Stats().clipBreaks == 0);
+
+    batch.PopClip();
+    REQUIRE((batch.Clip() == ClipRect{0, 0, 400, 300}));
+    batch.PopClip();
+    REQUIRE(batch.Clip().IsNone());
+    REQUIRE(batch.ClipDepth() == 0);
+    batch.Discard();
+}
+
+TEST_CASE("Clips that are rectangles after all skip the stencil", "[batch]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    batch.PushRoundedClip(10, 10, 100, 50, 0);
+    REQUIRE((batch.Clip() == ClipRect{10, 10, 100, 50}));
+
+    // Rotated by 90 degrees, corners start at the top right
+    const QuadVertex corners[4] = {
+        {110, 10, 0, 0, 0, 0, 0}, {110, 60, 0, 0, 0, 0, 0}, {10, 60, 0, 0, 0, 0, 0}, {10, 10, 0, 0, 0, 0, 0}};
+    batch.PushClip(corners);
+    REQUIRE((batch.Clip() == ClipRect{10, 10, 100, 50}));
+
+    REQUIRE(batch.StencilDepth() == 0);
+    REQUIRE(batch.Stats().stencilClips == 0);
+    batch.PopClip();
+    batch.PopClip();
+    REQUIRE(batch.Clip().IsNone());
+}
+
+TEST_CASE("State changes without quads in between don't break anything", "[batch]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    batch.DrawRect(0, 0, 10, 10, PackColor(0, 0, 0));
+    batch.SetClip(ClipRect{0, 0, 50, 50});
+    batch.SetShader(9);
+    batch.SetShader(0);
+    batch.ClearClip();
+    batch.DrawRect(0, 0, 10, 10, PackColor(0, 0, 0));
+    REQUIRE(batch.PendingRuns() == 1);
+}
+
+TEST_CASE("Rounded rects keep draw order with quads", "[batch]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    for (int i = 0; i < 100; ++i)
+        batch.DrawRoundedRect(0, float(i), 50, 20, 6, PackColor(40, 40, 40), PackColor(200, 200, 200), 1);
+    REQUIRE(batch.PendingRuns() == 1);
+    REQUIRE(batch.PendingRoundedRects() == 100);
+
+    batch.DrawRect(0, 0, 10, 10, PackColor(255, 0, 0));
+    batch.DrawRoundedRect(0, 0, 10, 10, 2, PackColor(0, 0, 0));
+    REQUIRE(batch.PendingRuns() == 3);
+}
+
+TEST_CASE("Clip changes don't split rounded rects", "[batch]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    batch.DrawRoundedRect(0, 0, 10, 10, 2, PackColor(0, 0, 0));
+    batch.SetClip(ClipRect{0, 0, 100, 100});
+    batch.DrawRoundedRect(0, 0, 10, 10, 2, PackColor(0, 0, 0));
+    batch.SetClip(ClipRect{100, 0, 100, 100});
+    batch.DrawRoundedRect(0, 0, 10, 10, 2, PackColor(0, 0, 0));
+    batch.SetClip(ClipRect{0, 0, 100, 100});
+    batch.DrawRoundedRect(0, 0, 10, 10, 2, PackColor(0, 0, 0));
+
+    REQUIRE(batch.PendingRuns() == 1);
+    REQUIRE(batch.Stats().clipBreaks == 0);
+}
+
+TEST_CASE("Bounds cull what's outside and clip the rest", "[batch]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600, ClipRect{100, 100, 20, 20});
+
+    for (int i = 0; i < 40; ++i) batch.DrawRect(float(i * 20), 100, 20, 20, PackColor(0, 0, 0));
+    batch.DrawRoundedRect(0, 0, 50, 50, 4, PackColor(0, 0, 0));
+    REQUIRE(batch.PendingQuads() == 1);
+    REQUIRE(batch.PendingRoundedRects() == 0);
+    REQUIRE(batch.Stats().culled == 40);
+
+    // Clips stay what they were set to, they just draw within the bounds
+    batch.SetClip(ClipRect{0, 0, 110, 600});
+    REQUIRE((batch.Clip() == ClipRect{0, 0, 110, 600}));
+    batch.DrawRect(100, 100, 20, 20, PackColor(0, 0, 0));
+    REQUIRE(batch.PendingRuns() == 1);
+    REQUIRE(batch.Stats().clipBreaks == 0);
+    batch.Discard();
+
+    // Next frame without bounds draws everything again
+    batch.Begin(800, 600);
+    batch.DrawRect(0, 0, 20, 20, PackColor(0, 0, 0));
+    REQUIRE(batch.PendingQuads() == 1);
+    batch.Discard();
+}
+
+TEST_CASE("Rounded rect instances stay 48 bytes", "[batch]") {
+    REQUIRE(sizeof(RoundedRectInstance) == 48);
+}
+
+TEST_CASE("Stencil shapes go around the stats and the clip slots follow the box", "[batch]") {
+    mayak::test::FakeGL gl;
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    batch.DrawRect(0, 0, 10, 10, PackColor(0, 0, 0));
+    REQUIRE(batch.PendingVertices()[0].clip == 0);
+
+    batch.PushRoundedClip(10, 10, 100, 50, 8);
+    REQUIRE(batch.StencilDepth() == 1);
+    REQUIRE(batch.PendingRuns() == 0);
+    batch.DrawRect(20, 20, 10, 10, PackColor(0, 0, 0));
+    // The box goes in the clip table, the stencil only does the corners
+    for (int i = 0; i < 4; ++i) REQUIRE(batch.PendingVertices()[i].clip == 1);
+
+    const QuadVertex diamond[4] = {
+        {60, 0, 0, 0, 0, 0, 0}, {120, 35, 0, 0, 0, 0, 0}, {60, 70, 0, 0, 0, 0, 0}, {0, 35, 0, 0, 0, 0, 0}};
+    batch.PushClip(diamond);
+    REQUIRE(batch.StencilDepth() == 2);
+    batch.DrawRect(50, 20, 10, 10, PackColor(0, 0, 0));
+    REQUIRE((batch.Clip() == ClipRect{10, 10, 100, 50}));
+    for (int i = 0; i < 4; ++i) REQUIRE(batch.PendingVertices()[i].clip == 1);
+
+    batch.PopClip();
+    batch.PopClip();
+    REQUIRE(batch.StencilDepth() == 0);
+    batch.DrawRect(0, 0, 10, 10, PackColor(0, 0, 0));
+    REQUIRE(batch.PendingVertices()[0].clip == 0);
+
+    // Four shapes (two in, two out) are a flush each, three of them came after pending rects
+    REQUIRE(batch.Stats().stencilClips == 2);
+    REQUIRE(batch.Stats().stencilBreaks == 7);
+    // Only the rects anybody drew
+    REQUIRE(batch.Stats().quads == 4);
+    REQUIRE(batch.Stats().roundedRects == 0);
+    REQUIRE(batch.Stats().culled == 0);
+    batch.Discard();
+}
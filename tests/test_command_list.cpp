@@ -0,0 +1,185 @@
+#include <catch2/catch_test_macros.hpp>
+#include "gfx/CommandList.hpp"
+#include "test_helpers.hpp"
+
+#include <vector>
+
+using namespace mayak::gfx;
+
+namespace {
+    // Custom commands write down the order they ran in
+    struct Probe {
+        std::vector<int>* log;
+        int id;
+    };
+
+    void record_probe(QuadBatch& batch, const void* data) {
+        auto* probe = static_cast<const Probe*>(data);
+        probe->log->push_back(probe->id);
+        // What clip it ran under
+        probe->log->push_back(batch.Clip().IsNone() ? -1 : batch.Clip().x);
+    }
+
+    // Writes down what got drawn, in order
+    class OrderTarget : public CommandTarget {
+    public:
+        std::vector<CommandType> drawn;
+
+        void SetClip(const ClipRect&) override {}
+        void DrawRect(float, float, float, float, uint32_t) override { drawn.push_back(CommandType::Rect); }
+        void DrawImage(float, float, float, float, GLuint, float, float, float, float, uint32_t) override {
+            drawn.push_back(CommandType::Image);
+        }
+        void DrawAtlasImage(float, float, float, float, const TextureAtlas&, const AtlasRegion&, uint32_t) override {
+            drawn.push_back(CommandType::AtlasImage);
+        }
+        void DrawRoundedRect(const RoundedRectInstance&) override { drawn.push_back(CommandType::RoundedRect); }
+        void DrawText(GlyphCache&, FontId, float, float, float, std::string_view, uint32_t) override {
+            drawn.push_back(CommandType::Text);
+        }
+        void DrawText(SdfGlyphCache&, FontId, float, float, float, std::string_view, uint32_t,
+                      const SdfTextStyle&) override {
+            drawn.push_back(CommandType::DistanceFieldText);
+        }
+    };
+}
+
+TEST_CASE("Sort keys order by layer, then depth, then state", "[commands]") {
+    REQUIRE(MakeSortKey(1, 0, 0, 0) > MakeSortKey(0, 0xFFFF, 0xFFF, 0xFFFFFFF));
+    REQUIRE(MakeSortKey(0, 1, 0, 0) > MakeSortKey(0, 0, 0xFFF, 0xFFFFFFF));
+    REQUIRE(MakeSortKey(0, 0, 2, 0) > MakeSortKey(0, 0, 1, 0xFFFFFFF));
+    REQUIRE(MakeSortKey(0, 0, 1, 7) > MakeSortKey(0, 0, 1, 6));
+}
+
+TEST_CASE("Sorting merges same-depth commands into fewer runs", "[commands]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch immediate(ctx), replayed(ctx);
+    immediate.Begin(800, 600);
+    replayed.Begin(800, 600);
+    CommandList list;
+
+    // Icon, background, icon, background... immediate mode breaks on every one
+    for (int i = 0; i < 10; ++i) {
+        GLuint texture = 10 + i % 2;
+        immediate.DrawTexturedRect(float(i * 20), 0, 16, 16, texture);
+        list.DrawImage(float(i * 20), 0, 16, 16, texture);
+    }
+    REQUIRE(immediate.PendingRuns() == 10);
+
+    list.Replay(replayed);
+    REQUIRE(replayed.PendingRuns() == 2);
+    REQUIRE(replayed.PendingQuads() == 10);
+
+    // Replaying again draws the same thing, the list stays
+    list.Replay(replayed);
+    REQUIRE(replayed.PendingQuads() == 20);
+    immediate.Discard();
+    replayed.Discard();
+}
+
+TEST_CASE("Depth and recording order survive sorting", "[commands]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+    std::vector<int> log;
+    CommandList list;
+
+    list.SetDepth(2);
+    Probe top{&log, 3};
+    list.DrawCustom(record_probe, &top, sizeof(top));
+    list.SetDepth(1);
+    Probe first{&log, 1}, second{&log, 2};
+    list.DrawCustom(record_probe, &first, sizeof(first));
+    list.DrawCustom(record_probe, &second, sizeof(second));
+    list.SetLayer(1);
+    list.SetDepth(0);
+    Probe popup{&log, 4};
+    list.DrawCustom(record_probe, &popup, sizeof(popup));
+
+    list.Replay(batch);
+    REQUIRE((log == std::vector<int>{1, -1, 2, -1, 3, -1, 4, -1}));
+}
+
+TEST_CASE("Clips stick to their commands through sorting", "[commands]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+    std::vector<int> log;
+    CommandList list;
+
+    Probe inner{&log, 1}, outer{&log, 2}, after{&log, 3};
+    list.SetDepth(5);
+    list.PushClip(ClipRect{10, 10, 100, 100});
+    list.PushClip(ClipRect{50, 0, 500, 500}); // intersected: x 50, y 10, 60 x 100
+    list.DrawCustom(record_probe, &inner, sizeof(inner));
+    list.PopClip();
+    list.SetDepth(0); // sorts before the clipped one, must not pick up its clip
+    list.DrawCustom(record_probe, &after, sizeof(after));
+    list.SetDepth(5);
+    list.DrawCustom(record_probe, &outer, sizeof(outer));
+    list.PopClip();
+
+    list.Replay(batch);
+    REQUIRE((log == std::vector<int>{3, 10, 1, 50, 2, 10}));
+    // The batch gets its clip back
+    REQUIRE(batch.Clip().IsNone());
+}
+
+TEST_CASE("Cached lists get appended without copying", "[commands]") {
+    RendererContext ctx = mayak::test::fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    CommandList cached;
+    for (int i = 0; i < 100; ++i) cached.DrawRect(float(i), 0, 1, 1, PackColor(255, 0, 0));
+    std::size_t cachedBytes = cached.Arena().Used();
+
+    CommandList frame;
+    uint64_t blocks = 0;
+    for (int round = 0; round < 5; ++round) {
+        frame.Clear();
+        frame.DrawRect(0, 0, 800, 600, PackColor(0, 0, 0));
+        frame.Append(cached);
+        REQUIRE(frame.Size() == 101);
+        REQUIRE(frame.Arena().Used() < cachedBytes);
+        frame.Replay(batch);
+        batch.Discard();
+        if (round == 0) blocks = frame.Arena().BlockAllocations();
+    }
+    // Steady state: the frame list doesn't touch the heap for its arena
+    REQUIRE(frame.Arena().BlockAllocations() == blocks);
+}
+
+TEST_CASE("Text stays on top of the background it was recorded on", "[commands]") {
+    mayak::test::BoxRasterizer rasterizer;
+    GlyphCache glyphs(rasterizer);
+    CommandList list;
+
+    // Same depth, rounded rects sort after atlas text when nothing's in the way
+    list.DrawRoundedRect(RoundedRectInstance{0, 0, 200, 40, {4, 4, 4, 4}, PackColor(40, 40, 40), 0, 0, 0});
+    list.DrawText(glyphs, 0, 16, 10, 28, "Label", PackColor(255, 255, 255));
+    list.DrawRoundedRect(RoundedRectInstance{400, 0, 200, 40, {4, 4, 4, 4}, PackColor(40, 40, 40), 0, 0, 0});
+
+    OrderTarget target;
+    list.Replay(target);
+    // The far one still joins the first background, the text comes last
+    REQUIRE((target.drawn == std::vector<CommandType>{CommandType::RoundedRect, CommandType::RoundedRect,
+                                                      CommandType::Text}));
+}
+
+TEST_CASE("Atlas images look their region up when replayed", "[commands]") {
+    TextureAtlas atlas(AtlasOptions{64, 1, GL_R8, 1, 0.3f});
+    REQUIRE(atlas.Insert(1, 8, 8, nullptr));
+    CommandList list;
+    list.DrawAtlasImage(0, 0, 8, 8, atlas, 1);
+    list.DrawAtlasImage(20, 0, 8, 8, atlas, 2); // not in there
+
+    OrderTarget target;
+    list.Replay(target);
+    REQUIRE((target.drawn == std::vector<CommandType>{CommandType::AtlasImage}));
+
+    atlas.Remove(1);
+    target.drawn.clear();
+    list.Replay(target);
+    REQUIRE(target.drawn.empty());
+}
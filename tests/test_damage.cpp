@@ -0,0 +1,114 @@
+#include <catch2/catch_test_macros.hpp>
+#include "gfx/Damage.hpp"
+
+#include <vector>
+
+using namespace mayak::gfx;
+
+namespace {
+    bool overlap(const ClipRect& a, const ClipRect& b) {
+        return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+    }
+
+    DamageTracker sized(int width, int height) {
+        DamageTracker damage;
+        damage.SetSize(width, height);
+        damage.Commit(); // the first size damages everything, start clean
+        return damage;
+    }
+}
+
+TEST_CASE("A caret only damages the caret", "[damage]") {
+    DamageTracker damage = sized(1920, 1080);
+    REQUIRE(damage.Empty());
+
+    damage.Add(ClipRect{400, 300, 2, 18});
+    REQUIRE(damage.Regions().size() == 1);
+    REQUIRE(damage.Area() == 36);
+    REQUIRE_FALSE(damage.IsFull());
+}
+
+TEST_CASE("Overlapping and neighbouring rects merge, far apart ones don't", "[damage]") {
+    DamageTracker damage = sized(800, 600);
+
+    damage.Add(ClipRect{10, 10, 50, 20});
+    damage.Add(ClipRect{40, 15, 50, 20}); // overlaps the first
+    REQUIRE(damage.Regions().size() == 1);
+    REQUIRE((damage.Regions()[0] == ClipRect{10, 10, 80, 25}));
+
+    damage.Add(ClipRect{90, 10, 30, 25}); // right next to it, same height: no waste
+    REQUIRE(damage.Regions().size() == 1);
+
+    damage.Add(ClipRect{700, 500, 20, 20}); // clock in the corner
+    REQUIRE(damage.Regions().size() == 2);
+
+    // Swallowed entirely
+    damage.Add(ClipRect{705, 505, 5, 5});
+    REQUIRE(damage.Regions().size() == 2);
+}
+
+TEST_CASE("Merging never leaves overlaps and stays under the limit", "[damage]") {
+    DamageTracker damage = sized(1000, 1000);
+    // A diagonal of small rects, then a bar across that hits several of them
+    for (int i = 0; i < 20; ++i) damage.Add(ClipRect{i * 45, i * 45, 10, 10});
+    damage.Add(ClipRect{0, 400, 1000, 5});
+
+    const auto& regions = damage.Regions();
+    REQUIRE(int(regions.size()) <= DamageTracker::MAX_REGIONS);
+    for (std::size_t a = 0; a < regions.size(); ++a)
+        for (std::size_t b = a + 1; b < regions.size(); ++b) REQUIRE_FALSE(overlap(regions[a], regions[b]));
+
+    // Every damaged pixel is still covered
+    for (int i = 0; i < 20; ++i) {
+        bool covered = false;
+        for (const ClipRect& region : regions)
+            covered |= region.x <= i * 45 && region.y <= i * 45 && region.x + region.width >= i * 45 + 10
+                    && region.y + region.height >= i * 45 + 10;
+        REQUIRE(covered);
+    }
+}
+
+TEST_CASE("Damage gets clamped and turns into everything when it's most of the window", "[damage]") {
+    DamageTracker damage = sized(800, 600);
+
+    damage.Add(ClipRect{-50, -50, 100, 100});
+    REQUIRE((damage.Regions()[0] == ClipRect{0, 0, 50, 50}));
+    damage.Add(ClipRect{900, 0, 10, 10});
+    REQUIRE(damage.Regions().size() == 1);
+
+    damage.Add(ClipRect{0, 0, 800, 500});
+    REQUIRE(damage.IsFull());
+    REQUIRE(damage.Regions().size() == 1);
+    REQUIRE((damage.Regions()[0] == ClipRect{0, 0, 800, 600}));
+
+    // A new size is all new pixels
+    damage.Commit();
+    damage.SetSize(1024, 768);
+    REQUIRE(damage.IsFull());
+}
+
+TEST_CASE("Buffer age picks up the damage the old buffer missed", "[damage]") {
+    DamageTracker damage = sized(800, 600);
+    std::vector<ClipRect> out;
+
+    damage.Add(ClipRect{0, 0, 10, 10});
+    damage.Commit();
+    damage.Add(ClipRect{100, 100, 10, 10});
+    damage.Commit();
+    damage.Add(ClipRect{200, 200, 10, 10});
+
+    damage.RegionsSince(1, out);
+    REQUIRE(out.size() == 1);
+    damage.RegionsSince(2, out);
+    REQUIRE(out.size() == 2);
+    damage.RegionsSince(3, out);
+    REQUIRE(out.size() == 3);
+
+    // 4 frames back is the size change, unknown is unknown
+    damage.RegionsSince(4, out);
+    REQUIRE((out.size() == 1 && out[0] == ClipRect{0, 0, 800, 600}));
+    damage.RegionsSince(0, out);
+    REQUIRE((out.size() == 1 && out[0] == ClipRect{0, 0, 800, 600}));
+    damage.RegionsSince(DamageTracker::HISTORY + 5, out);
+    REQUIRE((out.size() == 1 && out[0] == ClipRect{0, 0, 800, 600}));
+}
@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/FrameArena.hpp"
+
+#include <vector>
+
+using mayak::core::LinearArena;
+using mayak::core::ArenaResource;
+
+TEST_CASE("LinearArena respects alignment", "[arena]") {
+    LinearArena arena(1024);
+    arena.Allocate(1, 1);
+    void* aligned = arena.Allocate(16, 64);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(aligned) % 64 == 0);
+    REQUIRE(arena.Used() >= 17);
+}
+
+TEST_CASE("LinearArena stops allocating once it knows the frame size", "[arena]") {
+    LinearArena arena(256);
+    auto frame = [&] {
+        for (int i = 0; i < 100; ++i) arena.Allocate(48);
+        arena.Reset();
+    };
+
+    frame(); // needs more than 256 bytes, grows and merges
+    uint64_t warm = arena.BlockAllocations();
+    REQUIRE(arena.HighWater() >= 4800);
+
+    for (int i = 0; i < 10; ++i) frame();
+    REQUIRE(arena.BlockAllocations() == warm);
+    REQUIRE(arena.LastFrameUsed() >= 4800);
+}
+
+TEST_CASE("std::pmr containers live in the arena", "[arena]") {
+    LinearArena arena(64 * 1024);
+    ArenaResource resource(arena);
+    {
+        std::pmr::vector<int> values(&resource);
+        for (int i = 0; i < 1000; ++i) values.push_back(i);
+        REQUIRE(values[999] == 999);
+    }
+    REQUIRE(arena.Used() >= 1000 * sizeof(int));
+    REQUIRE(arena.BlockAllocations() == 1);
+}
@@ -0,0 +1,52 @@
+#include <catch2/catch_test_macros.hpp>
+#include "gfx/GLState.hpp"
+#include "test_helpers.hpp"
+
+using namespace mayak::gfx;
+
+TEST_CASE("Deleted shared objects leave every context's shadow", "[gl]") {
+    // No context in the tests, the shadow only needs the calls to go somewhere
+    mayak::test::FakeGL gl;
+    // A is the current one, nothing is current in the tests. B is never dereferenced, it only keys its shadow
+    int other = 0;
+    GLFWwindow* contextA = nullptr;
+    GLFWwindow* contextB = reinterpret_cast<GLFWwindow*>(&other);
+    GLState& a = State(contextA);
+    GLState& b = State(contextB);
+    REQUIRE(&a != &b);
+
+    for (GLState* state : {&a, &b}) {
+        state->UseProgram(5);
+        state->BindTexture(0, GL_TEXTURE_2D, 7);
+        state->BindBuffer(GL_ARRAY_BUFFER, 9);
+    }
+
+    // Deleted while A was current, the new objects got the same names
+    ForgetSharedProgram(5);
+    ForgetSharedTexture(7);
+    ForgetSharedBuffer(9);
+    REQUIRE(a.CurrentProgram() != 5);
+    REQUIRE(b.CurrentProgram() != 5);
+
+    // GL unbound them in A only, B still has the deleted names bound
+    uint64_t issuedA = a.Stats().issued, issuedB = b.Stats().issued;
+    for (GLState* state : {&a, &b}) {
+        state->BindTexture(0, GL_TEXTURE_2D, 0);
+        state->BindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    REQUIRE(a.Stats().issued == issuedA);
+    REQUIRE(b.Stats().issued == issuedB + 2);
+    issuedA = a.Stats().issued;
+    issuedB = b.Stats().issued;
+
+    for (GLState* state : {&a, &b}) {
+        state->UseProgram(5);
+        state->BindTexture(0, GL_TEXTURE_2D, 7);
+        state->BindBuffer(GL_ARRAY_BUFFER, 9);
+    }
+    REQUIRE(a.Stats().issued == issuedA + 3);
+    REQUIRE(b.Stats().issued == issuedB + 3); // B wasn't current, it still has to rebind
+
+    ForgetContext(contextA);
+    ForgetContext(contextB);
+}
@@ -0,0 +1,156 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "gfx/Batch.hpp"
+#include "gfx/GlyphCache.hpp"
+#include "core/Mainloop.hpp"
+#include "test_helpers.hpp"
+
+#include <string>
+
+using namespace mayak::gfx;
+
+using mayak::test::BoxRasterizer;
+using mayak::test::fake_context;
+
+TEST_CASE("Glyphs get rasterized once", "[text]") {
+    BoxRasterizer rasterizer;
+    GlyphCache cache(rasterizer);
+
+    const CachedGlyph& a = cache.Get(0, 16, 'A');
+    REQUIRE(a.drawable);
+    REQUIRE(a.region.width == 8);
+    cache.Get(0, 16, 'A');
+    REQUIRE(rasterizer.calls == 1);
+    REQUIRE(cache.Stats().hits == 1);
+
+    // Another size, font or subpixel step is another glyph
+    cache.Get(0, 17, 'A');
+    cache.Get(1, 16, 'A');
+    cache.Get(0, 16, 'A', 0.5f);
+    REQUIRE(rasterizer.calls == 4);
+    REQUIRE_FALSE(cache.Get(0, 16, ' ').drawable);
+}
+
+TEST_CASE("The glyph table grows and keeps everything", "[text]") {
+    BoxRasterizer rasterizer;
+    GlyphCache cache(rasterizer);
+    for (uint32_t codepoint = 0x400; codepoint < 0x400 + 3000; ++codepoint) cache.Get(0, 10, codepoint);
+    REQUIRE(cache.Count() == 3000);
+
+    int calls = rasterizer.calls;
+    for (uint32_t codepoint = 0x400; codepoint < 0x400 + 3000; ++codepoint) cache.Get(0, 10, codepoint);
+    REQUIRE(rasterizer.calls == calls);
+}
+
+TEST_CASE("Evicted glyphs come back", "[text]") {
+    BoxRasterizer rasterizer;
+    AtlasOptions options;
+    options.pageSize = 64;
+    options.maxPages = 1;
+    GlyphCache cache(rasterizer, options);
+
+    // One glyph a frame, what the previous frames drew may go
+    cache.Get(0, 32, 'A');
+    for (uint32_t codepoint = 'B'; codepoint < 'Z'; ++codepoint) {
+        mayak::core::_advance_frame_count();
+        cache.Get(0, 32, codepoint);
+    }
+    REQUIRE(cache.Atlas().Stats().evictions > 0);
+
+    mayak::core::_advance_frame_count();
+
+    // Whatever happened to A's region, what we get back is in the atlas right now
+    const CachedGlyph& a = cache.Get(0, 32, 'A');
+    REQUIRE(a.drawable);
+    REQUIRE(a.atlasGeneration == cache.Atlas().Generation());
+}
+
+TEST_CASE("Glyphs that don't fit this frame get drawn the next", "[text]") {
+    BoxRasterizer rasterizer;
+    AtlasOptions options;
+    options.pageSize = 64;
+    options.maxPages = 1;
+    GlyphCache cache(rasterizer, options);
+
+    // Six 32 px boxes fill the page, the frame's first glyphs must stay where they are
+    mayak::core::_advance_frame_count();
+    AtlasRegion first = cache.Get(0, 32, 'A').region;
+    for (uint32_t codepoint = 'B'; codepoint <= 'F'; ++codepoint) REQUIRE(cache.Get(0, 32, codepoint).drawable);
+    REQUIRE_FALSE(cache.Get(0, 32, 'G').drawable);
+    REQUIRE(cache.Get(0, 32, 'A').region.x == first.x);
+    REQUIRE(cache.Get(0, 32, 'A').region.y == first.y);
+    int calls = rasterizer.calls;
+    cache.Get(0, 32, 'G'); // same frame, no new attempt
+    REQUIRE(rasterizer.calls == calls);
+
+    mayak::core::_advance_frame_count();
+    const CachedGlyph& g = cache.Get(0, 32, 'G');
+    REQUIRE(g.drawable);
+    REQUIRE(g.atlasGeneration == cache.Atlas().Generation());
+}
+
+TEST_CASE("UTF-8 decoding", "[text]") {
+    std::string text = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\xC0\xAF";
+    std::size_t offset = 0;
+    REQUIRE(DecodeUtf8(text, offset) == 'a');
+    REQUIRE(DecodeUtf8(text, offset) == 0xE9);
+    REQUIRE(DecodeUtf8(text, offset) == 0x20AC);
+    REQUIRE(DecodeUtf8(text, offset) == 0x1F600);
+    REQUIRE(DecodeUtf8(text, offset) == 0xFFFD); // overlong '/'
+    REQUIRE(offset == text.size());
+
+    std::string cut = "\xE2\x82";
+    offset = 0;
+    REQUIRE(DecodeUtf8(cut, offset) == 0xFFFD);
+}
+
+TEST_CASE("Text layout and drawing", "[text]") {
+    BoxRasterizer rasterizer;
+    GlyphCache cache(rasterizer);
+    RendererContext ctx = fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    // 4 glyphs + a space, 8.8 px each
+    float width = cache.MeasureText(0, 16, "ab cd");
+    REQUIRE(width > 43.9f);
+    REQUIRE(width < 44.1f);
+    float widest = cache.MeasureText(0, 16, "abc\nab");
+    REQUIRE(widest > 26.3f);
+    REQUIRE(widest < 26.5f);
+
+    cache.DrawText(batch, 0, 16, 10, 20, "hello world", PackColor(255, 255, 255));
+    REQUIRE(batch.PendingQuads() == 10);
+    REQUIRE(batch.PendingRuns() == 1);
+    batch.Discard();
+}
+
+TEST_CASE("Text drawing", "[text][!benchmark]") {
+    BoxRasterizer rasterizer;
+    GlyphCache cache(rasterizer);
+    RendererContext ctx = fake_context();
+    QuadBatch batch(ctx);
+
+    // A screen full: 200 lines of 100 characters
+    std::string line = "The quick brown fox jumps over the lazy dog, 0123456789 times! Pack my box with five dozen jugs ok.";
+    std::string screen;
+    for (int i = 0; i < 200; ++i) screen += line + "\n";
+
+    // Warm-up, everything after this is a cache hit
+    batch.Begin(1920, 1080);
+    cache.DrawText(batch, 0, 14, 0, 14, line, PackColor(255, 255, 255));
+    batch.Discard();
+
+    BENCHMARK("20k glyphs") {
+        batch.Begin(1920, 1080);
+        // 16k quads is a full batch, draw in halves so nothing gets flushed to the (missing) GPU
+        std::string_view all(screen);
+        std::size_t half = all.size() / 2;
+        cache.DrawText(batch, 0, 14, 0, 14, all.substr(0, half), PackColor(255, 255, 255));
+        batch.Discard();
+        cache.DrawText(batch, 0, 14, 0, 14, all.substr(half), PackColor(255, 255, 255));
+        int quads = batch.PendingQuads();
+        batch.Discard();
+        return quads;
+    };
+}
@@ -0,0 +1,171 @@
+// test_helpers.hpp
+
+// Fakes the tests share: glyphs that are plain boxes, a renderer context with
+// made-up GL names, and GL calls that go nowhere for code that sets state or
+// draws without a context.
+
+#pragma once
+#include "gfx/GlyphCache.hpp"
+#include "gfx/Renderer.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace mayak::test {
+
+    /// @brief Every glyph is a solid box, so where the text went is easy to check
+    ///
+    /// By default size / 2 wide, 0.7 size tall, one pixel right of the pen and
+    /// a fractional advance (0.55 size) so subpixel steps show up. ' ' is empty.
+    class BoxRasterizer : public gfx::GlyphRasterizer {
+    public:
+        BoxRasterizer() = default;
+        BoxRasterizer(float advance, float height, int bearingX)
+            : advance(advance), height(height), bearingX(bearingX) {}
+
+        int calls = 0;
+        float lastSize = 0;
+
+        gfx::FontMetrics Metrics(gfx::FontId, float size) override {
+            return gfx::FontMetrics{size * 0.8f, size * 0.2f, size * 0.1f};
+        }
+
+        bool Rasterize(gfx::FontId, float size, uint32_t codepoint, float, gfx::GlyphBitmap& out) override {
+            ++calls;
+            lastSize = size;
+            out.advance = size * advance;
+            if (codepoint == ' ') return true;
+            out.width = int(size / 2);
+            out.height = int(size * height);
+            out.bearingX = bearingX;
+            out.bearingY = out.height;
+            out.pixels.assign(std::size_t(out.width * out.height), 255);
+            return true;
+        }
+
+    private:
+        float advance = 0.55f, height = 0.7f; // times the size
+        int bearingX = 1;
+    };
+
+    namespace fake_gl {
+        /// What glBlendFuncSeparate() got, in order
+        inline std::vector<std::array<GLenum, 4>> blendFuncs;
+        /// Where mapped buffer ranges point, plain memory
+        inline std::vector<uint8_t> mapped;
+        inline GLuint lastName = 0;
+
+        inline void APIENTRY use_program(GLuint) {}
+        inline void APIENTRY active_texture(GLenum) {}
+        inline void APIENTRY bind_texture(GLenum, GLuint) {}
+        inline void APIENTRY bind_buffer(GLenum, GLuint) {}
+        inline void APIENTRY capability(GLenum) {}
+        inline void APIENTRY stencil_mask(GLuint) {}
+        inline void APIENTRY stencil_func(GLenum, GLint, GLuint) {}
+        inline void APIENTRY stencil_op(GLenum, GLenum, GLenum) {}
+        inline void APIENTRY color_mask(GLboolean, GLboolean, GLboolean, GLboolean) {}
+        inline void APIENTRY clear_stencil(GLint) {}
+        inline void APIENTRY clear(GLbitfield) {}
+        inline void APIENTRY blend_func(GLenum srcRgb, GLenum dstRgb, GLenum srcAlpha, GLenum dstAlpha) {
+            blendFuncs.push_back({srcRgb, dstRgb, srcAlpha, dstAlpha});
+        }
+        inline void APIENTRY scissor(GLint, GLint, GLsizei, GLsizei) {}
+        inline void APIENTRY gen_names(GLsizei count, GLuint* names) {
+            for (GLsizei i = 0; i < count; ++i) names[i] = ++lastName;
+        }
+        inline void APIENTRY delete_names(GLsizei, const GLuint*) {}
+        inline void APIENTRY buffer_data(GLenum, GLsizeiptr, const void*, GLenum) {}
+        inline void* APIENTRY map_buffer_range(GLenum, GLintptr offset, GLsizeiptr length, GLbitfield) {
+            if (mapped.size() < std::size_t(offset + length)) mapped.resize(std::size_t(offset + length));
+            return mapped.data() + offset;
+        }
+        inline GLboolean APIENTRY unmap_buffer(GLenum) { return GL_TRUE; }
+        inline GLint APIENTRY uniform_location(GLuint, const GLchar*) { return 0; }
+        inline void APIENTRY uniform_1f(GLint, GLfloat) {}
+        inline void APIENTRY uniform_4f(GLint, GLfloat, GLfloat, GLfloat, GLfloat) {}
+        inline void APIENTRY uniform_4fv(GLint, GLsizei, const GLfloat*) {}
+        inline void APIENTRY bind_vertex_array(GLuint) {}
+        inline void APIENTRY enable_attribute(GLuint) {}
+        inline void APIENTRY attribute_pointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+        inline void APIENTRY attribute_integer_pointer(GLuint, GLint, GLenum, GLsizei, const void*) {}
+        inline void APIENTRY attribute_divisor(GLuint, GLuint) {}
+        inline void APIENTRY draw_elements(GLenum, GLsizei, GLenum, const void*, GLint) {}
+        inline void APIENTRY draw_instanced(GLenum, GLint, GLsizei, GLsizei) {}
+    }
+
+    /// @brief Swaps the GL calls the batch makes for ones that do nothing while it's alive
+    ///
+    /// Enough for GLState, the batch's stencil clips and its draws. The fake context's
+    /// stream buffer can't map, so flushes drop their runs, unless it got a fake_vertex_stream().
+    struct FakeGL {
+        FakeGL() {
+            fake_gl::blendFuncs.clear();
+            Fake(glad_glUseProgram, fake_gl::use_program);
+            Fake(glad_glActiveTexture, fake_gl::active_texture);
+            Fake(glad_glBindTexture, fake_gl::bind_texture);
+            Fake(glad_glBindBuffer, fake_gl::bind_buffer);
+            Fake(glad_glEnable, fake_gl::capability);
+            Fake(glad_glDisable, fake_gl::capability);
+            Fake(glad_glStencilMask, fake_gl::stencil_mask);
+            Fake(glad_glStencilFunc, fake_gl::stencil_func);
+            Fake(glad_glStencilOp, fake_gl::stencil_op);
+            Fake(glad_glColorMask, fake_gl::color_mask);
+            Fake(glad_glClearStencil, fake_gl::clear_stencil);
+            Fake(glad_glClear, fake_gl::clear);
+            Fake(glad_glBlendFuncSeparate, fake_gl::blend_func);
+            Fake(glad_glScissor, fake_gl::scissor);
+            Fake(glad_glGenBuffers, fake_gl::gen_names);
+            Fake(glad_glGenVertexArrays, fake_gl::gen_names);
+            Fake(glad_glDeleteBuffers, fake_gl::delete_names);
+            Fake(glad_glBufferData, fake_gl::buffer_data);
+            Fake(glad_glMapBufferRange, fake_gl::map_buffer_range);
+            Fake(glad_glUnmapBuffer, fake_gl::unmap_buffer);
+            Fake(glad_glGetUniformLocation, fake_gl::uniform_location);
+            Fake(glad_glUniform1f, fake_gl::uniform_1f);
+            Fake(glad_glUniform4f, fake_gl::uniform_4f);
+            Fake(glad_glUniform4fv, fake_gl::uniform_4fv);
+            Fake(glad_glBindVertexArray, fake_gl::bind_vertex_array);
+            Fake(glad_glEnableVertexAttribArray, fake_gl::enable_attribute);
+            Fake(glad_glVertexAttribPointer, fake_gl::attribute_pointer);
+            Fake(glad_glVertexAttribIPointer, fake_gl::attribute_integer_pointer);
+            Fake(glad_glVertexAttribDivisor, fake_gl::attribute_divisor);
+            Fake(glad_glDrawElementsBaseVertex, fake_gl::draw_elements);
+            Fake(glad_glDrawArraysInstanced, fake_gl::draw_instanced);
+        }
+        ~FakeGL() {
+            for (auto it = restore.rbegin(); it != restore.rend(); ++it) (*it)();
+        }
+
+        FakeGL(const FakeGL&) = delete;
+        FakeGL& operator=(const FakeGL&) = delete;
+
+    private:
+        template <typename Function>
+        void Fake(Function& pointer, Function fake) {
+            restore.push_back([&pointer, original = pointer] { pointer = original; });
+            pointer = fake;
+        }
+
+        std::vector<std::function<void()>> restore;
+    };
+
+    /// @brief Program and texture names nothing ever binds, every program the batch picks from is set
+    inline gfx::RendererContext fake_context() {
+        gfx::RendererContext ctx;
+        ctx.shaderProgram = 1;
+        ctx.whiteTexture = 2;
+        ctx.roundedRectProgram = 3;
+        ctx.atlasProgram = 4;
+        ctx.distanceFieldProgram = 5;
+        return ctx;
+    }
+
+    /// @brief Gives ctx a stream buffer that maps plain memory, so its flushes get to the draws.
+    /// Needs a FakeGL alive
+    inline void fake_vertex_stream(gfx::RendererContext& ctx) {
+        ctx.vertexStream.Create(GL_ARRAY_BUFFER, 1 << 16);
+    }
+}
@@ -0,0 +1,50 @@
+#include <catch2/catch_test_macros.hpp>
+#include "event/Input.hpp"
+
+using namespace mayak::core::input;
+
+TEST_CASE("Pointer samples are kept per frame", "[input]") {
+    _begin_pointer_frame();
+    _push_pointer_sample(1.5f, 2.0f, 1'000'000);
+    _push_pointer_sample(3.0f, 4.0f, 2'000'000);
+
+    REQUIRE(pointer_sample_count() == 2);
+    REQUIRE(pointer_sample(0).x == 1.5f);
+    REQUIRE(pointer_sample(1).timeNs == 2'000'000);
+    REQUIRE(pointer_sample(2).timeNs == 0); // out of range
+    REQUIRE(mouse_x() == 3);
+
+    _begin_pointer_frame();
+    REQUIRE(pointer_sample_count() == 0);
+}
+
+TEST_CASE("Pointer ring overwrites the oldest samples", "[input]") {
+    _begin_pointer_frame();
+    for (std::size_t i = 0; i < POINTER_HISTORY_SIZE + 10; ++i)
+        _push_pointer_sample(static_cast<float>(i), 0, static_cast<int64_t>(i) * 1000);
+
+    REQUIRE(pointer_sample_count() == POINTER_HISTORY_SIZE);
+    REQUIRE(pointer_sample(0).x == 10.0f);
+}
+
+TEST_CASE("Pointer prediction extrapolates linear motion", "[input]") {
+    _begin_pointer_frame();
+    // 1000 px/s to the right, one sample every 4 ms, well after the
+    // samples of the other tests so they don't count into the velocity
+    const int64_t start = 10'000'000'000;
+    for (int i = 0; i < 5; ++i)
+        _push_pointer_sample(100.0f + i * 4.0f, 50.0f, start + i * 4'000'000);
+
+    mayak::vec2 v = pointer_velocity();
+    REQUIRE(v.x > 999.0f);
+    REQUIRE(v.x < 1001.0f);
+
+    // newest sample is at +16 ms / x = 116, present 16 ms later
+    mayak::vec2 p = predict_pointer(start + 32'000'000);
+    REQUIRE(p.x > 131.9f);
+    REQUIRE(p.x < 132.1f);
+    REQUIRE(p.y == 50.0f);
+
+    // pointer went quiet, no prediction
+    REQUIRE(predict_pointer(start + 1'000'000'000).x == 116.0f);
+}
@@ -0,0 +1,71 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "core/Jobs.hpp"
+
+#include <cmath>
+#include <string>
+
+using namespace mayak::core;
+
+TEST_CASE("ParallelFor covers every index exactly once", "[jobs]") {
+    JobSystem jobs(JobSystemOptions{4, false});
+    std::vector<std::atomic<int>> hits(100000);
+
+    jobs.ParallelFor(0, hits.size(), 0, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) hits[i]++;
+    });
+
+    bool once = true;
+    for (auto& h : hits) once = once && h == 1;
+    REQUIRE(once);
+}
+
+TEST_CASE("Jobs run after their dependencies", "[jobs]") {
+    JobSystem jobs(JobSystemOptions{3, false});
+    std::atomic<int> step{0};
+    int seenByC = -1;
+
+    JobHandle a = jobs.Run([&] { step++; });
+    JobHandle b = jobs.Run([&] { step++; });
+    JobHandle c = jobs.Run([&] { seenByC = step; }, {a, b});
+    jobs.Wait(c);
+
+    REQUIRE(seenByC == 2);
+    REQUIRE(a.Done());
+}
+
+TEST_CASE("Nested fork/join doesn't deadlock", "[jobs]") {
+    JobSystem jobs(JobSystemOptions{2, false});
+    std::function<long(int)> fib = [&](int n) -> long {
+        if (n < 12) return n < 2 ? n : fib(n - 1) + fib(n - 2);
+        long x = 0, y = 0;
+        jobs.Invoke([&] { x = fib(n - 1); }, [&] { y = fib(n - 2); });
+        return x + y;
+    };
+    REQUIRE(fib(24) == 46368);
+}
+
+TEST_CASE("Zero workers still runs everything", "[jobs]") {
+    JobSystem jobs(JobSystemOptions{0, false});
+    int value = 0;
+    jobs.Wait(jobs.Run([&] { value = 42; }));
+    REQUIRE(value == 42);
+}
+
+TEST_CASE("Job system scaling", "[jobs][!benchmark]") {
+    // Something like measuring a lot of text runs: independent, uneven chunks of math
+    std::vector<float> data(1 << 20);
+    auto work = [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i)
+            data[i] = std::sqrt(static_cast<float>(i)) * std::sin(static_cast<float>(i));
+    };
+
+    unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= hardware; threads *= 2) {
+        JobSystem jobs(JobSystemOptions{static_cast<int>(threads) - 1, false});
+        BENCHMARK("ParallelFor, " + std::to_string(threads) + " threads") {
+            jobs.ParallelFor(0, data.size(), 0, work);
+            return data[12345];
+        };
+    }
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+#include "gfx/ProgramCache.hpp"
+
+#include <filesystem>
+#include <iterator>
+#include <fstream>
+
+using namespace mayak::gfx;
+namespace fs = std::filesystem;
+
+namespace {
+    // Fresh directory per test, gone afterwards
+    struct TempDirectory {
+        fs::path path;
+        explicit TempDirectory(const char* name) : path(fs::temp_directory_path() / name) {
+            fs::remove_all(path);
+        }
+        ~TempDirectory() { fs::remove_all(path); }
+    };
+
+    ProgramBinary some_binary() {
+        ProgramBinary binary;
+        binary.format = 0x8E7D;
+        binary.compileNs = 12'000'000;
+        for (int i = 0; i < 1000; ++i) binary.data.push_back(uint8_t(i * 7));
+        return binary;
+    }
+}
+
+TEST_CASE("Program cache keys cover sources, defines and driver", "[shaders]") {
+    uint64_t key = ProgramBinaryCache::Key("vs", "fs", "", "vendor|gpu|4.6");
+    REQUIRE(key == ProgramBinaryCache::Key("vs", "fs", "", "vendor|gpu|4.6"));
+    REQUIRE(key != ProgramBinaryCache::Key("vs2", "fs", "", "vendor|gpu|4.6"));
+    REQUIRE(key != ProgramBinaryCache::Key("vs", "fs2", "", "vendor|gpu|4.6"));
+    REQUIRE(key != ProgramBinaryCache::Key("vs", "fs", "#define SDF 1", "vendor|gpu|4.6"));
+    REQUIRE(key != ProgramBinaryCache::Key("vs", "fs", "", "vendor|gpu|4.6.1"));
+    // Text moving between parts is a different program
+    REQUIRE(ProgramBinaryCache::Key("ab", "c", "", "") != ProgramBinaryCache::Key("a", "bc", "", ""));
+}
+
+TEST_CASE("Program binaries round trip through the cache", "[shaders]") {
+    TempDirectory dir("mayak_program_cache_roundtrip");
+    ProgramBinaryCache cache((dir.path / "nested" / "shaders").string());
+
+    ProgramBinary loaded;
+    REQUIRE_FALSE(cache.Load(42, loaded));
+
+    REQUIRE(cache.Store(42, some_binary())); // makes the directories too
+    REQUIRE(cache.Load(42, loaded));
+    REQUIRE(loaded.format == 0x8E7D);
+    REQUIRE(loaded.compileNs == 12'000'000);
+    REQUIRE(loaded.data == some_binary().data);
+    REQUIRE(std::distance(fs::directory_iterator(fs::path(cache.Path(42)).parent_path()),
+                          fs::directory_iterator()) == 1); // no temporary left behind
+
+    cache.Remove(42);
+    REQUIRE_FALSE(cache.Load(42, loaded));
+}
+
+TEST_CASE("Broken program binaries are dropped", "[shaders]") {
+    TempDirectory dir("mayak_program_cache_broken");
+    ProgramBinaryCache cache(dir.path.string());
+    REQUIRE(cache.Store(7, some_binary()));
+
+    SECTION("flipped byte") {
+        std::fstream file(cache.Path(7), std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(-10, std::ios::end);
+        file.put('\xAA');
+    }
+    SECTION("cut short") {
+        fs::resize_file(cache.Path(7), fs::file_size(cache.Path(7)) - 100);
+    }
+    SECTION("under another key's name") {
+        fs::rename(cache.Path(7), cache.Path(8));
+        ProgramBinary loaded;
+        REQUIRE_FALSE(cache.Load(8, loaded));
+        REQUIRE_FALSE(fs::exists(cache.Path(8)));
+        return;
+    }
+
+    ProgramBinary loaded;
+    REQUIRE_FALSE(cache.Load(7, loaded));
+    REQUIRE(loaded.data.empty());
+    REQUIRE_FALSE(fs::exists(cache.Path(7)));
+}
@@ -0,0 +1,39 @@
+#include <catch2/catch_test_macros.hpp>
+#include "gfx/ScaleCache.hpp"
+
+using namespace mayak::gfx;
+
+namespace {
+    ScaledResource fake_rasterize(uint64_t, float scale) {
+        ScaledResource r;
+        r.width = r.height = static_cast<int>(16 * scale);
+        r.bytes = static_cast<std::size_t>(r.width * r.height * 4);
+        return r;
+    }
+}
+
+TEST_CASE("Scales round into quarter buckets", "[gfx]") {
+    REQUIRE(ScaleToBucket(1.0f) == 4);
+    REQUIRE(ScaleToBucket(1.1f) == 4);
+    REQUIRE(ScaleToBucket(2.0f) == 8);
+    REQUIRE(BucketToScale(5) == 1.25f);
+}
+
+TEST_CASE("ScaleCache rasterizes once per bucket and accounts memory", "[gfx]") {
+    int released = 0;
+    ScaleCache cache(fake_rasterize, [&](ScaledResource&) { ++released; });
+
+    REQUIRE(cache.Get(1, 1.0f).width == 16);
+    REQUIRE(cache.Get(1, 1.05f).width == 16); // same bucket, cache hit
+    REQUIRE(cache.Get(1, 2.0f).width == 32);
+    REQUIRE(cache.Hits() == 1);
+    REQUIRE(cache.Misses() == 2);
+    REQUIRE(cache.BytesAt(4) == 16 * 16 * 4);
+    REQUIRE(cache.BytesUsed() == 16 * 16 * 4 + 32 * 32 * 4);
+
+    // The window moved to the 2x monitor, 1x isn't needed anymore
+    cache.RetainScales({8});
+    REQUIRE(released == 1);
+    REQUIRE(cache.BytesAt(4) == 0);
+    REQUIRE(cache.BytesUsed() == 32 * 32 * 4);
+}
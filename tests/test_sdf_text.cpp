@@ -0,0 +1,158 @@
+#include <catch2/catch_test_macros.hpp>
+#include "gfx/Batch.hpp"
+#include "gfx/SdfText.hpp"
+#include "core/Mainloop.hpp"
+#include "test_helpers.hpp"
+
+#include <cstdlib>
+
+using namespace mayak::gfx;
+
+using mayak::test::BoxRasterizer;
+using mayak::test::fake_context;
+
+namespace {
+    // Square boxes, bearing 0 and half an em of advance keep the numbers round
+    BoxRasterizer square_boxes() {
+        return BoxRasterizer(0.5f, 0.5f, 0);
+    }
+}
+
+TEST_CASE("Distance fields of a box", "[text]") {
+    GlyphBitmap box;
+    box.width = box.height = 20;
+    box.pixels.assign(400, 255);
+
+    GlyphBitmap field;
+    BuildDistanceField(box, 1, 4, field);
+    REQUIRE(field.width == 28);
+    REQUIRE(field.height == 28);
+
+    auto at = [&](int x, int y) { return int(field.pixels[std::size_t(y) * field.width + x]); };
+    REQUIRE(at(14, 14) == 255); // deeper than the spread
+    REQUIRE(at(0, 0) == 0);
+
+    // Half a pixel either side of the edge: 0.5 +- 0.5 / (2 * spread)
+    REQUIRE(std::abs(at(4, 14) - 143) <= 1);
+    REQUIRE(std::abs(at(3, 14) - 112) <= 1);
+    // Symmetric, and growing towards the inside
+    REQUIRE(at(4, 14) == at(23, 14));
+    REQUIRE(at(14, 4) == at(4, 14));
+    REQUIRE(at(2, 14) < at(3, 14));
+    REQUIRE(at(5, 14) > at(4, 14));
+
+    // Oversampling averages back down to the same size
+    GlyphBitmap big = box;
+    big.width = big.height = 40;
+    big.pixels.assign(1600, 255);
+    BuildDistanceField(big, 2, 4, field);
+    REQUIRE(field.width == 28);
+    REQUIRE(std::abs(at(4, 14) - 143) <= 2);
+}
+
+TEST_CASE("Distance field glyphs get made on workers", "[text]") {
+    mayak::core::JobSystemOptions options;
+    options.workers = 0; // nothing runs until we wait, keeps it deterministic
+    mayak::core::JobSystem jobs(options);
+    BoxRasterizer rasterizer = square_boxes();
+    SdfOptions sdf;
+    sdf.referenceSize = 32;
+    sdf.spread = 4;
+    sdf.oversample = 2;
+    SdfGlyphCache cache(rasterizer, sdf, &jobs);
+
+    // First ask queues it, nothing blocks
+    REQUIRE(cache.Get(0, 'A') == nullptr);
+    REQUIRE(cache.Get(0, 'A') == nullptr);
+    REQUIRE(cache.Pending() == 1);
+    REQUIRE(rasterizer.calls == 0);
+
+    cache.WaitIdle();
+    REQUIRE(cache.Pending() == 0);
+    const SdfGlyph* glyph = cache.Get(0, 'A');
+    REQUIRE(glyph);
+    REQUIRE(glyph->drawable);
+    REQUIRE(rasterizer.calls == 1);
+    REQUIRE(rasterizer.lastSize == 64);
+    // 16 reference pixels of box and the spread around it
+    REQUIRE(glyph->width == 24);
+    REQUIRE(glyph->advance == 16);
+    REQUIRE(glyph->bearingX == -4);
+    REQUIRE(glyph->bearingY == 20);
+
+    cache.Get(0, ' ');
+    cache.WaitIdle();
+    REQUIRE(cache.Get(0, ' '));
+    REQUIRE_FALSE(cache.Get(0, ' ')->drawable);
+}
+
+TEST_CASE("Distance field text scales without new glyphs", "[text]") {
+    mayak::core::JobSystemOptions options;
+    options.workers = 0;
+    mayak::core::JobSystem jobs(options);
+    BoxRasterizer rasterizer = square_boxes();
+    SdfOptions sdf;
+    sdf.referenceSize = 32;
+    sdf.spread = 4;
+    sdf.oversample = 1;
+    SdfGlyphCache cache(rasterizer, sdf, &jobs);
+    RendererContext ctx = fake_context();
+    QuadBatch batch(ctx);
+    batch.Begin(800, 600);
+
+    // Not there yet: skipped, takes no room
+    REQUIRE(cache.DrawText(batch, 0, 32, 0, 50, "ab", PackColor(255, 255, 255)) == 0);
+    REQUIRE(batch.PendingQuads() == 0);
+    REQUIRE(cache.Stats().skippedDraws == 2);
+
+    cache.WaitIdle();
+    for (float size : { 8.0f, 32.0f, 100.0f, 333.3f }) {
+        float width = cache.DrawText(batch, 0, size, 0, 50, "ab", PackColor(255, 255, 255));
+        REQUIRE(std::abs(width - size) < 1e-3f); // two advances of half an em
+    }
+    REQUIRE(rasterizer.calls == 2);
+    REQUIRE(batch.PendingQuads() == 8);
+    REQUIRE(batch.PendingRuns() == 1);
+
+    // A style is uniforms, a new one breaks the run and the old one comes back for free
+    SdfTextStyle outlined;
+    outlined.outline = 2;
+    cache.DrawText(batch, 0, 32, 0, 50, "a", PackColor(255, 255, 255), outlined);
+    cache.DrawText(batch, 0, 32, 0, 50, "a", PackColor(255, 255, 255), outlined);
+    cache.DrawText(batch, 0, 32, 0, 50, "a", PackColor(255, 255, 255));
+    REQUIRE(batch.PendingRuns() == 3);
+    batch.Discard();
+    REQUIRE(cache.Metrics(0, 64).ascent == 64 * 0.8f);
+}
+
+TEST_CASE("Distance fields the full atlas refused come in the next frame", "[text]") {
+    mayak::core::JobSystemOptions options;
+    options.workers = 0;
+    mayak::core::JobSystem jobs(options);
+    BoxRasterizer rasterizer = square_boxes();
+    SdfOptions sdf;
+    sdf.referenceSize = 32;
+    sdf.spread = 4;
+    sdf.oversample = 1;
+    sdf.atlas.pageSize = 64;
+    sdf.atlas.maxPages = 1;
+    SdfGlyphCache cache(rasterizer, sdf, &jobs);
+
+    // 24 px fields with padding, four fit the page
+    mayak::core::_advance_frame_count();
+    cache.Prefetch(0, "abcdef");
+    cache.WaitIdle();
+    REQUIRE(cache.Get(0, 'a'));
+    AtlasRegion a = cache.Get(0, 'a')->region;
+    REQUIRE(cache.Pending() == 2);
+    REQUIRE(cache.Get(0, 'f') == nullptr);
+    REQUIRE(cache.Update() == 0); // same frame, still no room
+    REQUIRE(cache.Get(0, 'a')->region.x == a.x);
+
+    mayak::core::_advance_frame_count();
+    REQUIRE(cache.Update() == 2);
+    REQUIRE(cache.Pending() == 0);
+    REQUIRE(cache.Get(0, 'f'));
+    REQUIRE(cache.Get(0, 'f')->drawable);
+    REQUIRE(rasterizer.calls == 6); // waited, didn't get made twice
+}
@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+#include "gfx/ShaderVariants.hpp"
+
+using namespace mayak::gfx;
+
+TEST_CASE("Shader features that mean the same thing share a variant", "[shaders]") {
+    REQUIRE(ShaderVariants::Normalize(0) == 0);
+    REQUIRE(ShaderVariants::Normalize(FEATURE_TEXTURED | FEATURE_GRADIENT) == (FEATURE_TEXTURED | FEATURE_GRADIENT));
+
+    // An array is textured already, and distance fields always come from the atlas
+    REQUIRE(ShaderVariants::Normalize(FEATURE_TEXTURED | FEATURE_TEXTURE_ARRAY) == FEATURE_TEXTURE_ARRAY);
+    REQUIRE(ShaderVariants::Normalize(FEATURE_DISTANCE_FIELD) == (FEATURE_DISTANCE_FIELD | FEATURE_TEXTURE_ARRAY));
+    REQUIRE(ShaderVariants::Normalize(FEATURE_DISTANCE_FIELD | FEATURE_TEXTURED)
+            == ShaderVariants::Normalize(FEATURE_DISTANCE_FIELD));
+
+    // Bits past the known features can't index past the table
+    REQUIRE(ShaderVariants::Normalize(0xFFFFFFFFu) < SHADER_VARIANT_COUNT);
+}
+
+TEST_CASE("Shader variant defines", "[shaders]") {
+    REQUIRE(ShaderVariants::Defines(0).empty());
+    REQUIRE(ShaderVariants::Defines(FEATURE_TEXTURED) == "#define TEXTURED 1\n");
+    REQUIRE(ShaderVariants::Defines(FEATURE_CLIP_MASK | FEATURE_PREMULTIPLIED)
+            == "#define CLIP_MASK 1\n#define PREMULTIPLIED 1\n");
+    REQUIRE(ShaderVariants::Defines(FEATURE_DISTANCE_FIELD) == "#define TEXTURE_ARRAY 1\n#define DISTANCE_FIELD 1\n");
+
+    // Every combination has its own define block, so its own cache key
+    for (uint32_t a = 0; a < SHADER_VARIANT_COUNT; ++a) {
+        for (uint32_t b = a + 1; b < SHADER_VARIANT_COUNT; ++b) {
+            bool same = ShaderVariants::Normalize(a) == ShaderVariants::Normalize(b);
+            REQUIRE(same == (ShaderVariants::Defines(a) == ShaderVariants::Defines(b)));
+        }
+    }
+}
+
+TEST_CASE("Shader variants without a GL context", "[shaders]") {
+    ShaderVariants variants("", "", "empty");
+    REQUIRE(variants.Count() == 0);
+    REQUIRE_FALSE(variants.Ready(FEATURE_TEXTURED));
+    // No shared context to warm on
+    REQUIRE_FALSE(variants.Warm({ FEATURE_TEXTURED }));
+    REQUIRE_FALSE(variants.Warming());
+}
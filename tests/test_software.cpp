@@ -0,0 +1,213 @@
+#include <catch2/catch_test_macros.hpp>
+#include "gfx/Software.hpp"
+#include "core/Jobs.hpp"
+#include "test_helpers.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace mayak::gfx;
+using mayak::core::JobSystem;
+using mayak::core::JobSystemOptions;
+
+namespace {
+    constexpr uint32_t BLACK = PackColor(0, 0, 0);
+
+    /// A serial renderer and a cleared framebuffer to draw into
+    struct Canvas {
+        JobSystem jobs{JobSystemOptions{0, false}};
+        SoftwareRenderer renderer{&jobs};
+        SoftwareFramebuffer framebuffer;
+
+        Canvas(int width, int height, uint32_t background = BLACK) {
+            framebuffer.Resize(width, height);
+            framebuffer.Clear(background);
+        }
+
+        void Render(CommandList& list) { renderer.Render(list, framebuffer); }
+        uint32_t Pixel(int x, int y) const { return framebuffer.Pixel(x, y); }
+    };
+
+    /// What GL's blending gives for src over dst, one channel at a time
+    uint32_t reference_blend(uint32_t dst, uint32_t src) {
+        uint32_t alpha = src >> 24, out = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint32_t s = i == 3 ? 255 : (src >> (i * 8)) & 0xFF, d = (dst >> (i * 8)) & 0xFF;
+            out |= uint32_t((s * alpha + d * (255 - alpha)) / 255.0 + 0.5) << (i * 8);
+        }
+        return out;
+    }
+
+    RoundedRectInstance rounded(float x, float y, float size, float radius, uint32_t fill,
+                                uint32_t border = 0, float borderWidth = 0) {
+        return RoundedRectInstance{x, y, size, size, {radius, radius, radius, radius}, fill, border, borderWidth, 0};
+    }
+}
+
+TEST_CASE("Rects cover the pixel centers inside them", "[software]") {
+    Canvas canvas(100, 100);
+
+    CommandList list;
+    list.DrawRect(10.4f, 10, 10, 10, PackColor(255, 0, 0)); // centers 10.5 .. 19.5
+    list.DrawRect(30.6f, 10, 10, 10, PackColor(0, 255, 0)); // centers 31.5 .. 40.5
+    canvas.Render(list);
+
+    REQUIRE(canvas.Pixel(9, 10) == BLACK);
+    REQUIRE(canvas.Pixel(10, 10) == PackColor(255, 0, 0));
+    REQUIRE(canvas.Pixel(19, 19) == PackColor(255, 0, 0));
+    REQUIRE(canvas.Pixel(20, 10) == BLACK);
+    REQUIRE(canvas.Pixel(30, 10) == BLACK);
+    REQUIRE(canvas.Pixel(31, 10) == PackColor(0, 255, 0));
+    REQUIRE(canvas.Pixel(40, 10) == PackColor(0, 255, 0));
+    REQUIRE(canvas.Pixel(19, 20) == BLACK);
+    REQUIRE(canvas.renderer.Stats().primitives == 2);
+}
+
+TEST_CASE("Span blending matches GL's blend function", "[software]") {
+    Canvas canvas(37, 3); // not a multiple of 4 or 8, the tails go through the scalar code
+    uint32_t* pixels = canvas.framebuffer.Pixels();
+    for (int x = 0; x < 37; ++x)
+        for (int y = 0; y < 3; ++y)
+            pixels[y * 37 + x] = PackColor(uint8_t(x * 7), uint8_t(255 - x * 5), uint8_t(y * 90), uint8_t(x * 3));
+    std::vector<uint32_t> before(pixels, pixels + 37 * 3);
+
+    uint32_t color = PackColor(200, 100, 50, 77);
+    CommandList list;
+    list.DrawRect(0, 0, 37, 3, color);
+    canvas.Render(list);
+
+    for (int i = 0; i < 37 * 3; ++i) REQUIRE(pixels[i] == reference_blend(before[i], color));
+}
+
+TEST_CASE("Clips cut primitives off", "[software]") {
+    Canvas canvas(100, 100);
+
+    CommandList list;
+    list.PushClip(ClipRect{20, 30, 10, 5});
+    list.DrawRect(0, 0, 100, 100, PackColor(0, 0, 255));
+    list.PopClip();
+    list.DrawRect(90, 90, 50, 50, PackColor(255, 255, 255)); // off the edge
+    canvas.Render(list);
+
+    REQUIRE(canvas.Pixel(20, 30) == PackColor(0, 0, 255));
+    REQUIRE(canvas.Pixel(29, 34) == PackColor(0, 0, 255));
+    REQUIRE(canvas.Pixel(19, 30) == BLACK);
+    REQUIRE(canvas.Pixel(30, 30) == BLACK);
+    REQUIRE(canvas.Pixel(20, 35) == BLACK);
+    REQUIRE(canvas.Pixel(99, 99) == PackColor(255, 255, 255));
+}
+
+TEST_CASE("Rounded rects use the shader's distance function", "[software]") {
+    Canvas canvas(100, 100);
+
+    uint32_t blue = PackColor(0, 0, 255), red = PackColor(255, 0, 0);
+    CommandList list;
+    list.DrawRoundedRect(rounded(10, 10, 40, 10, blue));
+    list.DrawRoundedRect(rounded(60, 10, 30, 5, blue, red, 2));
+    canvas.Render(list);
+
+    REQUIRE(canvas.Pixel(30, 30) == blue);
+    REQUIRE(canvas.Pixel(10, 30) == blue); // distance -0.5, fully covered
+    REQUIRE(canvas.Pixel(9, 30) == BLACK);
+    REQUIRE(canvas.Pixel(10, 10) == BLACK); // rounded off
+    // The corner's edge is anti-aliased: somewhere between
+    uint32_t edge = canvas.Pixel(13, 12);
+    REQUIRE(edge != BLACK);
+    REQUIRE(edge != blue);
+
+    REQUIRE(canvas.Pixel(60, 25) == red);
+    REQUIRE(canvas.Pixel(61, 25) == red);
+    REQUIRE(canvas.Pixel(62, 25) == blue);
+    REQUIRE(canvas.Pixel(75, 25) == blue);
+    REQUIRE(canvas.Pixel(89, 25) == red);
+}
+
+TEST_CASE("Rounded rect edges without a border keep the fill color", "[software]") {
+    uint32_t white = PackColor(255, 255, 255);
+    Canvas canvas(50, 50, white);
+
+    CommandList list;
+    list.DrawRoundedRect(rounded(10, 10, 30, 10, PackColor(0, 0, 255)));
+    canvas.Render(list);
+
+    // Blue over white only ever loses red and green, a dark fringe would dim blue too
+    uint32_t edge = canvas.Pixel(12, 13);
+    REQUIRE(edge != white);
+    REQUIRE(edge != PackColor(0, 0, 255));
+    REQUIRE(((edge >> 16) & 0xFF) == 255);
+}
+
+TEST_CASE("Text lands where the GPU layout puts it", "[software]") {
+    Canvas canvas(100, 100);
+    mayak::test::BoxRasterizer rasterizer;
+    GlyphCache glyphs(rasterizer);
+
+    uint32_t white = PackColor(255, 255, 255);
+    CommandList list;
+    // 16 px: boxes 8 x 11 sitting on the baseline, one pixel right of the pen, advance 8.8
+    list.DrawText(glyphs, 0, 16, 10, 50, "A A", white);
+    canvas.Render(list);
+
+    REQUIRE(canvas.Pixel(10, 45) == BLACK);
+    REQUIRE(canvas.Pixel(11, 39) == white);
+    REQUIRE(canvas.Pixel(18, 49) == white);
+    REQUIRE(canvas.Pixel(11, 38) == BLACK);
+    REQUIRE(canvas.Pixel(11, 50) == BLACK);
+    REQUIRE(canvas.Pixel(20, 45) == BLACK); // the space
+    REQUIRE(canvas.Pixel(28, 45) == white); // pen at 27.6, pixel 27, box from 28
+    // 'A' at two subpixel offsets and the space for its advance, rasterized once and kept off the atlas
+    REQUIRE(canvas.renderer.Stats().glyphsRasterized == 3);
+    REQUIRE(rasterizer.calls == 3);
+    REQUIRE(glyphs.Count() == 0);
+    REQUIRE(glyphs.Atlas().Stats().inserts == 0);
+
+    // Drawn again, the bitmaps are still there
+    canvas.Render(list);
+    REQUIRE(canvas.renderer.Stats().glyphsRasterized == 0);
+    REQUIRE(rasterizer.calls == 3);
+}
+
+TEST_CASE("Tiles filled in parallel give the same pixels", "[software]") {
+    JobSystem serial(JobSystemOptions{0, false}), parallel(JobSystemOptions{3, false});
+    SoftwareRenderer one(&serial), many(&parallel);
+    SoftwareFramebuffer a, b;
+    a.Resize(300, 200);
+    b.Resize(300, 200);
+
+    CommandList list;
+    list.DrawRect(0, 0, 300, 200, PackColor(20, 20, 20));
+    for (int i = 0; i < 200; ++i) {
+        float x = float((i * 37) % 280) - 10.25f, y = float((i * 53) % 190) - 5.5f;
+        uint32_t color = PackColor(uint8_t(i * 13), uint8_t(i * 29), uint8_t(i * 7), uint8_t(60 + i % 196));
+        list.SetDepth(i % 3);
+        if (i % 4 == 0) {
+            list.DrawRoundedRect(rounded(x, y, 70, 12, color, PackColor(255, 255, 255, 200), 1.5f));
+        } else {
+            list.DrawRect(x, y, float(20 + i % 90), float(10 + i % 70), color);
+        }
+    }
+    one.Render(list, a);
+    many.Render(list, b);
+
+    REQUIRE(one.Stats().tiles == 5 * 4);
+    REQUIRE(std::equal(a.Pixels(), a.Pixels() + 300 * 200, b.Pixels()));
+}
+
+TEST_CASE("PPMs have the header and the colors without alpha", "[software]") {
+    SoftwareFramebuffer framebuffer;
+    framebuffer.Resize(2, 1);
+    framebuffer.Pixels()[0] = PackColor(1, 2, 3, 4);
+    framebuffer.Pixels()[1] = PackColor(250, 251, 252);
+
+    std::string path = (std::filesystem::temp_directory_path() / "mayak_software_test.ppm").string();
+    REQUIRE(framebuffer.WritePPM(path));
+    std::ifstream file(path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::filesystem::remove(path);
+
+    REQUIRE(contents == std::string("P6\n2 1\n255\n\x01\x02\x03\xFA\xFB\xFC", 17));
+}
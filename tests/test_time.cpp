@@ -0,0 +1,71 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/Time.hpp"
+
+using namespace mayak::core::time;
+
+TEST_CASE("FrameClock measures raw and smoothed delta", "[time]") {
+    FrameClock clock;
+    clock.Tick(0);
+    REQUIRE(clock.DeltaNs() == 0);
+
+    clock.Tick(16'000'000);
+    REQUIRE(clock.DeltaNs() == 16'000'000);
+    REQUIRE(clock.SmoothedDelta() > 0.0159);
+    REQUIRE(clock.SmoothedDelta() < 0.0161);
+
+    clock.Tick(48'000'000); // one long frame only nudges the smoothed value
+    REQUIRE(clock.DeltaNs() == 32'000'000);
+    REQUIRE(clock.SmoothedDelta() < 0.02);
+    REQUIRE(clock.History().Count() == 2);
+}
+
+TEST_CASE("FrameHistory reports percentiles", "[time]") {
+    FrameHistory history;
+    for (int64_t i = 1; i <= 100; ++i) history.Push(i);
+
+    FrameStats stats = history.Stats();
+    REQUIRE(stats.count == 100);
+    REQUIRE(stats.p50 == 51);
+    REQUIRE(stats.p95 == 95);
+    REQUIRE(stats.p99 == 99);
+    REQUIRE(stats.max == 100);
+}
+
+TEST_CASE("FixedStep accumulates and drops the backlog", "[time]") {
+    FixedStep fixed(0.01, 4);
+    REQUIRE(fixed.Advance(0.025) == 2);
+    REQUIRE(fixed.Alpha() > 0.49);
+    REQUIRE(fixed.Alpha() < 0.51);
+
+    REQUIRE(fixed.Advance(1.0) == 4);
+    REQUIRE(fixed.Alpha() == 0);
+}
+
+TEST_CASE("FrameClock keeps resumed frames out of the stats", "[time]") {
+    FrameClock clock;
+    clock.Tick(0);
+    clock.Tick(16'000'000);
+
+    clock.MarkResumed();
+    clock.Tick(60'000'000'000); // a minute minimized
+    REQUIRE(clock.FastForwarded());
+    REQUIRE(clock.SmoothedDelta() < 0.017);
+    REQUIRE(clock.History().Count() == 1);
+
+    clock.Tick(60'016'000'000);
+    REQUIRE_FALSE(clock.FastForwarded());
+}
+
+TEST_CASE("FrameClock starts from the nominal frame when the first frame is fast-forwarded", "[time]") {
+    FrameClock clock;
+    clock.Tick(0);
+    clock.MarkResumed();
+    clock.Tick(5'000'000'000);
+    REQUIRE(clock.FastForwarded());
+    REQUIRE(clock.SmoothedDelta() == FrameClock::NOMINAL_FRAME_SECONDS);
+
+    // The first real frame replaces it instead of getting averaged with it
+    clock.Tick(5'008'000'000);
+    REQUIRE(clock.SmoothedDelta() > 0.0079);
+    REQUIRE(clock.SmoothedDelta() < 0.0081);
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+#include "core/RenderThread.hpp"
+#include "core/TripleBuffer.hpp"
+
+#include <thread>
+
+using mayak::core::RenderPipeline;
+using mayak::core::TripleBuffer;
+
+TEST_CASE("TripleBuffer hands over the newest value", "[core]") {
+    TripleBuffer<int> mailbox;
+    REQUIRE_FALSE(mailbox.Acquire());
+
+    mailbox.WriteBuffer() = 1;
+    mailbox.Publish();
+    mailbox.WriteBuffer() = 2;
+    mailbox.Publish();
+
+    REQUIRE(mailbox.Acquire());
+    REQUIRE(mailbox.ReadBuffer() == 2); // 1 got overwritten
+    REQUIRE_FALSE(mailbox.Acquire());
+    REQUIRE(mailbox.ReadBuffer() == 2);
+}
+
+TEST_CASE("TripleBuffer never goes back in time across threads", "[core]") {
+    TripleBuffer<int> mailbox;
+    constexpr int frames = 100000;
+
+    std::thread producer([&] {
+        for (int i = 1; i <= frames; ++i) {
+            mailbox.WriteBuffer() = i;
+            mailbox.Publish();
+        }
+    });
+
+    int last = 0;
+    bool ordered = true;
+    while (last < frames) {
+        if (!mailbox.Acquire()) continue;
+        if (mailbox.ReadBuffer() <= last) ordered = false;
+        last = mailbox.ReadBuffer();
+    }
+    producer.join();
+    REQUIRE(ordered);
+}
+
+TEST_CASE("RenderPipeline keeps the main thread one frame ahead at most", "[core]") {
+    // No windows, the render thread's frames are empty and fast
+    RenderPipeline<int> pipeline;
+    pipeline.Start();
+
+    constexpr int frames = 200;
+    bool ahead = false;
+    for (int i = 0; i < frames; ++i) {
+        pipeline.Begin() = i;
+        // Packet i - 1 got taken, so everything before it was drawn
+        if (i > 0 && pipeline.RenderedFrames() + 1 < uint64_t(i)) ahead = true;
+        pipeline.Submit();
+    }
+    pipeline.Stop();
+
+    REQUIRE_FALSE(ahead);
+    REQUIRE(pipeline.RenderedFrames() >= frames - 1); // none got dropped on the way
+}